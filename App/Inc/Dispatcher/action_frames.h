@@ -0,0 +1,58 @@
+/*
+ * action_frames.h
+ *
+ *  Created on: Mar 9, 2026
+ *      Author: andrey
+ */
+
+#ifndef INC_DISPATCHER_ACTION_FRAMES_H_
+#define INC_DISPATCHER_ACTION_FRAMES_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_config.h"
+#include "Dispatcher/can_packer.h"
+#include "Dispatcher/recipe_store.h"
+
+/*
+ * Шаблоны кадров CAN для инструкций-действий рецептов.
+ *
+ * Кадр действия зависит только от инструкции, кроме тега задания и слотов,
+ * привязанных к аргументам задания (номер устройства, значение). Поэтому кадры
+ * собираются один раз и хранятся в кэше по адресу инструкции (программы лежат во
+ * Flash и не перемещаются, пока их не перезапишет RecipeFlash_Store). При запуске
+ * действия шаблон копируется, и в нем заменяются только эти слоты.
+ * Кадры настройки мотора перед движением сюда не входят: их отправляет
+ * motion_profile.h, только если параметры мотора отличаются от профиля.
+ *
+ * Кэш прямого отображения на ACTION_FRAMES_CACHE_SIZE инструкций; встроенные
+ * рецепты попадают в него при старте (ActionFrames_Init).
+ */
+
+#define ACTION_FRAMES_CACHE_SIZE    APP_ACTION_FRAMES_CACHE
+
+/**
+ * @brief Готовый кадр команды одной инструкции.
+ */
+typedef struct {
+	CAN_Message_t frame;
+	bool has_frame;             // false - инструкция не отправляет кадров (WAIT_MS, управление)
+	bool value_slot;            // payload кадра - значение инструкции (ROTATE_MOTOR)
+} ActionFrames_t;
+
+/**
+ * @brief Очищает кэш и собирает шаблоны действующих рецептов (из JobManager_Init).
+ */
+void ActionFrames_Init(void);
+
+/**
+ * @brief Сбрасывает кэш: программы во Flash перезаписаны или перемещены.
+ */
+void ActionFrames_Invalidate(void);
+
+/**
+ * @brief Шаблон кадра инструкции: из кэша или собранный заново (и сохраненный в кэше).
+ */
+const ActionFrames_t* ActionFrames_Get(const RecipeInstr_t* instr);
+
+#endif /* INC_DISPATCHER_ACTION_FRAMES_H_ */
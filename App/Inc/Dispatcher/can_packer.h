@@ -13,10 +13,42 @@
 
 // --- Определения для CAN-сообщений ---
 
+/*
+ * Формат кадров между Дирижером и исполнителями (Classic CAN, 11-битный ID):
+ *
+ *   ID команды: 0x100 | (executor_id << 4) | device_id
+ *   ID ответа:  0x200 | (executor_id << 4) | device_id
+ *
+ *   Кадр команды (8 байт):
+ *     Data[0]    - CommandID_t (command_protocol.h)
+ *     Data[1..4] - payload, int32 Little Endian (шаги, состояние насоса, скорость...)
+ *     Data[5..6] - тег задания (job_id), uint16 Little Endian. 0 = ответ не нужен.
+ *     Data[7]    - тег действия: исполнитель возвращает его без изменений
+ *
+ *   Кадр ответа (8 байт):
+ *     Data[0]    - CommandID_t, на которую отвечает исполнитель
+ *     Data[1]    - статус (0 = успех, иначе код ошибки исполнителя)
+ *     Data[2..4] - данные ответа (например, температура)
+ *     Data[5..6] - тег задания из команды
+ *     Data[7]    - тег действия из команды
+ */
+#define CAN_ID_COMMAND_BASE     0x100
+#define CAN_ID_RESPONSE_BASE    0x200
+#define CAN_ID_TYPE_MASK        0x700
+
+// Номера исполнителей на шине
+#define CAN_EXECUTOR_MOTORS     0   // Исполнитель шаговых двигателей
+#define CAN_EXECUTOR_PUMPS      1   // Исполнитель насосов и клапанов
+#define CAN_EXECUTOR_THERMO     2   // Исполнитель термостатов
+
+// Тег задания занимает 16 бит кадра, поэтому job_id не должен выходить за этот диапазон
+#define CAN_JOB_TAG_MAX         0xFFFF
+#define CAN_JOB_TAG_NONE        0   // Команда без ответа (настройки)
+
 /**
  * @brief Структура для представления CAN-сообщения.
- *        Это заглушка, реальная структура будет зависеть от вашей FDCAN периферии
- *        и протокола обмена.
+ *        Не зависит от HAL: заголовок FDCAN формируется в task_can_handler
+ *        непосредственно перед постановкой кадра в TX FIFO.
  */
 typedef struct {
 	uint32_t id;        // ID сообщения (адрес исполнителя + тип команды)
@@ -27,43 +59,96 @@ typedef struct {
 
 /**
  * @brief Структура для представления ответа от исполнителя по CAN.
- *        Пока заглушка.
  */
 typedef struct {
 	uint32_t job_id;    // ID задания, к которому относится ответ
     uint8_t executor_id; // ID исполнителя, от которого пришел ответ
+    uint8_t device_id;   // Номер устройства (мотор, насос, датчик) у исполнителя
+    uint8_t command;     // Команда, на которую пришел ответ (CommandID_t)
+    uint8_t action_tag;  // Тег действия из команды (назначается JobManager'ом)
+    uint8_t error_code;  // Код ошибки исполнителя (0 = нет ошибки)
+    int32_t value;       // Данные ответа (например, температура)
     bool status_ok;     // Статус выполнения действия (true=успех, false=ошибка)
-    // Дополнительные поля по необходимости
 } CAN_Response_t;
 
 
+// --- Слоты кадра команды: заполняются упаковщиками и заменяются в шаблонах (action_frames.h) ---
+
+static inline void Packer_SetDevice(CAN_Message_t* msg, uint8_t device_id)
+{
+	msg->id = (msg->id & ~0x0Fu) | (device_id & 0x0F);
+}
+
+static inline void Packer_SetPayload(CAN_Message_t* msg, int32_t payload)
+{
+	// Payload в формате Little Endian
+	msg->data[1] = (uint8_t)(payload & 0xFF);
+	msg->data[2] = (uint8_t)((payload >> 8) & 0xFF);
+	msg->data[3] = (uint8_t)((payload >> 16) & 0xFF);
+	msg->data[4] = (uint8_t)((payload >> 24) & 0xFF);
+}
+
+static inline void Packer_SetJobTag(CAN_Message_t* msg, uint32_t job_id, uint8_t action_tag)
+{
+	msg->data[5] = (uint8_t)(job_id & 0xFF);
+	msg->data[6] = (uint8_t)((job_id >> 8) & 0xFF);
+	msg->data[7] = action_tag;
+}
+
 // --- Прототипы функций-упаковщиков для JobManager ---
 
 /**
  * @brief Создает CAN-сообщение для поворота мотора.
+ * @note  Скорость передается отдельными командами настройки (motion_profile.h).
  */
-void Packer_CreateRotateMotorMsg(uint8_t motor_id, int32_t steps, uint16_t speed, uint32_t job_id, CAN_Message_t* out_msg);
+void Packer_CreateRotateMotorMsg(uint8_t motor_id, int32_t steps, uint32_t job_id, uint8_t action_tag, CAN_Message_t* out_msg);
+
+/**
+ * @brief Создает CAN-сообщение установки скорости мотора (без ответа исполнителя).
+ */
+void Packer_CreateSetSpeedMsg(uint8_t motor_id, uint16_t speed, CAN_Message_t* out_msg);
+
+/**
+ * @brief Создает CAN-сообщение установки ускорения мотора (без ответа исполнителя).
+ */
+void Packer_CreateSetAccelerationMsg(uint8_t motor_id, uint16_t acceleration, CAN_Message_t* out_msg);
+
+/**
+ * @brief Создает CAN-сообщение установки рабочего тока мотора, мА (без ответа исполнителя).
+ */
+void Packer_CreateSetCurrentMsg(uint8_t motor_id, uint16_t current_ma, CAN_Message_t* out_msg);
+
+/**
+ * @brief Создает CAN-сообщение остановки мотора (CMD_STOP, без ответа исполнителя).
+ */
+void Packer_CreateStopMotorMsg(uint8_t motor_id, CAN_Message_t* out_msg);
 
 /**
  * @brief Создает CAN-сообщение для запуска насоса.
  */
-void Packer_CreateStartPumpMsg(uint8_t pump_id, uint32_t job_id, CAN_Message_t* out_msg);
+void Packer_CreateStartPumpMsg(uint8_t pump_id, uint32_t job_id, uint8_t action_tag, CAN_Message_t* out_msg);
 
 /**
  * @brief Создает CAN-сообщение для остановки насоса.
  */
-void Packer_CreateStopPumpMsg(uint8_t pump_id, uint32_t job_id, CAN_Message_t* out_msg);
+void Packer_CreateStopPumpMsg(uint8_t pump_id, uint32_t job_id, uint8_t action_tag, CAN_Message_t* out_msg);
 
 /**
  * @brief Создает CAN-сообщение для поиска "дома" мотора.
+ * @note  Скорость поиска передается отдельными командами настройки (motion_profile.h).
+ */
+void Packer_CreateHomeMotorMsg(uint8_t motor_id, uint32_t job_id, uint8_t action_tag, CAN_Message_t* out_msg);
+
+/**
+ * @brief Создает CAN-сообщение запроса температуры с датчика.
  */
-void Packer_CreateHomeMotorMsg(uint8_t motor_id, uint16_t speed, uint32_t job_id, CAN_Message_t* out_msg);
+void Packer_CreateGetTemperatureMsg(uint8_t sensor_id, uint32_t job_id, uint8_t action_tag, CAN_Message_t* out_msg);
 
-// --- Прототипы функций-распаковщиков для task_can_handler (для будущей реализации) ---
+// --- Прототипы функций-распаковщиков ---
 
 /**
  * @brief Распаковывает входящее CAN-сообщение в CAN_Response_t.
- *        Эта функция будет использоваться CAN-обработчиком.
+ * @return false, если кадр не является ответом исполнителя.
  */
 bool Packer_ParseCanResponse(const CAN_Message_t* in_msg, CAN_Response_t* out_response);
 
@@ -9,6 +9,7 @@
 #define INC_DISPATCHER_COMMAND_PARSER_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "app_config.h"
 
  /**
@@ -20,6 +21,9 @@ typedef enum {
     RECIPE_ASPIRATE,
     RECIPE_INITIALIZE_SYSTEM,
 	RECIPE_DISPENSER_WASH,
+	RECIPE_MIXER_MIX,          // Слоты машинного цикла (cycle_scheduler.h)
+	RECIPE_REACTION_STEP,
+	RECIPE_CUVETTE_WASH,
 
 	// --- [ADD_NEW_COMMAND] ---
 	// 1. Добавьте новый ID рецепта здесь
@@ -27,6 +31,18 @@ typedef enum {
 	RECIPE_MAX_ID
 	} RecipeID_t;
 
+/**
+ * @brief Класс приоритета задания.
+ *        Значение по умолчанию (0) - рутинная работа, чтобы дескриптор без явного
+ *        .priority не получал случайно срочный класс.
+ */
+typedef enum {
+	JOB_PRIORITY_ROUTINE = 0,  // Рутинные измерения
+	JOB_PRIORITY_STAT,         // Срочный образец (STAT): обслуживается раньше рутинной работы
+	JOB_PRIORITY_MAINTENANCE,  // Промывки и обслуживание: заполняют простои
+	JOB_PRIORITY_COUNT
+	} JobPriority_t;
+
 // Тип указателя на функцию для обработчиков прямых команд
 // Объявляется тип для указателя на функцию. Любая функция, которая соответствует этой "подписи"
 // принимает uint16_t, const uint8_t*, uint16_t и ничего не возвращает),
@@ -40,6 +56,7 @@ typedef struct {
 	uint16_t command_code; // Код команды
 	uint16_t min_params_len; // Минимальная длина параметров
 	uint16_t max_params_len; // Максимальная длина параметров
+	bool starts_job; // Обработчик запускает задание: DONE - по его завершении (вид 0x01 в GET_VERSION)
 	DirectCommandHandler_t  handler; // Указатель на функцию-обработчик
 	} DirectCommandDescriptor_t; // "паспорт" для прямой команды.
 
@@ -49,11 +66,19 @@ typedef struct {
 	uint16_t min_params_len; // Минимальная длина параметров
 	uint16_t max_params_len; // Максимальная длина параметров
 	RecipeID_t recipe_id; // ID рецепта
+	JobPriority_t priority; // Класс приоритета заданий этой команды
 	} RecipeCommandDescriptor_t; // "паспорт" для команды-рецепта.
 		                         // Он очень похож, "паспорт" для прямой команды.
 		                         // но вместо указателя на функцию-обработчик (handler)
 		                         // содержит recipe_id. Это связывает код команды напрямую с ID рецепта, который должен запустить
 		                         // JobManager.
+
+// Таблицы дескрипторов (command_parser.c). GET_VERSION передает их ПК как список поддерживаемых команд.
+extern const DirectCommandDescriptor_t direct_command_table[];
+extern const uint16_t DIRECT_COMMAND_TABLE_SIZE;
+extern const RecipeCommandDescriptor_t recipe_command_table[];
+extern const uint16_t RECIPE_COMMAND_TABLE_SIZE;
+
  /**
   * @brief Структура для хранения бинарных аргументов.
   */
@@ -70,6 +95,7 @@ typedef struct {
 typedef struct {
 	uint16_t command_code; // <-- Добавлено поле command_code 22.01.2026
 	RecipeID_t recipe_id;
+	JobPriority_t priority; // Класс приоритета задания (из дескриптора команды)
 
 	// Указывает, какой тип данных находится в union 'args'
 	enum {
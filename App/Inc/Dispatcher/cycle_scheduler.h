@@ -0,0 +1,104 @@
+/*
+ * cycle_scheduler.h
+ *
+ *  Created on: Mar 2, 2026
+ *      Author: andrey
+ */
+
+#ifndef INC_DISPATCHER_CYCLE_SCHEDULER_H_
+#define INC_DISPATCHER_CYCLE_SCHEDULER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Планировщик машинного цикла анализатора.
+ *
+ * Тест занимает кювету реакционного диска. В начале каждого цикла диск
+ * поворачивается на одну кювету, после чего каждый модуль выполняет один слот
+ * над кюветой, стоящей у него: дозирование образца, реагента, перемешивание,
+ * промывка кюветы после измерения. Тест, поступивший в цикле n, проходит
+ * модуль стадии k в цикле n + k, поэтому за цикл завершается до одного теста:
+ * номинальная производительность - 3 600 000 / cycle_ms тестов в час.
+ *
+ * Слоты цикла - задания JobManager'а. План следующего цикла (какие слоты
+ * заняты какими тестами) строится, пока идет текущий, так что на границе цикла
+ * задания только запускаются. Если модуль не уложился в цикл, следующий цикл
+ * начинается по завершении его слота (цикл растягивается, см. overruns).
+ *
+ * План - таблица слотов, а не расписание кадров CAN с моментами отправки.
+ * Кадры слота отправляет интерпретатор рецептов: следующий шаг рецепта (и
+ * действие блока PAR с зависимостями) стартует по ответу исполнителя, а время
+ * ответа зависит от нагрузки мотора, длины пути HOME и очереди шины. Заранее
+ * рассчитанные моменты кадров расходились бы с фактическими при любом отклонении,
+ * а отправка по ним без ответа нарушила бы порядок действий. Поэтому заранее
+ * готовится то, что от ответов не зависит:
+ *  - таблица слотов следующего цикла (CycleScheduler_PlanNextCycle);
+ *  - шаблоны кадров действий рецептов слотов (action_frames.h) - при построении плана;
+ *  - срок каждого слота: конец поворота диска + slot_ms; превышение срока и
+ *    растяжение цикла сообщаются по окончании цикла.
+ */
+
+#define CYCLE_PIPELINE_DEPTH    8       // Позиций диска от дозирования образца до промывки кюветы
+#define CYCLE_MAX_QUEUED_TESTS  1024    // Тестов в очереди заказа
+#define CYCLE_DISK_SLOT_MS      500     // Поворот диска: слоты модулей начинаются после него
+
+typedef enum {
+	CYCLE_STATE_STOPPED = 0,
+	CYCLE_STATE_RUNNING,        // Циклы идут, пока есть тесты в очереди или на диске
+	CYCLE_STATE_STOPPING        // Новые тесты не поступают, тесты на диске доводятся до конца
+} CycleState_t;
+
+/**
+ * @brief Статистика планировщика цикла (с последнего CycleScheduler_Start).
+ */
+typedef struct {
+	uint32_t cycles;            // Выполнено машинных циклов
+	uint32_t overruns;          // Циклов, растянутых сверх cycle_ms
+	uint32_t max_overrun_ms;    // Наибольшее растяжение цикла
+	uint32_t tests_completed;   // Тестов, прошедших все слоты
+	uint32_t tests_failed;      // Тестов с ошибкой слота (кювета все равно промывается)
+	uint32_t busy_ms;           // Время в циклах (без простоя без тестов)
+	uint32_t tests_per_hour;    // Достигнутая производительность: tests_completed за busy_ms
+	uint32_t rated_per_hour;    // Номинальная производительность при cycle_ms
+	uint16_t tests_queued;      // Тестов ждут поступления на диск
+	uint16_t cycle_ms;
+	uint8_t  tests_on_disk;     // Тестов в кюветах диска
+	uint8_t  state;             // CycleState_t
+} CycleStats_t;
+
+void CycleScheduler_Init(void);
+
+/**
+ * @brief Запускает машинные циклы с длиной cycle_ms и обнуляет статистику.
+ * @return false, если цикл короче самого длинного слота (CycleScheduler_GetMinCycleMs).
+ */
+bool CycleScheduler_Start(uint16_t cycle_ms);
+
+/**
+ * @brief Останавливает поступление тестов; тесты на диске доводятся до конца.
+ */
+void CycleScheduler_Stop(void);
+
+/**
+ * @brief Добавляет count тестов в очередь заказа.
+ * @return false, если очередь переполнится (тесты не добавлены).
+ */
+bool CycleScheduler_OrderTests(uint16_t count);
+
+/**
+ * @brief Наименьшая длина цикла, в которую укладываются бюджеты всех слотов.
+ */
+uint16_t CycleScheduler_GetMinCycleMs(void);
+
+void CycleScheduler_GetStats(CycleStats_t* out_stats);
+
+/**
+ * @brief Запускает слоты, срок которых наступил, и переходит к следующему циклу.
+ *        Вызывается вместе с JobManager_Run() при обработке таймеров (JobInbox_Process).
+ * @return Через сколько мс вызвать снова, или JOB_MANAGER_NO_DEADLINE
+ *         (ждем завершения слотов или циклы не идут).
+ */
+uint32_t CycleScheduler_Run(void);
+
+#endif /* INC_DISPATCHER_CYCLE_SCHEDULER_H_ */
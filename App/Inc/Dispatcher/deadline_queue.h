@@ -0,0 +1,57 @@
+/*
+ * deadline_queue.h
+ *
+ *  Сервис таймеров JobManager'а: двоичная min-куча сроков (deadline).
+ *  Каждый таймер идентифицируется номером (TimerId_t), у таймера может быть
+ *  не больше одного срока в очереди. Перестановка и отмена - O(log n),
+ *  ближайший срок - O(1).
+ */
+
+#ifndef INC_DISPATCHER_DEADLINE_QUEUE_H_
+#define INC_DISPATCHER_DEADLINE_QUEUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_config.h"
+
+// Один таймер на каждое действие шага в каждом слоте задания
+#define DEADLINE_QUEUE_CAPACITY     (APP_MAX_ACTIVE_JOBS * APP_MAX_STEP_ACTIONS)
+
+typedef uint16_t TimerId_t;
+
+/**
+ * @brief Сравнение моментов времени с учетом переполнения HAL_GetTick().
+ * @return true, если момент a наступил не позже момента b.
+ */
+static inline bool Deadline_IsReached(uint32_t now_ms, uint32_t deadline_ms)
+{
+	return (int32_t)(now_ms - deadline_ms) >= 0;
+}
+
+void DeadlineQueue_Init(void);
+
+/**
+ * @brief Устанавливает (или переносит) срок таймера.
+ * @return true, если этот срок стал ближайшим в очереди.
+ */
+bool DeadlineQueue_Set(TimerId_t id, uint32_t deadline_ms);
+
+/**
+ * @brief Снимает таймер с очереди (если он был установлен).
+ * @return true, если таймер был в очереди.
+ */
+bool DeadlineQueue_Cancel(TimerId_t id);
+
+/**
+ * @brief Извлекает один истекший к моменту now_ms таймер.
+ * @return false, если истекших таймеров нет.
+ */
+bool DeadlineQueue_PopExpired(uint32_t now_ms, TimerId_t* out_id);
+
+/**
+ * @brief Ближайший срок в очереди.
+ * @return false, если очередь пуста.
+ */
+bool DeadlineQueue_Next(uint32_t* out_deadline_ms);
+
+#endif /* INC_DISPATCHER_DEADLINE_QUEUE_H_ */
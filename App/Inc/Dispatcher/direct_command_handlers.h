@@ -14,6 +14,17 @@
 
 // Прототипы для обработчиков прямых команд
 void handle_get_status(uint16_t command_code, const uint8_t* params, uint16_t params_len);
+void handle_get_version(uint16_t command_code, const uint8_t* params, uint16_t params_len);
+void handle_get_queue_stats(uint16_t command_code, const uint8_t* params, uint16_t params_len);
+void handle_recipe_upload(uint16_t command_code, const uint8_t* params, uint16_t params_len);
+void handle_recipe_list(uint16_t command_code, const uint8_t* params, uint16_t params_len);
+void handle_recipe_delete(uint16_t command_code, const uint8_t* params, uint16_t params_len);
+void handle_recipe_run(uint16_t command_code, const uint8_t* params, uint16_t params_len);
+void handle_cycle(uint16_t command_code, const uint8_t* params, uint16_t params_len);
+void handle_job_control(uint16_t command_code, const uint8_t* params, uint16_t params_len);
+void handle_job_list(uint16_t command_code, const uint8_t* params, uint16_t params_len);
+void handle_job_history(uint16_t command_code, const uint8_t* params, uint16_t params_len);
+void handle_job_trace(uint16_t command_code, const uint8_t* params, uint16_t params_len);
 
 // Здесь будут добавляться прототипы для других прямых команд
 
@@ -22,6 +22,15 @@ typedef struct {
 
 
 
+// --- Возможности протокола USB (GET_VERSION) ---
+#define PROTOCOL_CRC_XOR8          0x01   // CRC пакета - XOR байтов от кода команды до конца параметров
+#define PROTOCOL_OPT_SEQUENCE      0x01   // Команды с номером (шапка "CS>"): повторы не выполняются, см. host_seq.h
+#define PROTOCOL_OPT_JOB_TRACE     0x02   // Трасса заданий (JOB_TRACE) записывается
+
+// Служебные байты пакета ответа с номером: шапка(3) длина(2) номер(2) код(2) тип(1) статус(2) CRC(1).
+// Данные DATA-ответа должны помещаться в APP_USB_RESP_MAX_LEN вместе с ними при любой шапке.
+#define PROTOCOL_RESP_OVERHEAD     13
+
 /**
 * @brief Отправляет строку-ответ в очередь на передачу по USB.
 *        Эта функция предназначена для всех внутренних модулей диспетчера,
@@ -0,0 +1,75 @@
+/*
+ * host_seq.h
+ *
+ *  Created on: Mar 9, 2026
+ *      Author: andrey
+ */
+
+#ifndef INC_DISPATCHER_HOST_SEQ_H_
+#define INC_DISPATCHER_HOST_SEQ_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_config.h"
+
+/*
+ * Номера команд ПК и подавление повторов.
+ *
+ * Пакет с шапкой "CS>" несет перед кодом команды номер seq(2), ответы на него
+ * приходят с той же шапкой и тем же номером (protocol.md, 2.6). Если ACK потерян
+ * или пакет отброшен по CRC, ПК повторяет команду с тем же номером, не зная,
+ * выполнилась ли она.
+ *
+ * Дирижер помнит ответы HOST_SEQ_CACHE_SIZE последних команд с номерами: ACK или
+ * NACK и итоговый DONE/ERROR (для команд-рецептов - по завершении задания).
+ * Повтор с известным номером не выполняется: вместо этого повторяются запомненные
+ * ответы. Итог еще выполняющегося задания придет один раз, когда задание завершится.
+ * DATA не запоминаются - повтор запроса вернет только ACK и DONE.
+ *
+ * Номер в кэше сверяется вместе с кодом и CRC команды: тот же номер с другой
+ * командой (ПК начал нумерацию заново) - новая команда. Если команда с этим номером
+ * еще выполняется, новая получает NACK ERR_BUSY: строка и будущий DONE остаются
+ * за выполняющейся командой.
+ *
+ * Новая команда занимает строку самой старой завершенной команды. Строки команд,
+ * чьи задания еще выполняются, не вытесняются; если заняты все, команда получает
+ * NACK ERR_BUSY и не выполняется.
+ */
+
+#define HOST_SEQ_CACHE_SIZE     APP_HOST_SEQ_CACHE
+
+void HostSeq_Init(void);
+
+/**
+ * @brief Регистрирует команду с номером seq перед выполнением.
+ *        Если это повтор запомненной команды, повторяет ее ответы.
+ *
+ * @param crc CRC пакета: отличает повтор от другой команды с тем же номером.
+ * @return true - новая команда: выполнить, ответы до HostSeq_End адресуются номеру seq;
+ *         false - повтор (ответы уже отправлены), нет свободной строки или номер занят
+ *                 выполняющейся командой (отправлен NACK ERR_BUSY).
+ */
+bool HostSeq_Begin(uint16_t seq, uint16_t command_code, uint8_t crc);
+
+/**
+ * @brief Адресует номеру seq отложенный ответ (DONE задания) до HostSeq_End.
+ */
+void HostSeq_Resume(uint16_t seq);
+
+/**
+ * @brief Завершает отправку ответов команде с номером.
+ */
+void HostSeq_End(void);
+
+/**
+ * @brief Номер команды, которой сейчас отправляются ответы.
+ * @return false - команда без номера (шапка "CM>").
+ */
+bool HostSeq_Current(uint16_t* out_seq);
+
+/**
+ * @brief Запоминает ответ ACK/NACK/DONE/ERROR текущей команде с номером (из dispatcher_io.c).
+ */
+void HostSeq_Record(uint16_t command_code, uint8_t response_type, uint16_t status);
+
+#endif /* INC_DISPATCHER_HOST_SEQ_H_ */
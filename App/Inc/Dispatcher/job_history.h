@@ -0,0 +1,85 @@
+/*
+ * job_history.h
+ *
+ *  Created on: Mar 9, 2026
+ *      Author: andrey
+ */
+
+#ifndef INC_DISPATCHER_JOB_HISTORY_H_
+#define INC_DISPATCHER_JOB_HISTORY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_config.h"
+
+/*
+ * История выполненных заданий: кольцо из JOB_HISTORY_DEPTH последних завершенных
+ * заданий с временем каждого шага рецепта.
+ *
+ * Пока задание выполняется, JobManager накапливает шаги в записи его слота.
+ * Шаги группируются по адресу: проходы цикла суммируются в одну строку, поэтому
+ * запись показывает, какие шаги рецепта занимают больше всего времени.
+ * При завершении задания запись копируется в кольцо, вытесняя самую старую.
+ */
+
+#define JOB_HISTORY_DEPTH       APP_JOB_HISTORY_DEPTH
+#define JOB_HISTORY_MAX_STEPS   APP_JOB_HISTORY_MAX_STEPS
+#define JOB_HISTORY_EXEC_NONE   0xFF    // Шаг закрыт самим Дирижером: WAIT_MS или остановка по команде ПК
+
+/**
+ * @brief Время шага рецепта (всех его проходов) в одном задании.
+ */
+typedef struct {
+	uint32_t total_ms;          // Суммарное время проходов шага
+	uint32_t max_ms;            // Самый долгий проход
+	uint16_t runs;              // Проходов шага (циклы, повтор после паузы), насыщается на 0xFFFF
+	uint8_t  step_pc;           // Адрес первого действия шага
+	uint8_t  slowest_exec;      // Исполнитель, ответ которого завершил самый долгий проход, или JOB_HISTORY_EXEC_NONE
+} JobHistoryStep_t;
+
+/**
+ * @brief Запись о завершенном задании.
+ */
+typedef struct {
+	uint32_t seq;               // Номер записи по порядку завершения, начиная с 1
+	uint32_t queued_ms;         // Постановка в очередь (HAL_GetTick)
+	uint32_t start_ms;          // Запуск первого шага; равен end_ms, если задание не запускалось
+	uint32_t end_ms;            // Завершение
+	uint16_t job_id;
+	uint8_t  recipe_id;         // RecipeID_t
+	uint8_t  status;            // JobStatus_t
+	uint8_t  step_count;        // Заполненных строк steps
+	uint8_t  steps_dropped;     // Шагов, не поместившихся в steps (насыщается на 0xFF)
+	JobHistoryStep_t steps[JOB_HISTORY_MAX_STEPS]; // В порядке первого выполнения
+} JobHistoryEntry_t;
+
+void JobHistory_Init(void);
+
+/**
+ * @brief Начинает запись для задания в слоте slot (вызывается при выделении слота).
+ */
+void JobHistory_Open(uint8_t slot, uint32_t queued_ms);
+
+/**
+ * @brief Отмечает запуск задания после ожидания ресурсов.
+ */
+void JobHistory_Started(uint8_t slot, uint32_t now_ms);
+
+/**
+ * @brief Учитывает проход шага step_pc длительностью duration_ms.
+ * @param exec_id Исполнитель, чей ответ (или тайм-аут) завершил проход.
+ */
+void JobHistory_Step(uint8_t slot, uint8_t step_pc, uint32_t duration_ms, uint8_t exec_id);
+
+/**
+ * @brief Переносит запись слота в кольцо истории.
+ */
+void JobHistory_Close(uint8_t slot, uint16_t job_id, uint8_t recipe_id, uint8_t status, uint32_t end_ms);
+
+/**
+ * @brief Возвращает самую старую запись кольца с номером больше after_seq.
+ * @return NULL, если таких записей нет.
+ */
+const JobHistoryEntry_t* JobHistory_GetNext(uint32_t after_seq);
+
+#endif /* INC_DISPATCHER_JOB_HISTORY_H_ */
@@ -0,0 +1,71 @@
+/*
+ * job_inbox.h
+ *
+ *  Created on: Mar 9, 2026
+ *      Author: andrey
+ */
+
+#ifndef INC_DISPATCHER_JOB_INBOX_H_
+#define INC_DISPATCHER_JOB_INBOX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_config.h"
+#include "Dispatcher/can_packer.h"
+
+/*
+ * Входящие события JobManager'а.
+ *
+ * Состоянием заданий (JobManager, планировщик цикла, таймеры) владеет одна
+ * задача - задача диспетчера: в ней выполняются команды ПК, поэтому запуск,
+ * отмена и опрос заданий остаются прямыми вызовами. Остальные задачи и
+ * прерывания состояние заданий не трогают, а передают события владельцу:
+ *
+ *   - ответ исполнителя (прием CAN) - в кольцо на JOB_INBOX_DEPTH ответов;
+ *   - истечение таймеров (монитор заданий) - флагом, который не теряется
+ *     и не занимает место в кольце.
+ *
+ * Кольцо без блокировок (много производителей, один потребитель): у каждой
+ * ячейки есть номер, по которому производитель захватывает ячейку атомарным
+ * сравнением с обменом, а владелец видит, что запись в нее закончена.
+ * Отправка события не ждет владельца и безопасна в прерывании.
+ */
+
+#define JOB_INBOX_DEPTH     APP_JOB_INBOX_DEPTH
+
+/**
+ * @brief Очищает кольцо (из JobManager_Init, до запуска приема CAN).
+ */
+void JobInbox_Init(void);
+
+/**
+ * @brief Передает владельцу ответ исполнителя. Можно вызывать из любой задачи и из прерывания.
+ * @return false, если кольцо заполнено: ответ потерян, как потерянный кадр CAN
+ *         (действие завершится по тайм-ауту).
+ */
+bool JobInbox_PostResponse(const CAN_Response_t* response);
+
+/**
+ * @brief Сообщает владельцу, что пора обработать таймеры: срок наступил
+ *        или появился более ранний срок. Можно вызывать из любой задачи и из прерывания.
+ */
+void JobInbox_PostTimer(void);
+
+/**
+ * @brief Обрабатывает накопившиеся события. Вызывается только задачей-владельцем.
+ *        После таймеров монитор заданий взводится на следующий срок (JobsMonitor_Arm).
+ */
+void JobInbox_Process(void);
+
+/**
+ * @brief Обрабатывает таймеры JobManager'а и планировщика цикла и взводит монитор.
+ *        Вызывается из JobInbox_Process; симулятор вызывает напрямую при воспроизведении трассы (job_trace.h).
+ */
+void JobInbox_RunTimers(void);
+
+/**
+ * @brief Количество ответов, потерянных из-за заполненного кольца.
+ */
+uint32_t JobInbox_GetDroppedCount(void);
+
+#endif /* INC_DISPATCHER_JOB_INBOX_H_ */
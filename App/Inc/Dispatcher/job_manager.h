@@ -15,40 +15,180 @@
 #include "Dispatcher/recipe_store.h"
 
 // --- Константы ---
-#define MAX_CONCURRENT_JOBS     5
-#define JOB_TIMEOUT_MS          5000
+#define MAX_CONCURRENT_JOBS     APP_MAX_ACTIVE_JOBS
+#define JOB_TIMEOUT_MS          APP_JOB_TIMEOUT_MS
+#define JOB_MANAGER_NO_DEADLINE 0xFFFFFFFFu // Нет активных таймеров: монитор может спать до уведомления
 
 // --- Типы данных ---
 
 typedef enum {
     JOB_STATUS_IDLE,
     JOB_STATUS_RUNNING,
-    JOB_STATUS_PAUSED,
+    JOB_STATUS_PAUSED,           // Остановлено командой JOB_CONTROL: ресурсы удерживаются до RESUME/CANCEL
     JOB_STATUS_COMPLETED,
     JOB_STATUS_TIMEOUT,
-    JOB_STATUS_ERROR
+    JOB_STATUS_ERROR,
+    JOB_STATUS_QUEUED,           // Ждет в очереди освобождения ресурсов рецепта
+    JOB_STATUS_CANCELLED         // Отменено командой JOB_CONTROL
 } JobStatus_t;
 
+/**
+ * @brief Уведомление владельца о завершении задания (см. JobManager_StartOwnedJob).
+ *        Вызывается из JobManager'а: нельзя запускать и завершать задания внутри.
+ */
+typedef void (*JobDoneCallback_t)(uint8_t owner_tag, JobStatus_t final_status);
+
+/**
+ * @brief Контекст задания. Поля упорядочены по размеру, перечисления хранятся в uint8_t,
+ *        чтобы таблица на MAX_CONCURRENT_JOBS слотов оставалась компактной (DTCM).
+ *        Команда ПК не хранится: при запуске ее параметры разбираются в args,
+ *        от самой команды остается только код для ответа DONE.
+ */
 typedef struct {
-    uint32_t job_id;
-    JobStatus_t status;
-    RecipeID_t initial_recipe_id;
-    const ProcessStep_t* current_recipe;
-    uint8_t current_step_index;
-    uint8_t pending_actions_count;
+    const RecipeInstr_t* code;   // Программа рецепта (байт-код, см. recipe_store.h)
+    JobDoneCallback_t on_done;   // Владелец задания (планировщик цикла) или NULL - ответ DONE на ПК
     uint32_t step_start_time_ms;
-    UniversalCommand_t initial_cmd;
+    uint32_t queued_at_ms;       // Момент постановки в очередь (старение и статистика ожидания)
+    ResourceMask_t resources;    // Ресурсы рецепта, захватываются при запуске задания
+    int32_t args[RECIPE_MAX_ARGS]; // Аргументы команды, разобранные по раскладке рецепта
+    uint16_t loop_left[RECIPE_MAX_LOOP_DEPTH]; // Оставшиеся проходы вложенных циклов
+    uint16_t job_id;             // Поколение слота и номер слота (см. job_manager.c); 0 - слот свободен
+    uint16_t generation;         // Поколение слота: растет при каждом новом задании в слоте
+    uint16_t command_code;       // Команда ПК, запустившая задание: ей адресован ответ DONE
+    uint16_t host_seq;           // Номер этой команды (шапка "CS>"), если host_sequenced
+    uint8_t loop_start[RECIPE_MAX_LOOP_DEPTH]; // Адрес первой инструкции тела цикла
+    uint8_t status;              // JobStatus_t
+    uint8_t initial_recipe_id;   // RecipeID_t
+    uint8_t priority;            // JobPriority_t
+    uint8_t code_len;            // Длина программы в инструкциях
+    uint8_t pc;                  // Следующая инструкция программы
+    uint8_t step_pc;             // Адрес первого действия выполняющегося шага: действие i - code[step_pc + i]
+    uint8_t fail_pc;             // Переход при ошибке текущего шага (RECIPE_OP_BRANCH_IF_FAIL), иначе RECIPE_PC_NONE
+    uint8_t loop_depth;
+    uint8_t pending_mask;        // Бит i: действие i текущего шага еще не завершено
+    uint8_t waiting_mask;        // Бит i: действие i ждет завершения предшественников (RECIPE_AFTER)
+    uint8_t homing_mask;         // Бит i: перемещение i, прерванное паузой, ждет HOME своего мотора
+    uint8_t step_seq;            // Счетчик запущенных шагов, входит в тег действия CAN-кадра
+    uint8_t owner_tag;           // Аргумент on_done: номер слота у владельца
+    bool host_sequenced;         // DONE адресуется номеру host_seq и запоминается (host_seq.h)
 } JobContext_t;
 
+/**
+ * @brief Статистика ожидания в очереди по классу приоритета.
+ */
+typedef struct {
+    uint32_t admitted;           // Запущено заданий класса
+    uint32_t total_wait_ms;      // Суммарное время ожидания запущенных заданий
+    uint32_t max_wait_ms;        // Максимальное время ожидания
+    uint16_t queued;             // Заданий класса в очереди сейчас
+} JobClassStats_t;
+
+/**
+ * @brief Снимок состояния задания для опроса с ПК (JOB_LIST).
+ */
+typedef struct {
+    uint32_t elapsed_ms;         // С постановки задания (ожидание в очереди и выполнение)
+    uint16_t job_id;
+    uint16_t step_ms;            // С начала текущего шага, насыщается на 0xFFFF
+    uint8_t recipe_id;           // RecipeID_t
+    uint8_t status;              // JobStatus_t: RUNNING, PAUSED или QUEUED
+    uint8_t priority;            // JobPriority_t
+    uint8_t step_pc;             // Адрес первого действия текущего шага
+    uint8_t pending_mask;        // Действия шага, ждущие ответа исполнителя или окончания ожидания
+    uint8_t waiting_mask;        // Действия шага, ждущие предшественников (RECIPE_AFTER)
+} JobSnapshot_t;
+
 // --- API модуля Job Manager ---
+// Вызывается только задачей диспетчера - владельцем состояния заданий (см. job_inbox.h).
 
 void JobManager_Init(void);
 
+/**
+ * @brief Создает задание. Если ресурсы рецепта заняты другими заданиями,
+ *        задание ждет в очереди и запускается, как только они освободятся.
+ *        Неизвестный рецепт или аргумент вне диапазона завершают задание сразу,
+ *        с DONE 0x0001 - это единственный итог команды.
+ * @return ID задания или 0, если свободных слотов нет: тогда итог отправляет вызывающий.
+ */
 uint32_t JobManager_StartNewJob(const UniversalCommand_t* parsed_cmd);
 
-bool JobManager_ProcessExecutorResponse(uint32_t job_id, uint8_t executor_id, bool action_status_ok);
+/**
+ * @brief Создает задание для внутреннего владельца (планировщик машинного цикла).
+ *        Вместо ответа DONE на ПК по завершении вызывается on_done(owner_tag, статус) -
+ *        в том числе, если задание не удалось запустить после выделения слота.
+ * @return ID задания или 0, если свободных слотов нет (on_done не вызывается).
+ */
+uint32_t JobManager_StartOwnedJob(const UniversalCommand_t* parsed_cmd, JobDoneCallback_t on_done, uint8_t owner_tag);
+
+/**
+ * @brief Засчитывает ответ исполнителя действию текущего шага задания.
+ *        Действие находится по тегу из кадра (Data[7]) и сверяется с исполнителем.
+ *        Повторные и запоздавшие ответы отбрасываются без сообщений.
+ *        Прием CAN передает ответы через JobInbox_PostResponse.
+ * @return false, если ответ отброшен.
+ */
+bool JobManager_ProcessExecutorResponse(uint32_t job_id, uint8_t executor_id, uint8_t action_tag, bool action_status_ok);
+
+/**
+ * @brief Отменяет задание в очереди, в работе или на паузе: всем моторам и насосам
+ *        задания (не только текущего шага) отправляется остановка, ресурсы освобождаются,
+ *        задание завершается со статусом JOB_STATUS_CANCELLED.
+ * @return false, если задания с таким ID нет.
+ */
+bool JobManager_CancelJob(uint32_t job_id);
+
+/**
+ * @brief Приостанавливает выполняющееся задание: исполнители текущего шага
+ *        останавливаются, ресурсы остаются за заданием. Запоминается, какие
+ *        действия шага не выполнены.
+ * @return false, если задания нет или оно не выполняется.
+ */
+bool JobManager_PauseJob(uint32_t job_id);
+
+/**
+ * @brief Продолжает приостановленное задание с прерванного шага. Выполненные действия
+ *        не повторяются; насос, выключенный паузой посреди блока PAR, включается снова.
+ *        Мотор, остановленный посреди относительного перемещения (ROTATE_MOTOR), сначала
+ *        выводится в HOME, затем перемещение выполняется целиком.
+ * @return false, если задания нет или оно не на паузе.
+ */
+bool JobManager_ResumeJob(uint32_t job_id);
+
+/**
+ * @brief Количество заданий в работе и в очереди.
+ *        Задания ссылаются на программы рецептов во Flash, поэтому хранилище
+ *        рецептов уплотняется (recipe_flash.h) только при нулевом значении.
+ */
+uint16_t JobManager_GetActiveJobCount(void);
+
+/**
+ * @brief Снимок активных заданий (в работе, на паузе и в очереди) в порядке слотов,
+ *        начиная с first-го по счету.
+ * @param out_total Всего активных заданий.
+ * @return Число записанных снимков (не больше max_count).
+ */
+uint8_t JobManager_GetSnapshot(uint8_t first, JobSnapshot_t* out, uint8_t max_count, uint8_t* out_total);
 
-void JobManager_Run(void);
+/**
+ * @brief Количество отброшенных повторных/запоздавших ответов исполнителей.
+ */
+uint32_t JobManager_GetStaleResponseCount(void);
+
+/**
+ * @brief Статистика ожидания в очереди для класса приоритета.
+ */
+void JobManager_GetClassStats(JobPriority_t priority, JobClassStats_t* out_stats);
+
+/**
+ * @brief Обнуляет накопленную статистику ожидания (кроме текущей длины очереди).
+ */
+void JobManager_ResetClassStats(void);
+
+/**
+ * @brief Обрабатывает истекшие таймеры действий (окончания ожиданий и тайм-ауты).
+ * @return Через сколько мс наступит следующий срок, или JOB_MANAGER_NO_DEADLINE.
+ */
+uint32_t JobManager_Run(void);
 
 
 #endif /* INC_DISPATCHER_JOB_MANAGER_H_ */
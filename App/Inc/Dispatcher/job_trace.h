@@ -0,0 +1,133 @@
+/*
+ * job_trace.h
+ *
+ *  Created on: Mar 9, 2026
+ *      Author: andrey
+ */
+
+#ifndef INC_DISPATCHER_JOB_TRACE_H_
+#define INC_DISPATCHER_JOB_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_config.h"
+#include "Dispatcher/can_packer.h"
+
+/*
+ * Трасса входных событий JobManager'а для воспроизведения отказов.
+ *
+ * С загрузки (JobManager_Init) задача-владелец записывает каждое входное
+ * событие - пакет команды ПК, ответ исполнителя, обработку таймеров - с
+ * отметкой HAL_GetTick. Выходы (пакеты USB и кадры CAN) не записываются,
+ * а сворачиваются в CRC-32: младшие 16 бит текущего значения сохраняются в
+ * каждой записи, полное значение - в заголовке. Запись идет, пока буфер не
+ * заполнится или трасса не будет выгружена командой JOB_TRACE; после этого
+ * трасса заморожена до перезагрузки.
+ *
+ * Симулятор (App_sim, --replay) подает события трассы в ту же сборку
+ * диспетчера под Linux в тех же моменты времени и сверяет CRC выходов.
+ * Расхождение указывает на первое событие, после которого выходы отличаются.
+ *
+ * Формат: JobTraceHeader_t и записи. Запись: тип (1 байт), время от
+ * предыдущей записи в мс (LEB128), младшие 16 бит CRC выходов до события
+ * (Little-endian), данные по типу записи.
+ *
+ * APP_JOB_TRACE_BYTES = 0 выключает запись.
+ */
+
+#define JOB_TRACE_MAGIC             0x4352544Au // "JTRC"
+#define JOB_TRACE_VERSION           1
+#define JOB_TRACE_FLAG_TRUNCATED    0x0001      // Буфер заполнился: записана только первая часть работы
+
+typedef enum {
+	JOB_TRACE_COMMAND = 1,      // Пакет команды ПК: длина (LEB128), байты пакета
+	JOB_TRACE_RESPONSE,         // Ответ исполнителя: job_id (2 байта LE), executor_id, action_tag, status_ok
+	JOB_TRACE_TIMER,            // Обработка таймеров (JobInbox_RunTimers)
+	JOB_TRACE_TICK              // Время после паузы парсера между ACK и обработчиком команды
+} JobTraceType_t;
+
+/**
+ * @brief Заголовок трассы (Little-endian, как в памяти STM32 и x86).
+ *        Заполняется при остановке записи.
+ */
+typedef struct {
+	uint32_t magic;             // JOB_TRACE_MAGIC
+	uint16_t version;           // JOB_TRACE_VERSION
+	uint16_t flags;             // JOB_TRACE_FLAG_*
+	uint32_t config_crc;        // JobTrace_ConfigCrc() прошивки
+	uint32_t flash_crc;         // JobTrace_FlashCrc() при загрузке
+	uint32_t start_tick;        // HAL_GetTick() в JobManager_Init
+	uint32_t length;            // Байт записей после заголовка
+	uint32_t events;            // Записей
+	uint32_t output_crc;        // CRC-32 выходов на момент остановки
+	uint32_t crc;               // CRC-32 записей
+} JobTraceHeader_t;
+
+/**
+ * @brief Разобранная запись трассы.
+ */
+typedef struct {
+	uint32_t dt_ms;             // От предыдущей записи (первой - от start_tick)
+	uint16_t checkpoint;        // Младшие 16 бит CRC выходов до события
+	uint8_t  type;              // JobTraceType_t
+	uint16_t packet_len;        // JOB_TRACE_COMMAND
+	const uint8_t* packet;      // JOB_TRACE_COMMAND: указывает в буфер трассы
+	CAN_Response_t response;    // JOB_TRACE_RESPONSE
+} JobTraceEvent_t;
+
+/**
+ * @brief Начинает запись (из JobManager_Init).
+ */
+void JobTrace_Init(void);
+
+/**
+ * @brief Режим воспроизведения (симулятор): события не записываются,
+ *        CRC выходов считается с нуля.
+ */
+void JobTrace_StartReplay(void);
+
+// --- Входные события (вызываются владельцем до обработки события) ---
+void JobTrace_Command(const uint8_t* packet, uint16_t len);
+void JobTrace_Response(const CAN_Response_t* response);
+void JobTrace_Timer(void);
+
+/**
+ * @brief Отмечает время, если оно сдвинулось с предыдущей записи (пауза osDelay в парсере).
+ */
+void JobTrace_Tick(void);
+
+// --- Выходы владельца ---
+void JobTrace_Output(const void* data, uint16_t len);
+void JobTrace_OutputCan(const CAN_Message_t* msg);
+
+/**
+ * @brief Останавливает запись и заполняет заголовок. Повторный вызов ничего не меняет.
+ */
+void JobTrace_Stop(void);
+
+/**
+ * @brief Остановленная трасса: заголовок и записи.
+ * @return NULL, если запись выключена (APP_JOB_TRACE_BYTES = 0) или еще идет.
+ */
+const uint8_t* JobTrace_GetData(uint32_t* out_len);
+
+uint32_t JobTrace_GetOutputCrc(void);
+
+/**
+ * @brief Разбирает запись по адресу *pos и сдвигает *pos за нее.
+ * @return false, если записи кончились или запись повреждена.
+ */
+bool JobTrace_ReadEvent(const uint8_t** pos, const uint8_t* end, JobTraceEvent_t* out_event);
+
+/**
+ * @brief CRC-32 параметров сборки, от которых зависит поведение JobManager'а.
+ *        Трасса воспроизводится только сборкой с тем же значением.
+ */
+uint32_t JobTrace_ConfigCrc(void);
+
+/**
+ * @brief CRC-32 каталога загруженных рецептов (ID и CRC программ).
+ */
+uint32_t JobTrace_FlashCrc(void);
+
+#endif /* INC_DISPATCHER_JOB_TRACE_H_ */
@@ -0,0 +1,90 @@
+/*
+ * motion_profile.h
+ *
+ *  Created on: Mar 9, 2026
+ *      Author: andrey
+ */
+
+#ifndef INC_DISPATCHER_MOTION_PROFILE_H_
+#define INC_DISPATCHER_MOTION_PROFILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Dispatcher/can_packer.h"
+
+/*
+ * Профили движения моторов.
+ *
+ * Профиль - именованный набор параметров движения (скорость, ускорение, ток),
+ * общий для всех рецептов. Инструкции ROTATE_MOTOR и HOME_MOTOR ссылаются на него
+ * через поле speed: MOTION_PROFILE(n) вместо числа шагов/с. Число без флага
+ * по-прежнему задает только скорость, а ускорение и ток мотор сохраняет прежние.
+ *
+ * Исполнитель хранит параметры, примененные последними. Дирижер помнит их
+ * для каждого мотора и перед движением отправляет только отличающиеся
+ * CMD_SET_SPEED / CMD_SET_ACCELERATION / CMD_SET_CURRENT: повторные движения
+ * с тем же профилем уходят одним кадром команды.
+ */
+
+#define MOTION_PROFILE_FLAG     0x8000u
+#define MOTION_PROFILE(n)       ((uint16_t)(MOTION_PROFILE_FLAG | (n)))  // Значение поля speed инструкции
+#define MOTION_PROFILE_IS_REF(speed)   (((speed) & MOTION_PROFILE_FLAG) != 0)
+#define MOTION_PROFILE_INDEX(speed)    ((uint16_t)((speed) & ~MOTION_PROFILE_FLAG))
+
+#define MOTION_SETUP_FRAMES_MAX 3   // Скорость, ускорение, ток
+
+/**
+ * @brief Профили движения (номер - индекс в таблице g_profiles).
+ */
+typedef enum {
+    MOTION_PROFILE_CREEP = 0,       // Игла в жидкости: медленно и плавно
+    MOTION_PROFILE_HOME_FINE,       // Точный поиск "дома" иглы
+    MOTION_PROFILE_INDEX_STEP,      // Реакционный диск на одну кювету
+    MOTION_PROFILE_NORMAL,          // Игла над промывочной станцией, поиск "дома" дозатора
+    MOTION_PROFILE_TRAVEL,          // Поворот дозатора к пробирке
+    MOTION_PROFILE_FAST,            // Дальний поворот дозатора
+    MOTION_PROFILE_MIXER,           // Вращение мешалки
+    MOTION_PROFILE_COUNT
+} MotionProfileID_t;
+
+/**
+ * @brief Параметры профиля движения.
+ */
+typedef struct {
+    uint16_t speed;         // Шагов/с
+    uint16_t acceleration;  // Шагов/с^2
+    uint16_t current_ma;    // Рабочий ток, мА
+} MotionProfile_t;
+
+/**
+ * @brief Сбрасывает запомненные параметры всех моторов (из JobManager_Init):
+ *        первое движение каждого мотора отправит профиль целиком.
+ */
+void MotionProfile_Init(void);
+
+/**
+ * @brief Параметры профиля или NULL, если номера нет в таблице.
+ */
+const MotionProfile_t* MotionProfile_Get(uint16_t index);
+
+/**
+ * @brief Скорость движения по полю speed инструкции (профиль или число шагов/с).
+ */
+uint16_t MotionProfile_Speed(uint16_t speed);
+
+/**
+ * @brief Собирает кадры настройки мотора перед движением: только параметры,
+ *        отличающиеся от запомненных, и запоминает новые.
+ *
+ * @param speed Поле speed инструкции: MOTION_PROFILE(n) или скорость.
+ * @return Число кадров в out_frames (0 - мотор уже настроен).
+ */
+uint8_t MotionProfile_PrepareFrames(uint8_t motor_id, uint16_t speed, CAN_Message_t out_frames[MOTION_SETUP_FRAMES_MAX]);
+
+/**
+ * @brief Забывает параметры мотора: ошибка или тайм-аут действия, потерянный кадр.
+ *        Следующее движение отправит профиль целиком.
+ */
+void MotionProfile_Forget(uint8_t motor_id);
+
+#endif /* INC_DISPATCHER_MOTION_PROFILE_H_ */
@@ -0,0 +1,82 @@
+/*
+ * recipe_flash.h
+ *
+ *  Created on: Feb 9, 2026
+ *      Author: andrey
+ */
+
+#ifndef INC_DISPATCHER_RECIPE_FLASH_H_
+#define INC_DISPATCHER_RECIPE_FLASH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "recipe_store.h"
+
+/**
+ * @brief Запись рецепта во Flash. За заголовком (кратным Flash-слову) следует
+ *        программа из length инструкций. Запись с length == 0 удаляет рецепт.
+ */
+typedef struct {
+    uint32_t magic;              // RECIPE_FLASH_RECORD_MAGIC
+    uint8_t  recipe_id;
+    uint8_t  length;             // Инструкций в программе; 0 - рецепт удален
+    uint16_t reserved;
+    ResourceMask_t resources;    // Ресурсы, заявленные при загрузке
+    uint32_t crc;                // CRC-32 раскладки аргументов и программы
+    RecipeArgLayout_t args;
+    uint8_t  padding[12];
+} RecipeFlashRecord_t;
+
+_Static_assert(sizeof(RecipeFlashRecord_t) % 32 == 0, "Заголовок записи должен занимать целое число Flash-слов");
+
+typedef enum {
+    RECIPE_FLASH_OK = 0,
+    RECIPE_FLASH_FULL,           // Места нет, а уплотнить хранилище сейчас нельзя
+    RECIPE_FLASH_NOT_FOUND,
+    RECIPE_FLASH_WRITE_ERROR
+} RecipeFlashStatus_t;
+
+/**
+ * @brief Находит активный банк и строит каталог рецептов в RAM.
+ *        Вызывается один раз при старте, до первого задания.
+ */
+void RecipeFlash_Init(void);
+
+/**
+ * @brief Загруженный рецепт по ID за O(1) (каталог в RAM).
+ * @return NULL, если рецепт не загружался или удален.
+ */
+const RecipeFlashRecord_t* RecipeFlash_Find(uint8_t recipe_id);
+
+/**
+ * @brief Программа загруженного рецепта (сразу за заголовком записи).
+ */
+static inline const RecipeInstr_t* RecipeFlash_GetCode(const RecipeFlashRecord_t* record)
+{
+    return (const RecipeInstr_t*)(record + 1);
+}
+
+/**
+ * @brief Сохраняет рецепт (замещает ранее загруженный с тем же ID).
+ * @param allow_compaction Разрешить уплотнение, если банк заполнен. Уплотнение
+ *        стирает сектор, поэтому допустимо только без выполняющихся заданий.
+ */
+RecipeFlashStatus_t RecipeFlash_Store(uint8_t recipe_id, const RecipeInstr_t* code, uint8_t length,
+                                      ResourceMask_t resources, const RecipeArgLayout_t* args, bool allow_compaction);
+
+/**
+ * @brief Удаляет загруженный рецепт: встроенный рецепт с тем же ID снова становится доступен.
+ */
+RecipeFlashStatus_t RecipeFlash_Delete(uint8_t recipe_id, bool allow_compaction);
+
+/**
+ * @brief Свободное место в активном банке, байт.
+ */
+uint32_t RecipeFlash_GetFreeBytes(void);
+
+/**
+ * @brief CRC-32 (полином 0xEDB88320, как zlib.crc32). Для первого блока crc = 0.
+ */
+uint32_t RecipeFlash_Crc32(uint32_t crc, const void* data, uint32_t len);
+
+#endif /* INC_DISPATCHER_RECIPE_FLASH_H_ */
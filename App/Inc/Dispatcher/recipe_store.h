@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include "command_parser.h" // Для доступа к RecipeID_t
+#include "motion_profile.h"
 
 
 /**
@@ -26,6 +27,9 @@
  } ActionType_t;
 
 
+ #define RECIPE_MAX_ARGS     4                     // Слотов аргументов у одного задания
+ #define RECIPE_ARG(n)       ((uint8_t)((n) + 1))  // Ссылка на слот аргумента n; 0 - привязки нет
+
  /**
   * @brief Structure of "Atomic action" It describes one concrete action end its parameters.
   */
@@ -59,25 +63,181 @@
          } home_motor;
 
      } params;
- } AtomicAction_t; //
+
+     // Срок выполнения действия исполнителем, мс. 0 = APP_JOB_TIMEOUT_MS.
+     // Для ACTION_WAIT_MS не используется: действие завершается по delay_ms.
+     uint16_t timeout_ms;
+ } AtomicAction_t; // Действие, декодированное из инструкции рецепта с подставленными аргументами
 
   /**
-  * @brief Structure "Recipe step".
-  *        Представляет собой группу из одного или нескольких атомарных действий,
-  *        которые должны быть запущены одновременно.
+  * @brief Ресурсы анализатора, которые рецепт захватывает на время выполнения.
+  *        Задания с непересекающимися наборами ресурсов выполняются параллельно,
+  *        остальные ждут в очереди JobManager'а.
+  */
+ typedef uint32_t ResourceMask_t;
+
+ #define RES_MOTOR(id)       ((ResourceMask_t)1u << ((id) - 1))        // Моторы 1..12
+ #define RES_PUMP(id)        ((ResourceMask_t)1u << (12 + (id) - 1))   // Насосы 1..8
+ #define RES_VALVE(id)       ((ResourceMask_t)1u << (20 + (id) - 1))   // Клапаны 1..8
+ #define RES_PROBE           ((ResourceMask_t)1u << 28)                // Игла дозатора (датчик уровня)
+ #define RES_ALL             ((ResourceMask_t)0xFFFFFFFFu)             // Монопольный доступ ко всему анализатору
+ #define RES_MOTOR_COUNT     12
+ #define RES_PUMP_COUNT      8
+
+ // Модули анализатора
+ // Моторы и насосы дозаторов задаются привязкой к dispenser_id (см. APP_DISPENSER_COUNT)
+ #define RES_MODULE_WASH_STATION (RES_PUMP(3) | RES_VALVE(1) | RES_VALVE(2))            // Промывочная станция (насос 3: насосы 1..N - у дозаторов)
+ #define RES_MODULE_MIXER        (RES_MOTOR(9))                                         // Мешалка
+ #define RES_MODULE_REACTION_DISK (RES_MOTOR(10))                                       // Реакционный диск
+
+ /**
+  * @brief Коды инструкций байт-кода рецепта.
+  *
+  * Рецепт - программа из RecipeInstr_t, которую JobManager исполняет для каждого задания.
+  * Инструкция-действие вне блока PAR_BEGIN..PAR_END образует отдельный шаг; действия
+  * внутри блока запускаются одновременно, и программа продолжается, когда завершатся все.
+  * Блок может задать граф зависимостей (R_DAG_BEGIN): действие запускается, как только
+  * завершились его предшественники, а не все действия предыдущего шага.
+  * Адреса переходов - номера инструкций от начала программы.
+  */
+ typedef enum {
+     RECIPE_OP_END           = 0x00,                 // Конец программы: задание выполнено
+     // Действия: коды совпадают с ActionType_t
+     RECIPE_OP_ROTATE_MOTOR  = ACTION_ROTATE_MOTOR,  // device, value = шаги, speed (или профиль), timeout_ms
+     RECIPE_OP_START_PUMP    = ACTION_START_PUMP,    // device, timeout_ms
+     RECIPE_OP_STOP_PUMP     = ACTION_STOP_PUMP,     // device, timeout_ms
+     RECIPE_OP_WAIT_MS       = ACTION_WAIT_MS,       // value = задержка [мс]
+     RECIPE_OP_HOME_MOTOR    = ACTION_HOME_MOTOR,    // device, speed (или профиль), timeout_ms
+     // Управление
+     RECIPE_OP_PAR_BEGIN     = 0x10,                 // Начало группы действий; value = зависимости (RECIPE_AFTER) или 0
+     RECIPE_OP_PAR_END       = 0x11,                 // Ожидание завершения всех действий группы
+     RECIPE_OP_LOOP          = 0x12,                 // value = число проходов тела до END_LOOP
+     RECIPE_OP_END_LOOP      = 0x13,
+     RECIPE_OP_JUMP          = 0x14,                 // value = адрес
+     RECIPE_OP_JUMP_UNLESS_ARG = 0x15,               // Переход на value, если (args[val_bind] & device) == 0
+     RECIPE_OP_BRANCH_IF_FAIL = 0x16,                // Ошибка или таймаут следующего шага - переход на value вместо аварии
+ } RecipeOp_t;
+
+ #define RECIPE_OP_IS_ACTION(op)  ((op) >= RECIPE_OP_ROTATE_MOTOR && (op) <= RECIPE_OP_HOME_MOTOR)
+
+ #define RECIPE_MAX_LENGTH       255   // Инструкций в программе (адрес - uint8_t)
+ #define RECIPE_STORE_MAX_ID     32    // ID рецептов 1..31: встроенные (RecipeID_t) и загруженные (recipe_flash.h)
+ #define RECIPE_MAX_LOOP_DEPTH   2     // Вложенность циклов
+ #define RECIPE_PC_NONE          0xFF  // Нет адреса перехода
+ #define RECIPE_VALUE_SCALE      1000  // Значение с привязкой: args[n] * value / RECIPE_VALUE_SCALE
+
+ // Зависимости действий блока PAR: действие a (номер в блоке) стартует после завершения действия b < a.
+ // Маски предшественников упакованы треугольником: действию a отведены биты a*(a-1)/2 .. a*(a-1)/2 + a - 1
+ // (для 8 действий - 28 бит поля value).
+ #define RECIPE_AFTER(a, b)              ((int32_t)(1u << ((a) * ((a) - 1) / 2 + (b))))
+ #define RECIPE_DEPS_OF(deps, a)         ((uint8_t)(((uint32_t)(deps) >> ((a) * ((a) - 1) / 2)) & ((1u << (a)) - 1)))
+ #define RECIPE_DEPS_BITS(num_actions)   ((num_actions) * ((num_actions) - 1) / 2)
+
+ // Привязка номера устройства: device + (args[n] - 1) * stride (экземпляр модуля по номеру из команды)
+ #define RECIPE_BIND_DEVICE(n, stride)   ((uint8_t)((RECIPE_ARG(n) << 4) | ((stride) & 0x0F)))
+ #define RECIPE_BIND_ARG(bind)           ((uint8_t)((bind) >> 4))      // RECIPE_ARG(n) или 0
+ #define RECIPE_BIND_STRIDE(bind)        ((uint8_t)((bind) & 0x0F))
+
+ /**
+  * @brief Инструкция рецепта (12 байт).
   */
  typedef struct {
-     const AtomicAction_t* atomic_actions; // Указатель на массив атомарных действий
-     uint8_t num_actions;                  // Количество действий в этой группе (в шаге)
- } ProcessStep_t; //
+     uint8_t  op;          // RecipeOp_t
+     uint8_t  device;      // motor_id / pump_id; для JUMP_UNLESS_ARG - маска
+     uint8_t  dev_bind;    // RECIPE_BIND_DEVICE(n, stride) или 0
+     uint8_t  val_bind;    // RECIPE_ARG(n): value масштабирует аргумент n (см. RECIPE_VALUE_SCALE), 0 - value как есть
+     int32_t  value;       // Шаги, задержка, число проходов или адрес перехода
+     uint16_t speed;       // Скорость мотора или MOTION_PROFILE(n) (motion_profile.h)
+     uint16_t timeout_ms;  // Срок ответа исполнителя, 0 = APP_JOB_TIMEOUT_MS
+ } RecipeInstr_t;
+
+ _Static_assert(sizeof(RecipeInstr_t) == 12, "RecipeInstr_t must stay 12 bytes");
+
+ // Конструкторы инструкций для рецептов в recipe_store.c: { R_ROTATE(...), .dev_bind = ... }
+ #define R_ROTATE(motor, steps, spd, tmo)  .op = RECIPE_OP_ROTATE_MOTOR, .device = (motor), .value = (steps), .speed = (spd), .timeout_ms = (tmo)
+ #define R_HOME(motor, spd, tmo)           .op = RECIPE_OP_HOME_MOTOR, .device = (motor), .speed = (spd), .timeout_ms = (tmo)
+ #define R_ROTATE_P(motor, steps, prof, tmo) R_ROTATE(motor, steps, MOTION_PROFILE(MOTION_PROFILE_##prof), tmo)  // prof - имя профиля: TRAVEL, CREEP...
+ #define R_HOME_P(motor, prof, tmo)        R_HOME(motor, MOTION_PROFILE(MOTION_PROFILE_##prof), tmo)
+ #define R_PUMP_ON(pump, tmo)              .op = RECIPE_OP_START_PUMP, .device = (pump), .timeout_ms = (tmo)
+ #define R_PUMP_OFF(pump, tmo)             .op = RECIPE_OP_STOP_PUMP, .device = (pump), .timeout_ms = (tmo)
+ #define R_WAIT(ms)                        .op = RECIPE_OP_WAIT_MS, .value = (ms)
+ #define R_WAIT_ARG(n, scale)              .op = RECIPE_OP_WAIT_MS, .val_bind = RECIPE_ARG(n), .value = (scale)
+ #define R_PAR_BEGIN()                     .op = RECIPE_OP_PAR_BEGIN
+ #define R_DAG_BEGIN(deps)                 .op = RECIPE_OP_PAR_BEGIN, .value = (deps)
+ #define R_PAR_END()                       .op = RECIPE_OP_PAR_END
+ #define R_LOOP(count)                     .op = RECIPE_OP_LOOP, .value = (count)
+ #define R_LOOP_ARG(n)                     .op = RECIPE_OP_LOOP, .val_bind = RECIPE_ARG(n), .value = RECIPE_VALUE_SCALE
+ #define R_END_LOOP()                      .op = RECIPE_OP_END_LOOP
+ #define R_JUMP(pc)                        .op = RECIPE_OP_JUMP, .value = (pc)
+ #define R_JUMP_UNLESS_ARG(n, mask, pc)    .op = RECIPE_OP_JUMP_UNLESS_ARG, .val_bind = RECIPE_ARG(n), .device = (mask), .value = (pc)
+ #define R_BRANCH_IF_FAIL(pc)              .op = RECIPE_OP_BRANCH_IF_FAIL, .value = (pc)
+ #define R_END()                           .op = RECIPE_OP_END
+
+ /**
+  * @brief Поле бинарных параметров команды, декодируемое в слот аргумента задания.
+  */
+ typedef struct {
+     uint8_t offset;          // Смещение в бинарных параметрах команды
+     uint8_t size;            // 1, 2 или 4 байта, Big-endian
+     int32_t min_value;       // Допустимый диапазон значения
+     int32_t max_value;
+     int32_t default_value;   // Если параметров нет (INIT при старте, строковые команды)
+ } RecipeArgField_t;
+
+ /**
+  * @brief Раскладка аргументов рецепта: поле i декодируется в слот i.
+  */
+ typedef struct {
+     uint8_t count;
+     RecipeArgField_t fields[RECIPE_MAX_ARGS];
+ } RecipeArgLayout_t;
 
 
  /**
   * @brief API "Recipe store": return recipe according to its ID.
+  *        Рецепт, загруженный во Flash (RECIPE_UPLOAD), замещает встроенный с тем же ID.
   *
   * @param id Идентификатор рецепта (из command_parser.h).
-  * @return const ProcessStep_t* Указатель на первый шаг рецепта (во Flash).
+  * @param out_length Длина программы в инструкциях.
+  * @return const RecipeInstr_t* Указатель на программу рецепта (во Flash) или NULL.
+  */
+ const RecipeInstr_t* Recipe_Get(RecipeID_t id, uint8_t* out_length);
+
+ /**
+  * @brief Набор ресурсов, которые рецепт захватывает на время выполнения
+  *        помимо моторов и насосов своих действий (их JobManager добавляет сам,
+  *        уже с подставленными аргументами).
+  */
+ ResourceMask_t Recipe_GetResources(RecipeID_t id);
+
+ /**
+  * @brief Декодирует аргументы команды в слоты по раскладке рецепта.
+  *        Слоты, не описанные раскладкой, обнуляются.
+  *
+  * @return -1 при успехе, иначе номер поля со значением вне диапазона.
+  */
+ int Recipe_DecodeArgs(RecipeID_t id, const UniversalCommand_t* cmd, int32_t out_args[RECIPE_MAX_ARGS]);
+
+ /**
+  * @brief Проверяет загружаемый рецепт: коды инструкций, адреса переходов, блоки PAR
+  *        и циклы, раскладку аргументов и номера устройств при любых допустимых
+  *        значениях аргументов. Переход (JUMP, JUMP_UNLESS_ARG, BRANCH_IF_FAIL) не может
+  *        вести внутрь блока PAR, а также в тело другого цикла или из тела своего.
+  *
+  * @param out_reason Причина отказа (строка во Flash).
+  * @return -1, если рецепт корректен, иначе адрес ошибочной инструкции
+  *         (length - для ошибок раскладки и рецепта в целом).
+  */
+ int Recipe_Validate(const RecipeInstr_t* code, uint8_t length, const RecipeArgLayout_t* args, const char** out_reason);
+
+ /**
+  * @brief Проверяет встроенные рецепты тем же Recipe_Validate, что и загружаемые
+  *        (блоки PAR, число действий шага, переходы). Вызывается при старте до первого задания:
+  *        длина и покрытие ID проверяются при сборке, содержимое программ - только так.
+  *
+  * @return RECIPE_NONE, если все корректны, иначе ID первого ошибочного рецепта
+  *         (*out_pc и *out_reason - как у Recipe_Validate).
   */
- const ProcessStep_t* Recipe_Get(RecipeID_t id);
+ RecipeID_t Recipe_ValidateBuiltins(int* out_pc, const char** out_reason);
 
 #endif /* SRC_DISPATCHER_INC_RECIPE_STORE_H_ */
@@ -20,5 +20,11 @@ typedef enum {
 
  SystemState_t GetSystemState(void);
 
+/**
+ * @brief Будит задачу диспетчера, чтобы она обработала входящие события заданий
+ *        (JobInbox_Process) или принятые байты USB. Можно вызывать из любой задачи и из прерывания.
+ */
+void Dispatcher_Wakeup(void);
+
 #endif /* TASK_DISPATCHER_H_ */
 
@@ -8,6 +8,16 @@
 #ifndef INC_TASKS_TASK_JOBS_MONITOR_H_
 #define INC_TASKS_TASK_JOBS_MONITOR_H_
 
+#include <stdint.h>
+
 void app_start_task_jobs_monitor(void *argument);
 
+/**
+ * @brief Взводит монитор заданий: через next_deadline_ms он сообщит диспетчеру,
+ *        что срок наступил (JobInbox_PostTimer). Вызывается диспетчером после
+ *        обработки таймеров.
+ * @param next_deadline_ms Через сколько мс наступит срок, или JOB_MANAGER_NO_DEADLINE.
+ */
+void JobsMonitor_Arm(uint32_t next_deadline_ms);
+
 #endif /* INC_TASKS_TASK_JOBS_MONITOR_H_ */
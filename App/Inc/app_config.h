@@ -8,6 +8,17 @@
 #ifndef INC_APP_CONFIG_H_
 #define INC_APP_CONFIG_H_
 
+// --- Firmware & Protocol Version (GET_VERSION) ---
+#define APP_FW_VERSION_MAJOR           1
+#define APP_FW_VERSION_MINOR           4
+#ifndef APP_FW_BUILD
+#define APP_FW_BUILD                   0    // Номер сборки: задается сборочным скриптом (-DAPP_FW_BUILD=N)
+#endif
+#ifndef APP_FW_BUILD_DATE
+#define APP_FW_BUILD_DATE              "20260309" // YYYYMMDD, ровно 8 символов
+#endif
+#define APP_PROTOCOL_VERSION           1    // Версия протокола USB: меняется при несовместимых изменениях формата
+
 // --- Queue & Message Buffer Sizes ---
 #define APP_USB_RX_QUEUE_LENGTH        10   // Количество элементов в очереди USB RX
 #define APP_USB_TX_QUEUE_LENGTH        10   // Количество элементов в очереди USB TX
@@ -21,12 +32,43 @@
 #define APP_LOG_MESSAGE_MAX_LEN        128  // Максимальная длина сообщения для Логгера (включая null-терминатор)
 
 // --- Job Manager Configuration ---
-#define APP_MAX_ACTIVE_JOBS            5    // Максимальное количество одновременно активных "проектов"
-#define APP_JOB_TIMEOUT_MS             5000 // Тайм-аут для шага "проекта" в миллисекундах (5 секунд)
+#define APP_MAX_ACTIVE_JOBS            64   // Максимальное количество одновременно активных "проектов" (не больше 64: см. job_manager.c)
+#define APP_JOB_TIMEOUT_MS             5000 // Тайм-аут действия по умолчанию (если в рецепте не задан свой), мс
+#define APP_MAX_STEP_ACTIONS           8    // Максимум параллельных действий в одном шаге рецепта
+#define APP_JOB_AGING_MS               30000 // Каждые N мс ожидания в очереди задание поднимается на один класс приоритета
+#define APP_DISPENSER_COUNT            2    // Дозаторов в анализаторе: дозатор N - моторы 2N-1 (поворот) и 2N (игла), насос N
+#define APP_CYCLE_MS                   15000 // Машинный цикл по умолчанию (CYCLE START без параметра): 240 тестов/ч
+#define APP_JOB_HISTORY_DEPTH          16   // Завершенных заданий в истории (JOB_HISTORY)
+#define APP_JOB_HISTORY_MAX_STEPS      12   // Разных шагов рецепта в записи истории: запись занимает 24 + 12 * N байт
+#define APP_JOB_INBOX_DEPTH            32   // Ответов исполнителей в очереди к задаче диспетчера (степень двойки)
+#define APP_HOST_SEQ_CACHE             16   // Команд ПК с номером, ответы которых повторяются без выполнения (12 байт на команду)
+#define APP_ACTION_FRAMES_CACHE        64   // Инструкций-действий с готовыми кадрами CAN (степень двойки, 24 байта на строку)
+#ifndef APP_JOB_TRACE_BYTES
+#define APP_JOB_TRACE_BYTES            0    // Буфер трассы входных событий JobManager'а (JOB_TRACE); 0 - запись выключена
+#endif
+
+// Имитация ответов исполнителей: JobManager считает CAN-действие выполненным сразу после отправки.
+// 1 - пока исполнители не присылают ответы с тегом задания (прошивка на плате).
+// 0 - ответы приходят по CAN (реальные исполнители или симулятор шины App_sim).
+#ifndef APP_SIMULATE_EXECUTOR_RESPONSES
+#define APP_SIMULATE_EXECUTOR_RESPONSES 1
+#endif
 
 // Максимальный размер бинарных параметров для одной команды
 #define MAX_BINARY_ARGS_SIZE 64
 
+// --- Recipe Flash Store ---
+// Загруженные рецепты хранятся в двух последних секторах Flash (по очереди, см. recipe_flash.c).
+// Секторы исключены из области FLASH в STM32H723ZGTX_FLASH.ld.
+#define APP_RECIPE_FLASH_FIRST_SECTOR  6    // Секторы 6 и 7: 0x080C0000 - 0x080FFFFF
+
+// --- Memory Placement ---
+// Горячие таблицы диспетчера (задания, таймеры) размещаются в DTCM: секция .dtcm_bss в *.ld.
+// Секция NOLOAD - стартап ее не обнуляет, таблицы инициализируются в *_Init() своих модулей.
+#ifndef APP_DTCM_BSS
+#define APP_DTCM_BSS __attribute__((section(".dtcm_bss")))
+#endif
+
 
 // --- Task Stack Sizes (in words, CubeMX генерирует * 4 байта) ---
 // Эти значения задаются в CubeMX, но могут быть переопределены или использованы здесь для ясности
@@ -35,7 +77,7 @@
 // #define APP_TASK_USB_HANDLER_STACK_SIZE    256
 // #define APP_TASK_DISPATCHER_STACK_SIZE     512
 // #define APP_TASK_WATCHDOG_STACK_SIZE       128
-// #define APP_TASK_JOBS_MONITOR_STACK_SIZE   128
+// #define APP_TASK_JOBS_MONITOR_STACK_SIZE   128 // Монитор только отправляет JobInbox_PostTimer, шаги выполняет диспетчер
 // #define APP_TASK_LOGGER_STACK_SIZE         256
 
 // --- Task Priorities (CMSIS-OS v2) ---
@@ -0,0 +1,38 @@
+/*
+ * flash_storage.h
+ *
+ *  Created on: Feb 9, 2026
+ *      Author: andrey
+ */
+
+#ifndef INC_FLASH_STORAGE_H_
+#define INC_FLASH_STORAGE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// --- Низкоуровневый доступ к секторам Flash под хранилище рецептов ---
+// На плате реализован через HAL (flash_storage.c), в App_sim - массивом в RAM.
+
+#define FLASH_STORAGE_BANK_COUNT    2             // Хранилище занимает два сектора ("банка")
+#define FLASH_STORAGE_BANK_SIZE     (128u * 1024u) // Размер сектора STM32H723
+#define FLASH_STORAGE_WORD_SIZE     32u           // Flash-слово: минимальная единица записи, пишется один раз после стирания
+
+/**
+ * @brief Адрес начала банка для чтения (Flash отображена в адресное пространство).
+ */
+const uint8_t* FlashStorage_GetBank(uint8_t bank);
+
+/**
+ * @brief Стирает банк целиком (все байты становятся 0xFF).
+ */
+bool FlashStorage_EraseBank(uint8_t bank);
+
+/**
+ * @brief Записывает одно Flash-слово.
+ * @param offset Смещение от начала банка, кратно FLASH_STORAGE_WORD_SIZE.
+ * @param data   FLASH_STORAGE_WORD_SIZE байт, выровненных на 4.
+ */
+bool FlashStorage_ProgramWord(uint8_t bank, uint32_t offset, const uint32_t* data);
+
+#endif /* INC_FLASH_STORAGE_H_ */
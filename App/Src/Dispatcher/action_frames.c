@@ -0,0 +1,88 @@
+/*
+ * action_frames.c
+ *
+ *  Created on: Mar 9, 2026
+ *      Author: andrey
+ */
+
+#include "Dispatcher/action_frames.h"
+#include <stddef.h>
+#include <string.h>
+
+#if (ACTION_FRAMES_CACHE_SIZE & (ACTION_FRAMES_CACHE_SIZE - 1)) != 0
+#error "APP_ACTION_FRAMES_CACHE must be a power of two"
+#endif
+
+typedef struct {
+	const RecipeInstr_t* instr;     // NULL - строка свободна
+	ActionFrames_t frames;
+} ActionFramesLine_t;
+
+// --- Внутренние переменные ---
+static ActionFramesLine_t g_cache[ACTION_FRAMES_CACHE_SIZE] APP_DTCM_BSS;
+
+// --- Внутренние функции ---
+
+/**
+ * @brief Собирает кадр инструкции с номером устройства и значением из самой инструкции.
+ */
+static void ActionFrames_Build(const RecipeInstr_t* instr, ActionFrames_t* out)
+{
+	memset(out, 0, sizeof(*out));
+	out->has_frame = true;
+	switch (instr->op) {
+		case RECIPE_OP_ROTATE_MOTOR:
+			Packer_CreateRotateMotorMsg(instr->device, instr->value, CAN_JOB_TAG_NONE, 0, &out->frame);
+			out->value_slot = true;
+			break;
+		case RECIPE_OP_HOME_MOTOR:
+			Packer_CreateHomeMotorMsg(instr->device, CAN_JOB_TAG_NONE, 0, &out->frame);
+			break;
+		case RECIPE_OP_START_PUMP:
+			Packer_CreateStartPumpMsg(instr->device, CAN_JOB_TAG_NONE, 0, &out->frame);
+			break;
+		case RECIPE_OP_STOP_PUMP:
+			Packer_CreateStopPumpMsg(instr->device, CAN_JOB_TAG_NONE, 0, &out->frame);
+			break;
+		default:
+			out->has_frame = false;
+			break;
+	}
+}
+
+static ActionFramesLine_t* ActionFrames_Line(const RecipeInstr_t* instr)
+{
+	return &g_cache[((uintptr_t)instr / sizeof(RecipeInstr_t)) & (ACTION_FRAMES_CACHE_SIZE - 1)];
+}
+
+// --- API функции ---
+
+void ActionFrames_Init(void)
+{
+	ActionFrames_Invalidate();
+	for (uint8_t id = RECIPE_NONE + 1; id < RECIPE_STORE_MAX_ID; id++) {
+		uint8_t length = 0;
+		const RecipeInstr_t* code = Recipe_Get((RecipeID_t)id, &length);
+		for (uint8_t pc = 0; code != NULL && pc < length; pc++) {
+			if (RECIPE_OP_IS_ACTION(code[pc].op)) {
+				ActionFrames_Get(&code[pc]);
+			}
+		}
+	}
+}
+
+void ActionFrames_Invalidate(void)
+{
+	// Кэш лежит в NOLOAD-секции: очищается явно
+	memset(g_cache, 0, sizeof(g_cache));
+}
+
+const ActionFrames_t* ActionFrames_Get(const RecipeInstr_t* instr)
+{
+	ActionFramesLine_t* line = ActionFrames_Line(instr);
+	if (line->instr != instr) {
+		ActionFrames_Build(instr, &line->frames);
+		line->instr = instr;
+	}
+	return &line->frames;
+}
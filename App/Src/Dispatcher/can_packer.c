@@ -6,45 +6,93 @@
  */
 
 #include "Dispatcher/can_packer.h"
+#include "Dispatcher/command_protocol.h"
 #include <string.h> // Для memset
 #include <stdbool.h>
+#include <stddef.h> // Для NULL
 
+// Вспомогательная функция: заполняет кадр команды по формату из can_packer.h
+static void pack_command(uint8_t executor_id, uint8_t device_id, uint8_t command,
+                         int32_t payload, uint32_t job_id, uint8_t action_tag, CAN_Message_t* out_msg)
+{
+	memset(out_msg, 0, sizeof(CAN_Message_t));
+	out_msg->id = CAN_ID_COMMAND_BASE | ((uint32_t)(executor_id & 0x0F) << 4);
+	out_msg->dlc = 8;
 
+	out_msg->data[0] = command;
+	Packer_SetDevice(out_msg, device_id);
+	Packer_SetPayload(out_msg, payload);
+	Packer_SetJobTag(out_msg, job_id, action_tag);
+}
 
-void Packer_CreateRotateMotorMsg(uint8_t motor_id, int32_t steps, uint16_t speed, uint32_t job_id, CAN_Message_t* out_msg)
+void Packer_CreateRotateMotorMsg(uint8_t motor_id, int32_t steps, uint32_t job_id, uint8_t action_tag, CAN_Message_t* out_msg)
 {
-	// Заглушка: Просто очищаем сообщение
-	memset(out_msg, 0, sizeof(CAN_Message_t));
-    // В реальной реализации здесь будет формирование ID и байтов данных
-    // out_msg->id = (uint32_t)motor_id << 24 | (CAN_CMD_ROTATE_MOTOR << 16) | (job_id & 0xFFFF);
-    // out_msg->data[0] = (uint8_t)(steps >> 24);
-    // и так далее...
+	pack_command(CAN_EXECUTOR_MOTORS, motor_id, CMD_MOVE_RELATIVE, steps, job_id, action_tag, out_msg);
 }
 
-void Packer_CreateStartPumpMsg(uint8_t pump_id, uint32_t job_id, CAN_Message_t* out_msg)
+void Packer_CreateSetSpeedMsg(uint8_t motor_id, uint16_t speed, CAN_Message_t* out_msg)
 {
-	memset(out_msg, 0, sizeof(CAN_Message_t));
+	pack_command(CAN_EXECUTOR_MOTORS, motor_id, CMD_SET_SPEED, speed, CAN_JOB_TAG_NONE, 0, out_msg);
 }
 
-void Packer_CreateStopPumpMsg(uint8_t pump_id, uint32_t job_id, CAN_Message_t* out_msg)
+void Packer_CreateSetAccelerationMsg(uint8_t motor_id, uint16_t acceleration, CAN_Message_t* out_msg)
 {
-	memset(out_msg, 0, sizeof(CAN_Message_t));
+	pack_command(CAN_EXECUTOR_MOTORS, motor_id, CMD_SET_ACCELERATION, acceleration, CAN_JOB_TAG_NONE, 0, out_msg);
 }
 
-void Packer_CreateHomeMotorMsg(uint8_t motor_id, uint16_t speed, uint32_t job_id, CAN_Message_t* out_msg)
+void Packer_CreateSetCurrentMsg(uint8_t motor_id, uint16_t current_ma, CAN_Message_t* out_msg)
 {
-	memset(out_msg, 0, sizeof(CAN_Message_t));
+	pack_command(CAN_EXECUTOR_MOTORS, motor_id, CMD_SET_CURRENT, current_ma, CAN_JOB_TAG_NONE, 0, out_msg);
+}
+
+void Packer_CreateStopMotorMsg(uint8_t motor_id, CAN_Message_t* out_msg)
+{
+	pack_command(CAN_EXECUTOR_MOTORS, motor_id, CMD_STOP, 0, CAN_JOB_TAG_NONE, 0, out_msg);
 }
 
-// --- Заглушка для функции-распаковщика ---
+void Packer_CreateStartPumpMsg(uint8_t pump_id, uint32_t job_id, uint8_t action_tag, CAN_Message_t* out_msg)
+{
+	pack_command(CAN_EXECUTOR_PUMPS, pump_id, CMD_SET_PUMP_STATE, 1, job_id, action_tag, out_msg);
+}
+
+void Packer_CreateStopPumpMsg(uint8_t pump_id, uint32_t job_id, uint8_t action_tag, CAN_Message_t* out_msg)
+{
+	pack_command(CAN_EXECUTOR_PUMPS, pump_id, CMD_SET_PUMP_STATE, 0, job_id, action_tag, out_msg);
+}
+
+void Packer_CreateHomeMotorMsg(uint8_t motor_id, uint32_t job_id, uint8_t action_tag, CAN_Message_t* out_msg)
+{
+	pack_command(CAN_EXECUTOR_MOTORS, motor_id, CMD_HOME, 0, job_id, action_tag, out_msg);
+}
+
+void Packer_CreateGetTemperatureMsg(uint8_t sensor_id, uint32_t job_id, uint8_t action_tag, CAN_Message_t* out_msg)
+{
+	pack_command(CAN_EXECUTOR_THERMO, 0, CMD_GET_TEMPERATURE, sensor_id, job_id, action_tag, out_msg);
+}
+
+// --- Функция-распаковщик ---
 
 bool Packer_ParseCanResponse(const CAN_Message_t* in_msg, CAN_Response_t* out_response)
 {
-	// Заглушка: Пока всегда возвращаем "успех" для тестовых целей
-    if (out_response != NULL) {
-    	out_response->job_id = 0; // Пример
-        out_response->executor_id = 0; // Пример
-        out_response->status_ok = true;
-        }
-   return true;
+	if (in_msg == NULL || out_response == NULL) {
+		return false;
+		}
+	if ((in_msg->id & CAN_ID_TYPE_MASK) != CAN_ID_RESPONSE_BASE || in_msg->dlc < 8) {
+		return false; // Это не ответ исполнителя
+		}
+
+	out_response->executor_id = (uint8_t)((in_msg->id >> 4) & 0x0F);
+	out_response->device_id   = (uint8_t)(in_msg->id & 0x0F);
+	out_response->command     = in_msg->data[0];
+	out_response->error_code  = in_msg->data[1];
+	out_response->status_ok   = (in_msg->data[1] == 0);
+	// Данные ответа: 24-битное знаковое значение, Little Endian
+	int32_t value = (int32_t)in_msg->data[2] | ((int32_t)in_msg->data[3] << 8) | ((int32_t)in_msg->data[4] << 16);
+	if (value & 0x00800000) {
+		value |= (int32_t)0xFF000000;
+		}
+	out_response->value  = value;
+	out_response->job_id = (uint32_t)in_msg->data[5] | ((uint32_t)in_msg->data[6] << 8);
+	out_response->action_tag = in_msg->data[7];
+	return true;
 }
@@ -2,6 +2,8 @@
 #include "command_parser.h"
 #include "dispatcher_io.h"
 #include "job_manager.h"
+#include "job_trace.h"
+#include "host_seq.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdbool.h>
@@ -15,14 +17,16 @@ const RecipeCommandDescriptor_t recipe_command_table[] = {
 		{.command_code = 0x1002, // Код команды INIT
 		 .min_params_len = 1,
 		 .max_params_len = 1,
-		 .recipe_id = RECIPE_INITIALIZE_SYSTEM // ID рецепта INIT
+		 .recipe_id = RECIPE_INITIALIZE_SYSTEM, // ID рецепта INIT
+		 .priority = JOB_PRIORITY_STAT // Без инициализации остальная работа невозможна
 		 },
 
 		 //DISPENSER_WASH descriptor:
 		 {.command_code = 0x2000, // Код команды DISPENSER_WASH
 		  .min_params_len = 4,   // dispenser_id (1) + volume (2) + cycles (1) = 4 байта
 		  .max_params_len = 4,   //
-		  .recipe_id = RECIPE_DISPENSER_WASH // ID рецепта DISPENSER_WASH
+		  .recipe_id = RECIPE_DISPENSER_WASH, // ID рецепта DISPENSER_WASH
+		  .priority = JOB_PRIORITY_MAINTENANCE // Промывка заполняет простои
 		 },
 
 
@@ -53,6 +57,84 @@ const DirectCommandDescriptor_t direct_command_table[] = {
 				.handler = handle_get_status // Указатель на наш обработчик
 				},
 
+		{
+				.command_code = 0x1003, // Код команды GET_VERSION
+				.min_params_len = 0,
+				.max_params_len = 0,
+				.handler = handle_get_version
+				},
+
+		{
+				.command_code = 0x1006, // Код команды GET_QUEUE_STATS
+				.min_params_len = 0,
+				.max_params_len = 1,    // Необязательный флаг сброса статистики
+				.handler = handle_get_queue_stats
+				},
+
+		{
+				.command_code = 0x1007, // Код команды RECIPE_UPLOAD
+				.min_params_len = 1,    // Фаза загрузки и ее данные
+				.max_params_len = MAX_BINARY_ARGS_SIZE,
+				.handler = handle_recipe_upload
+				},
+
+		{
+				.command_code = 0x1008, // Код команды RECIPE_LIST
+				.min_params_len = 0,
+				.max_params_len = 0,
+				.handler = handle_recipe_list
+				},
+
+		{
+				.command_code = 0x1009, // Код команды RECIPE_DELETE
+				.min_params_len = 1,    // ID рецепта
+				.max_params_len = 1,
+				.handler = handle_recipe_delete
+				},
+
+		{
+				.command_code = 0x100A, // Код команды RECIPE_RUN
+				.min_params_len = 2,    // ID рецепта, приоритет, аргументы рецепта
+				.max_params_len = MAX_BINARY_ARGS_SIZE,
+				.starts_job = true,     // DONE - по завершении задания, как у команды-рецепта
+				.handler = handle_recipe_run
+				},
+
+		{
+				.command_code = 0x100B, // Код команды CYCLE
+				.min_params_len = 1,    // Операция и ее параметры
+				.max_params_len = 3,
+				.handler = handle_cycle
+				},
+
+		{
+				.command_code = 0x100C, // Код команды JOB_CONTROL
+				.min_params_len = 3,    // Операция, ID задания
+				.max_params_len = 3,
+				.handler = handle_job_control
+				},
+
+		{
+				.command_code = 0x100D, // Код команды JOB_LIST
+				.min_params_len = 0,    // [first]
+				.max_params_len = 1,
+				.handler = handle_job_list
+				},
+
+		{
+				.command_code = 0x100E, // Код команды JOB_HISTORY
+				.min_params_len = 0,    // [after_seq]
+				.max_params_len = 4,
+				.handler = handle_job_history
+				},
+
+		{
+				.command_code = 0x100F, // Код команды JOB_TRACE
+				.min_params_len = 0,    // [offset]
+				.max_params_len = 4,
+				.handler = handle_job_trace
+				},
+
 	   // Здесь будут добавляться другие прямые команды
 
 				};
@@ -117,6 +199,7 @@ void Parser_ProcessCommand(char *command_line)
         if (strcmp(command_word, command_table[i].command_string) == 0) {
             UniversalCommand_t cmd;
             cmd.recipe_id = command_table[i].recipe_id;
+            cmd.priority = JOB_PRIORITY_ROUTINE;
 
             CommandStatus_t status = command_table[i].arg_processor(arguments, &cmd);
 
@@ -174,37 +257,21 @@ static uint8_t calculate_crc_parser(const uint8_t* data, uint16_t length) {
     return crc;
 }
 
-void Parser_ProcessBinaryCommand(uint8_t *packet, uint16_t len)
+/**
+ * @brief Выполняет команду пакета с проверенной CRC: поиск в таблицах дескрипторов, ACK и обработчик или задание.
+ */
+static void Parser_ExecuteBinaryCommand(uint16_t command_code, const uint8_t *params, uint16_t params_len)
 {
-    if (len < 8) return;
-
-    uint16_t payload_len = (uint16_t)(packet[3] << 8) | packet[4];
-    uint16_t command_code = (uint16_t)(packet[5] << 8) | packet[6];
-    uint16_t total_packet_len = 3 + 2 + payload_len;
-
-    if (total_packet_len != len) return;
-
-    uint16_t crc_data_len = payload_len - 1;
-    uint8_t calculated_crc = calculate_crc_parser(&packet[5], crc_data_len);
-    uint8_t received_crc = packet[len - 1];
-
-    if (calculated_crc != received_crc) {
-        Dispatcher_SendNack(command_code, 0x0002);
-        return;
-    }
-
     UniversalCommand_t cmd;
     cmd.recipe_id = RECIPE_NONE;
 
-    uint16_t params_len = crc_data_len - 2;
-
     if (params_len > 0) {
         if (params_len > MAX_BINARY_ARGS_SIZE) {
              Dispatcher_SendError(command_code, 0x0005);
              return;
         }
         cmd.args_type = ARGS_TYPE_BINARY;
-        memcpy(cmd.args.binary.raw, &packet[7], params_len);
+        memcpy(cmd.args.binary.raw, params, params_len);
         cmd.args.binary.len = params_len;
     } else {
         cmd.args_type = ARGS_TYPE_NONE;
@@ -218,7 +285,7 @@ void Parser_ProcessBinaryCommand(uint8_t *packet, uint16_t len)
    * При совпадении command_code выполняется проверка params_len на соответствие min_params_len и max_params_len. В случае несовпадения
      отправляется NACK и функция завершается.
    * Если проверка пройдена, вызывается соответствующий обработчик из direct_command_table[i].handler, и функция
-     Parser_ProcessBinaryCommand завершается.
+     Parser_ExecuteBinaryCommand завершается.
    * Если команда не найдена в direct_command_table, поиск продолжается в recipe_command_table.
      *
      */
@@ -238,9 +305,10 @@ void Parser_ProcessBinaryCommand(uint8_t *packet, uint16_t len)
     		//Отправляем ACK
     		Dispatcher_SendAck(command_code);
     		osDelay(1); //CPU, чтобы позволить обработчику USB отправить ACK до старта Job'а
+    		JobTrace_Tick();
 
     		// Вызываем обработчик прямой команды
-    		direct_command_table[i].handler(command_code, &packet[7], params_len);
+    		direct_command_table[i].handler(command_code, params, params_len);
     		return; // Команда обработана, выходим из функции
     		}
     	}
@@ -257,7 +325,7 @@ void Parser_ProcessBinaryCommand(uint8_t *packet, uint16_t len)
        * Выполняем проверку длины параметров, используя min_params_len и max_params_len из дескриптора. Если длина некорректна,
          отправляем NACK и выходим.
        * Запускаем JobManager_StartNewJob(&cmd).
-       * После успешного запуска или обработки ошибки, мы выходим из Parser_ProcessBinaryCommand, так как команда обработана.
+       * После успешного запуска или обработки ошибки, мы выходим из Parser_ExecuteBinaryCommand, так как команда обработана.
    * Если цикл завершился, и команда не была найдена в recipe_command_table, выполнение продолжится после этого блока, где пока еще
      находится старый switch.
      *
@@ -269,6 +337,7 @@ void Parser_ProcessBinaryCommand(uint8_t *packet, uint16_t len)
     		// Command found in recipe table
     		cmd.command_code = command_code;  // <-- Добавлено поле command_code 22.01.2026
     		cmd.recipe_id = recipe_command_table[i].recipe_id;
+    		cmd.priority = recipe_command_table[i].priority;
 
     		// Parameter length validation
     		if (params_len < recipe_command_table[i].min_params_len ||
@@ -280,10 +349,11 @@ void Parser_ProcessBinaryCommand(uint8_t *packet, uint16_t len)
     		//Отправляем ACK
     		Dispatcher_SendAck(command_code);
     		osDelay(1); // Уступаем CPU, чтобы позволить обработчику USB отправить ACK до старта Job'а
+    		JobTrace_Tick();
 
     		// Start JobManager to execute the recipe
     		if (JobManager_StartNewJob(&cmd) == 0) {
-    			Dispatcher_SendError(command_code, 0x0004); // ERR_JOB_FAILED_TO_START
+    			Dispatcher_SendError(command_code, 0x0004); // ERR_BUSY: нет свободных слотов заданий
     			}
     		return; // Command processed, exit function
     		}
@@ -295,3 +365,44 @@ void Parser_ProcessBinaryCommand(uint8_t *packet, uint16_t len)
     return;
 }
 
+void Parser_ProcessBinaryCommand(uint8_t *packet, uint16_t len)
+{
+    JobTrace_Command(packet, len); // До проверок: NACK тоже выход, который сверяется при воспроизведении
+
+    // "CS>": перед кодом команды номер seq(2), повторы с тем же номером не выполняются (host_seq.h)
+    const bool sequenced = (packet[1] == 0x53);
+    const uint16_t code_offset = sequenced ? 7 : 5;
+
+    if (len < code_offset + 3) return;
+
+    uint16_t payload_len = (uint16_t)(packet[3] << 8) | packet[4];
+    uint16_t command_code = (uint16_t)(packet[code_offset] << 8) | packet[code_offset + 1];
+    uint16_t total_packet_len = 3 + 2 + payload_len;
+
+    if (total_packet_len != len) return;
+
+    uint16_t crc_data_len = payload_len - 1;
+    uint8_t calculated_crc = calculate_crc_parser(&packet[5], crc_data_len);
+    uint8_t received_crc = packet[len - 1];
+
+    if (calculated_crc != received_crc) {
+        // Номеру в испорченном пакете верить нельзя: NACK без номера, ПК повторит команду с тем же номером
+        Dispatcher_SendNack(command_code, 0x0002);
+        return;
+    }
+
+    const uint8_t *params = &packet[code_offset + 2];
+    uint16_t params_len = len - code_offset - 3;
+
+    if (!sequenced) {
+        Parser_ExecuteBinaryCommand(command_code, params, params_len);
+        return;
+    }
+
+    uint16_t seq = (uint16_t)(packet[5] << 8) | packet[6];
+    if (HostSeq_Begin(seq, command_code, received_crc)) {
+        Parser_ExecuteBinaryCommand(command_code, params, params_len);
+        HostSeq_End();
+    }
+}
+
@@ -0,0 +1,420 @@
+/*
+ * cycle_scheduler.c
+ *
+ *  Created on: Mar 2, 2026
+ *      Author: andrey
+ */
+
+#include "Dispatcher/cycle_scheduler.h"
+#include "Dispatcher/job_manager.h"
+#include "Dispatcher/dispatcher_io.h"
+#include "Dispatcher/job_inbox.h"
+#include "Dispatcher/action_frames.h"
+#include "app_config.h"
+#include <string.h>
+#include <stdio.h>
+#include "main.h" // Для HAL_GetTick()
+
+/**
+ * @brief Слот модуля в машинном цикле: рецепт, который модуль выполняет над
+ *        кюветой теста на позиции stage.
+ */
+typedef struct {
+	const char* name;
+	uint8_t  stage;             // Позиция теста на диске: циклов после поступления (0 - дозирование образца)
+	uint8_t  recipe_id;         // RecipeID_t
+	uint8_t  args[4];           // Аргументы рецепта, как в RECIPE_RUN
+	uint8_t  args_len;
+	uint16_t slot_ms;           // Бюджет слота от конца поворота диска
+	bool     always;            // Выполняется и для теста с ошибкой (кювету нужно промыть)
+} CycleStage_t;
+
+static const CycleStage_t k_cycle_stages[] = {
+	{ .name = "SAMPLE",  .stage = 0, .recipe_id = RECIPE_ASPIRATE, .args = { 1 }, .args_len = 1, .slot_ms = 9000 },          // Дозатор 1: образец
+	{ .name = "REAGENT", .stage = 1, .recipe_id = RECIPE_ASPIRATE, .args = { 2 }, .args_len = 1, .slot_ms = 9000 },          // Дозатор 2: реагент
+	{ .name = "MIX",     .stage = 2, .recipe_id = RECIPE_MIXER_MIX, .args = { 0x07, 0xD0 }, .args_len = 2, .slot_ms = 2500 }, // 2000 мс
+	{ .name = "WASH",    .stage = CYCLE_PIPELINE_DEPTH - 1, .recipe_id = RECIPE_CUVETTE_WASH, .slot_ms = 2000, .always = true }, // После измерения
+};
+
+#define CYCLE_STAGE_COUNT   ((uint8_t)(sizeof(k_cycle_stages) / sizeof(k_cycle_stages[0])))
+#define CYCLE_MAX_SLOTS     (CYCLE_STAGE_COUNT + 1)   // Слоты модулей и поворот диска
+#define CYCLE_SLOT_DISK     0xFF                      // stage_index слота поворота диска (всегда слот 0)
+
+typedef struct {
+	uint16_t test_no;           // Номер теста по порядку поступления; 0 - кювета пуста
+	bool     failed;            // Слот теста завершился ошибкой: остальные слоты, кроме промывки, пропускаются
+} CycleCuvette_t;
+
+typedef struct {
+	uint32_t done_ms;
+	uint8_t  stage_index;       // Номер в k_cycle_stages или CYCLE_SLOT_DISK
+	bool     started;
+	bool     done;
+	bool     failed;
+} CycleSlot_t;
+
+// --- Внутренние переменные ---
+static CycleCuvette_t g_disk[CYCLE_PIPELINE_DEPTH];  // Позиция k: тест, поступивший k циклов назад
+static CycleSlot_t g_slots[CYCLE_MAX_SLOTS];         // Слоты текущего цикла
+static uint8_t g_slot_count = 0;
+static CycleSlot_t g_next_slots[CYCLE_MAX_SLOTS];    // План следующего цикла
+static uint8_t g_next_slot_count = 0;
+static bool g_next_admits = false;                   // В следующем цикле на диск поступает тест из очереди
+static bool g_next_planned = false;                  // План актуален (сбрасывается заказом, остановкой и ошибкой слота)
+static bool g_cycle_active = false;
+static uint32_t g_cycle_start_ms = 0;
+static uint32_t g_stations_start_ms = 0;             // Конец поворота диска: начало слотов модулей
+static uint16_t g_queued = 0;
+static uint16_t g_next_test_no = 1;
+static uint16_t g_cycle_ms = APP_CYCLE_MS;
+static uint8_t g_state = CYCLE_STATE_STOPPED;
+static CycleStats_t g_stats;
+static UniversalCommand_t g_slot_cmd;                // Команда слота: статическая, чтобы не занимать стек задачи
+
+// --- Прототипы внутренних функций ---
+static bool CycleScheduler_BeginCycle(uint32_t now);
+static void CycleScheduler_EndCycle(uint32_t now);
+static void CycleScheduler_PlanNextCycle(void);
+static void CycleScheduler_PrepareFrames(uint8_t recipe_id);
+static void CycleScheduler_StartSlot(uint8_t index);
+static void CycleScheduler_OnSlotDone(uint8_t index, JobStatus_t final_status);
+static void CycleScheduler_Fault(void);
+
+// --- API функции ---
+
+void CycleScheduler_Init(void)
+{
+	memset(g_disk, 0, sizeof(g_disk));
+	memset(&g_stats, 0, sizeof(g_stats));
+	g_slot_count = 0;
+	g_next_slot_count = 0;
+	g_next_admits = false;
+	g_next_planned = false;
+	g_cycle_active = false;
+	g_queued = 0;
+	g_next_test_no = 1;
+	g_cycle_ms = APP_CYCLE_MS;
+	g_state = CYCLE_STATE_STOPPED;
+}
+
+bool CycleScheduler_Start(uint16_t cycle_ms)
+{
+	if (cycle_ms < CycleScheduler_GetMinCycleMs()) {
+		return false;
+	}
+	g_cycle_ms = cycle_ms;
+	g_state = CYCLE_STATE_RUNNING;
+	g_next_planned = false;
+	memset(&g_stats, 0, sizeof(g_stats));
+
+	char msg[APP_USB_RESP_MAX_LEN];
+	snprintf(msg, sizeof(msg), "INFO: Cycle: started, %u ms per cycle (%lu tests/h rated).", cycle_ms, (unsigned long)(3600000u / cycle_ms));
+	Dispatcher_SendUsbResponse(msg);
+	JobInbox_PostTimer();
+	return true;
+}
+
+void CycleScheduler_Stop(void)
+{
+	if (g_state == CYCLE_STATE_RUNNING) {
+		g_state = CYCLE_STATE_STOPPING;
+		g_next_planned = false;
+		JobInbox_PostTimer();
+	}
+}
+
+bool CycleScheduler_OrderTests(uint16_t count)
+{
+	if (count > CYCLE_MAX_QUEUED_TESTS - g_queued) {
+		return false;
+	}
+	g_queued = (uint16_t)(g_queued + count);
+	g_next_planned = false;
+	JobInbox_PostTimer();
+	return true;
+}
+
+uint16_t CycleScheduler_GetMinCycleMs(void)
+{
+	uint16_t longest = 0;
+	for (uint8_t i = 0; i < CYCLE_STAGE_COUNT; i++) {
+		if (k_cycle_stages[i].slot_ms > longest) {
+			longest = k_cycle_stages[i].slot_ms;
+		}
+	}
+	return (uint16_t)(CYCLE_DISK_SLOT_MS + longest);
+}
+
+void CycleScheduler_GetStats(CycleStats_t* out_stats)
+{
+	*out_stats = g_stats;
+	out_stats->tests_queued = g_queued;
+	out_stats->cycle_ms = g_cycle_ms;
+	out_stats->state = g_state;
+	out_stats->tests_on_disk = 0;
+	for (uint8_t k = 0; k < CYCLE_PIPELINE_DEPTH; k++) {
+		if (g_disk[k].test_no != 0) {
+			out_stats->tests_on_disk++;
+		}
+	}
+	out_stats->rated_per_hour = 3600000u / g_cycle_ms;
+	out_stats->tests_per_hour = (g_stats.busy_ms > 0)
+	                            ? (uint32_t)((uint64_t)g_stats.tests_completed * 3600000u / g_stats.busy_ms) : 0;
+}
+
+uint32_t CycleScheduler_Run(void)
+{
+	for (;;) {
+		if (g_state == CYCLE_STATE_STOPPED) {
+			return JOB_MANAGER_NO_DEADLINE;
+		}
+		const uint32_t now = HAL_GetTick();
+		if (!g_cycle_active && !CycleScheduler_BeginCycle(now)) {
+			return JOB_MANAGER_NO_DEADLINE; // Тестов нет: ждем заказа
+		}
+
+		// Слот 0 - поворот диска: модули работают с кюветами, когда диск стоит
+		if (!g_slots[0].started) {
+			CycleScheduler_StartSlot(0);
+		}
+		if (!g_slots[0].done) {
+			return JOB_MANAGER_NO_DEADLINE; // Продолжим в CycleScheduler_OnSlotDone
+		}
+		if (g_slots[0].failed) {
+			CycleScheduler_Fault();
+			continue;
+		}
+
+		bool all_done = true;
+		g_stations_start_ms = g_slots[0].done_ms;
+		for (uint8_t i = 1; i < g_slot_count; i++) {
+			if (!g_slots[i].started) {
+				CycleScheduler_StartSlot(i);
+			}
+			all_done = all_done && g_slots[i].done;
+		}
+
+		// Слоты цикла запущены: пока они идут, готовим план следующего
+		if (!g_next_planned) {
+			CycleScheduler_PlanNextCycle();
+		}
+		if (!all_done) {
+			return JOB_MANAGER_NO_DEADLINE;
+		}
+		const uint32_t elapsed = now - g_cycle_start_ms;
+		if (elapsed < g_cycle_ms) {
+			return g_cycle_ms - elapsed;
+		}
+		CycleScheduler_EndCycle(now);
+	}
+}
+
+// --- Внутренние функции ---
+
+/**
+ * @brief Начинает цикл по готовому плану: диск поворачивается на кювету,
+ *        тесты сдвигаются на следующую позицию, тест из очереди занимает позицию 0.
+ * @return false, если ни в очереди, ни на диске тестов нет.
+ */
+static bool CycleScheduler_BeginCycle(uint32_t now)
+{
+	if (!g_next_planned) {
+		CycleScheduler_PlanNextCycle();
+	}
+	if (g_next_slot_count == 0) {
+		if (g_state == CYCLE_STATE_STOPPING) {
+			g_state = CYCLE_STATE_STOPPED;
+			char msg[APP_USB_RESP_MAX_LEN];
+			snprintf(msg, sizeof(msg), "INFO: Cycle: stopped after %lu cycles, %lu tests completed, %lu failed.",
+			         (unsigned long)g_stats.cycles, (unsigned long)g_stats.tests_completed, (unsigned long)g_stats.tests_failed);
+			Dispatcher_SendUsbResponse(msg);
+		}
+		return false;
+	}
+
+	// Позиция CYCLE_PIPELINE_DEPTH - 1 освобождена в конце прошлого цикла
+	memmove(&g_disk[1], &g_disk[0], (CYCLE_PIPELINE_DEPTH - 1) * sizeof(g_disk[0]));
+	memset(&g_disk[0], 0, sizeof(g_disk[0]));
+	if (g_next_admits) {
+		g_disk[0].test_no = g_next_test_no;
+		g_next_test_no = (g_next_test_no == 0xFFFF) ? 1 : (uint16_t)(g_next_test_no + 1);
+		g_queued--;
+	}
+
+	memcpy(g_slots, g_next_slots, sizeof(g_slots));
+	g_slot_count = g_next_slot_count;
+	g_next_planned = false;
+	g_cycle_active = true;
+	g_cycle_start_ms = now;
+	g_stats.cycles++;
+	return true;
+}
+
+/**
+ * @brief Завершает цикл: учитывает растяжение цикла, превышения бюджетов слотов
+ *        и тест, кювета которого промыта на последней позиции.
+ */
+static void CycleScheduler_EndCycle(uint32_t now)
+{
+	uint32_t last_done_ms = 0; // От начала цикла
+	for (uint8_t i = 0; i < g_slot_count; i++) {
+		const CycleSlot_t* slot = &g_slots[i];
+		if (slot->done_ms - g_cycle_start_ms > last_done_ms) {
+			last_done_ms = slot->done_ms - g_cycle_start_ms;
+		}
+		if (slot->stage_index == CYCLE_SLOT_DISK) {
+			continue;
+		}
+		const CycleStage_t* stage = &k_cycle_stages[slot->stage_index];
+		const uint32_t slot_ms = slot->done_ms - g_stations_start_ms;
+		if (slot_ms > stage->slot_ms) {
+			char msg[APP_USB_RESP_MAX_LEN];
+			snprintf(msg, sizeof(msg), "WARNING: Cycle #%lu: %s slot took %lu ms of its %u ms budget.",
+			         (unsigned long)g_stats.cycles, stage->name, (unsigned long)slot_ms, stage->slot_ms);
+			Dispatcher_SendUsbResponse(msg);
+		}
+	}
+	if (last_done_ms > g_cycle_ms) {
+		g_stats.overruns++;
+		if (last_done_ms - g_cycle_ms > g_stats.max_overrun_ms) {
+			g_stats.max_overrun_ms = last_done_ms - g_cycle_ms;
+		}
+	}
+	g_stats.busy_ms += now - g_cycle_start_ms;
+
+	CycleCuvette_t* last = &g_disk[CYCLE_PIPELINE_DEPTH - 1];
+	if (last->test_no != 0) {
+		if (last->failed) {
+			g_stats.tests_failed++;
+		} else {
+			g_stats.tests_completed++;
+		}
+		char msg[APP_USB_RESP_MAX_LEN];
+		snprintf(msg, sizeof(msg), "INFO: Cycle #%lu: test %u %s.", (unsigned long)g_stats.cycles, last->test_no,
+		         last->failed ? "failed" : "completed");
+		Dispatcher_SendUsbResponse(msg);
+		memset(last, 0, sizeof(*last));
+	}
+	g_cycle_active = false;
+}
+
+/**
+ * @brief План следующего цикла: слоты модулей над тестами, которые окажутся
+ *        у модулей после поворота диска. Пустые кюветы и тесты с ошибкой
+ *        (кроме промывки) слотов не получают. Шаблоны кадров рецептов слотов
+ *        собираются здесь же, а не на границе цикла.
+ */
+static void CycleScheduler_PlanNextCycle(void)
+{
+	g_next_admits = (g_state == CYCLE_STATE_RUNNING && g_queued > 0);
+	g_next_slot_count = 0;
+	g_next_planned = true;
+
+	bool any_test = g_next_admits;
+	for (uint8_t k = 0; k + 1 < CYCLE_PIPELINE_DEPTH; k++) {
+		any_test = any_test || (g_disk[k].test_no != 0);
+	}
+	if (!any_test) {
+		return; // Диск пуст: циклы останавливаются до заказа
+	}
+
+	memset(g_next_slots, 0, sizeof(g_next_slots));
+	g_next_slots[g_next_slot_count++].stage_index = CYCLE_SLOT_DISK;
+	CycleScheduler_PrepareFrames(RECIPE_REACTION_STEP);
+	for (uint8_t i = 0; i < CYCLE_STAGE_COUNT; i++) {
+		const CycleStage_t* stage = &k_cycle_stages[i];
+		// После поворота на позиции stage окажется тест с позиции stage - 1
+		const bool occupied = (stage->stage == 0) ? g_next_admits : (g_disk[stage->stage - 1].test_no != 0);
+		const bool failed = (stage->stage != 0) && g_disk[stage->stage - 1].failed;
+		if (occupied && (!failed || stage->always)) {
+			g_next_slots[g_next_slot_count++].stage_index = i;
+			CycleScheduler_PrepareFrames(stage->recipe_id);
+		}
+	}
+}
+
+/**
+ * @brief Собирает шаблоны кадров действий рецепта слота (action_frames.h), если их
+ *        вытеснили из кэша задания других рецептов: на границе цикла слоты только запускаются.
+ */
+static void CycleScheduler_PrepareFrames(uint8_t recipe_id)
+{
+	uint8_t length = 0;
+	const RecipeInstr_t* code = Recipe_Get((RecipeID_t)recipe_id, &length);
+	for (uint8_t pc = 0; code != NULL && pc < length; pc++) {
+		if (RECIPE_OP_IS_ACTION(code[pc].op)) {
+			ActionFrames_Get(&code[pc]);
+		}
+	}
+}
+
+static void CycleScheduler_StartSlot(uint8_t index)
+{
+	CycleSlot_t* slot = &g_slots[index];
+	memset(&g_slot_cmd, 0, sizeof(g_slot_cmd));
+	g_slot_cmd.priority = JOB_PRIORITY_ROUTINE;
+	g_slot_cmd.args_type = ARGS_TYPE_NONE;
+	if (slot->stage_index == CYCLE_SLOT_DISK) {
+		g_slot_cmd.recipe_id = RECIPE_REACTION_STEP;
+	} else {
+		const CycleStage_t* stage = &k_cycle_stages[slot->stage_index];
+		g_slot_cmd.recipe_id = (RecipeID_t)stage->recipe_id;
+		if (stage->args_len > 0) {
+			g_slot_cmd.args_type = ARGS_TYPE_BINARY;
+			memcpy(g_slot_cmd.args.binary.raw, stage->args, stage->args_len);
+			g_slot_cmd.args.binary.len = stage->args_len;
+		}
+	}
+
+	// Задание может завершиться прямо при запуске (в том числе с ошибкой) - слот уже должен быть отмечен
+	slot->started = true;
+	if (JobManager_StartOwnedJob(&g_slot_cmd, CycleScheduler_OnSlotDone, index) == 0 && !slot->done) {
+		CycleScheduler_OnSlotDone(index, JOB_STATUS_ERROR); // Нет свободных слотов заданий
+	}
+}
+
+/**
+ * @brief Завершение задания слота (JobDoneCallback_t). Только отмечает итог:
+ *        следующий шаг цикла выполнит CycleScheduler_Run при обработке таймеров.
+ */
+static void CycleScheduler_OnSlotDone(uint8_t index, JobStatus_t final_status)
+{
+	if (index >= g_slot_count || g_slots[index].done) {
+		return;
+	}
+	CycleSlot_t* slot = &g_slots[index];
+	slot->done = true;
+	slot->done_ms = HAL_GetTick();
+	if (final_status != JOB_STATUS_COMPLETED) {
+		slot->failed = true;
+		if (slot->stage_index != CYCLE_SLOT_DISK) {
+			g_disk[k_cycle_stages[slot->stage_index].stage].failed = true;
+			g_next_planned = false; // Остальные слоты теста больше не нужны
+		}
+	}
+	JobInbox_PostTimer();
+}
+
+/**
+ * @brief Диск не повернулся: кюветы не у своих модулей, продолжать циклы нельзя.
+ *        Тесты на диске считаются неуспешными, очередь заказа сохраняется.
+ */
+static void CycleScheduler_Fault(void)
+{
+	uint8_t lost = 0;
+	for (uint8_t k = 0; k < CYCLE_PIPELINE_DEPTH; k++) {
+		if (g_disk[k].test_no != 0) {
+			lost++;
+		}
+	}
+	g_stats.tests_failed += lost;
+	memset(g_disk, 0, sizeof(g_disk));
+	g_state = CYCLE_STATE_STOPPED;
+	g_cycle_active = false;
+	g_next_planned = false;
+
+	char msg[APP_USB_RESP_MAX_LEN];
+	snprintf(msg, sizeof(msg), "ERROR: Cycle #%lu: reaction disk did not advance, cycles stopped (%u tests on disk failed).",
+	         (unsigned long)g_stats.cycles, lost);
+	Dispatcher_SendUsbResponse(msg);
+}
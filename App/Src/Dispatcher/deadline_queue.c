@@ -0,0 +1,144 @@
+/*
+ * deadline_queue.c
+ *
+ *  Двоичная min-куча сроков с картой позиций для переноса и отмены таймеров.
+ *  Очередью владеет задача диспетчера (см. job_inbox.h): другие задачи
+ *  таймеры не трогают, поэтому критические секции не нужны.
+ */
+
+#include "Dispatcher/deadline_queue.h"
+
+#define DEADLINE_POS_NONE   0xFFFF
+
+typedef struct {
+	uint32_t deadline_ms;
+	TimerId_t id;
+} DeadlineEntry_t;
+
+static DeadlineEntry_t g_heap[DEADLINE_QUEUE_CAPACITY] APP_DTCM_BSS;
+static uint16_t g_heap_size = 0;
+static uint16_t g_heap_pos[DEADLINE_QUEUE_CAPACITY] APP_DTCM_BSS; // Позиция таймера в куче или DEADLINE_POS_NONE
+
+// --- Внутренние функции кучи ---
+
+static bool entry_before(const DeadlineEntry_t* a, const DeadlineEntry_t* b)
+{
+	return (int32_t)(a->deadline_ms - b->deadline_ms) < 0;
+}
+
+static void heap_place(uint16_t pos, const DeadlineEntry_t* entry)
+{
+	g_heap[pos] = *entry;
+	g_heap_pos[entry->id] = pos;
+}
+
+static void sift_up(uint16_t pos)
+{
+	DeadlineEntry_t entry = g_heap[pos];
+	while (pos > 0) {
+		uint16_t parent = (uint16_t)((pos - 1) / 2);
+		if (!entry_before(&entry, &g_heap[parent])) {
+			break;
+			}
+		heap_place(pos, &g_heap[parent]);
+		pos = parent;
+		}
+	heap_place(pos, &entry);
+}
+
+static void sift_down(uint16_t pos)
+{
+	DeadlineEntry_t entry = g_heap[pos];
+	for (;;) {
+		uint16_t child = (uint16_t)(2 * pos + 1);
+		if (child >= g_heap_size) {
+			break;
+			}
+		if (child + 1 < g_heap_size && entry_before(&g_heap[child + 1], &g_heap[child])) {
+			child++;
+			}
+		if (!entry_before(&g_heap[child], &entry)) {
+			break;
+			}
+		heap_place(pos, &g_heap[child]);
+		pos = child;
+		}
+	heap_place(pos, &entry);
+}
+
+static void heap_remove_at(uint16_t pos)
+{
+	g_heap_pos[g_heap[pos].id] = DEADLINE_POS_NONE;
+	g_heap_size--;
+	if (pos == g_heap_size) {
+		return;
+		}
+	// На место удаленного ставим последний элемент и восстанавливаем порядок в обе стороны
+	DeadlineEntry_t moved = g_heap[g_heap_size];
+	heap_place(pos, &moved);
+	sift_down(pos);
+	sift_up(g_heap_pos[moved.id]);
+}
+
+// --- API ---
+
+void DeadlineQueue_Init(void)
+{
+	g_heap_size = 0;
+	for (uint16_t i = 0; i < DEADLINE_QUEUE_CAPACITY; i++) {
+		g_heap_pos[i] = DEADLINE_POS_NONE;
+		}
+}
+
+bool DeadlineQueue_Set(TimerId_t id, uint32_t deadline_ms)
+{
+	if (id >= DEADLINE_QUEUE_CAPACITY) {
+		return false;
+		}
+
+	uint16_t pos = g_heap_pos[id];
+	if (pos == DEADLINE_POS_NONE) {
+		pos = g_heap_size++;
+		}
+	g_heap[pos].deadline_ms = deadline_ms;
+	g_heap[pos].id = id;
+	g_heap_pos[id] = pos;
+	sift_up(pos);
+	sift_down(g_heap_pos[id]);
+	bool is_first = (g_heap[0].id == id);
+	return is_first;
+}
+
+bool DeadlineQueue_Cancel(TimerId_t id)
+{
+	if (id >= DEADLINE_QUEUE_CAPACITY) {
+		return false;
+		}
+	bool was_set = false;
+	if (g_heap_pos[id] != DEADLINE_POS_NONE) {
+		heap_remove_at(g_heap_pos[id]);
+		was_set = true;
+		}
+	return was_set;
+}
+
+bool DeadlineQueue_PopExpired(uint32_t now_ms, TimerId_t* out_id)
+{
+	bool expired = false;
+	if (g_heap_size > 0 && Deadline_IsReached(now_ms, g_heap[0].deadline_ms)) {
+		*out_id = g_heap[0].id;
+		heap_remove_at(0);
+		expired = true;
+		}
+	return expired;
+}
+
+bool DeadlineQueue_Next(uint32_t* out_deadline_ms)
+{
+	bool has_next = false;
+	if (g_heap_size > 0) {
+		*out_deadline_ms = g_heap[0].deadline_ms;
+		has_next = true;
+		}
+	return has_next;
+}
@@ -9,6 +9,79 @@
 #include "dispatcher_io.h"
 #include "app_init_checker.h" // For GetSystemState
 #include "task_dispatcher.h"
+#include "job_manager.h"
+#include "job_history.h"
+#include "recipe_store.h"
+#include "recipe_flash.h"
+#include "cycle_scheduler.h"
+#include "job_trace.h"
+#include <string.h>
+#include <stdio.h>
+
+// --- GET_VERSION: wire format (Big-endian) ---
+#define GET_VERSION_HEADER_SIZE   21  // major(1) minor(1) build(2) date(8) protocol(1) crc_mode(1) options(1)
+                                      // max_packet(2) max_response(2) max_params(1) command_count(1)
+#define GET_VERSION_ENTRY_SIZE    5   // command_code(2) kind(1) min_params(1) max_params(1)
+#define GET_VERSION_MAX_ENTRIES   ((APP_USB_RESP_MAX_LEN - PROTOCOL_RESP_OVERHEAD) / GET_VERSION_ENTRY_SIZE)
+#define GET_VERSION_KIND_DIRECT   0x00 // Выполняется сразу, DONE - по окончании обработчика
+#define GET_VERSION_KIND_RECIPE   0x01 // Запускает задание, DONE - по его завершении
+
+_Static_assert(sizeof(APP_FW_BUILD_DATE) == 9, "APP_FW_BUILD_DATE must be YYYYMMDD");
+_Static_assert(MAX_BINARY_ARGS_SIZE <= 0xFF, "GET_VERSION reports parameter bounds in one byte");
+
+// --- RECIPE_UPLOAD: wire format (Big-endian) ---
+#define RECIPE_UPLOAD_BEGIN       0x01
+#define RECIPE_UPLOAD_DATA        0x02
+#define RECIPE_UPLOAD_COMMIT      0x03
+#define RECIPE_WIRE_INSTR_SIZE    12  // op(1) device(1) dev_bind(1) val_bind(1) value(4) speed(2) timeout_ms(2)
+#define RECIPE_WIRE_ARG_SIZE      14  // offset(1) size(1) min(4) max(4) default(4)
+
+/**
+ * @brief Recipe being uploaded. Instructions are staged in RAM until COMMIT,
+ *        so a half-transferred recipe never reaches flash.
+ */
+static struct {
+	RecipeInstr_t code[RECIPE_MAX_LENGTH];
+	uint32_t received[(RECIPE_MAX_LENGTH + 31) / 32]; // Bitmap of received instructions
+	RecipeArgLayout_t args;
+	ResourceMask_t resources;
+	uint8_t recipe_id;      // RECIPE_NONE - no upload in progress
+	uint8_t length;
+} g_upload;
+
+// --- CYCLE: operations (params[0]) ---
+#define CYCLE_OP_START            0x01
+#define CYCLE_OP_STOP             0x02
+#define CYCLE_OP_ORDER            0x03
+#define CYCLE_OP_STATUS           0x04
+
+// --- JOB_CONTROL: operations (params[0]) ---
+#define JOB_CONTROL_CANCEL        0x01
+#define JOB_CONTROL_PAUSE         0x02
+#define JOB_CONTROL_RESUME        0x03
+
+// --- JOB_LIST: wire format ---
+#define JOB_LIST_HEADER_SIZE      3   // total(1) first(1) count(1)
+#define JOB_LIST_ENTRY_SIZE       14  // job_id(2) recipe(1) status(1) priority(1) step_pc(1) pending(1) waiting(1) elapsed_ms(4) step_ms(2)
+#define JOB_LIST_MAX_ENTRIES      ((APP_USB_RESP_MAX_LEN - PROTOCOL_RESP_OVERHEAD - JOB_LIST_HEADER_SIZE) / JOB_LIST_ENTRY_SIZE)
+
+// --- JOB_HISTORY: wire format ---
+#define JOB_HISTORY_HEADER_SIZE   22  // seq(4) job_id(2) recipe(1) status(1) queued_ms(4) start_ms(4) end_ms(4) step_count(1) dropped(1)
+#define JOB_HISTORY_STEP_SIZE     12  // step_pc(1) slowest_exec(1) runs(2) total_ms(4) max_ms(4)
+
+// --- JOB_TRACE: wire format ---
+#define JOB_TRACE_CHUNK_HEADER    4   // offset(4)
+#define JOB_TRACE_CHUNK_SIZE      (APP_USB_RESP_MAX_LEN - PROTOCOL_RESP_OVERHEAD - JOB_TRACE_CHUNK_HEADER)
+
+static uint32_t read_be32(const uint8_t* p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void write_be32(uint8_t* p, uint32_t value)
+{
+	for (int shift = 24; shift >= 0; shift -= 8) *p++ = (uint8_t)(value >> shift);
+}
 
 /**
       * @brief Handler for the direct command GET_STATUS (0x1000)
@@ -37,9 +110,537 @@ void handle_get_status(uint16_t command_code, const uint8_t* params, uint16_t pa
 
 }
 
+/**
+      * @brief Handler for the direct command GET_VERSION (0x1003)
+      *        Reports firmware and protocol versions, protocol options and the supported commands
+      *        with their parameter length bounds, taken from the descriptor tables (command_parser.c).
+      *        The host enables optional protocol features only if they are listed here.
+      *        DATA #1: GET_VERSION_HEADER_SIZE; DATA #2..: up to GET_VERSION_MAX_ENTRIES entries
+      *        of GET_VERSION_ENTRY_SIZE (Big-endian)
+     */
+void handle_get_version(uint16_t command_code, const uint8_t* params, uint16_t params_len)
+{
+	const uint16_t command_count = DIRECT_COMMAND_TABLE_SIZE + RECIPE_COMMAND_TABLE_SIZE;
+	uint8_t options = PROTOCOL_OPT_SEQUENCE;
+	if (APP_JOB_TRACE_BYTES > 0) {
+		options |= PROTOCOL_OPT_JOB_TRACE;
+	}
+
+	uint8_t header[GET_VERSION_HEADER_SIZE];
+	uint8_t* p = header;
+	*p++ = APP_FW_VERSION_MAJOR;
+	*p++ = APP_FW_VERSION_MINOR;
+	*p++ = (uint8_t)(APP_FW_BUILD >> 8);
+	*p++ = (uint8_t)(APP_FW_BUILD & 0xFF);
+	memcpy(p, APP_FW_BUILD_DATE, 8);
+	p += 8;
+	*p++ = APP_PROTOCOL_VERSION;
+	*p++ = PROTOCOL_CRC_XOR8;
+	*p++ = options;
+	*p++ = (uint8_t)(APP_USB_CMD_MAX_LEN >> 8);
+	*p++ = (uint8_t)(APP_USB_CMD_MAX_LEN & 0xFF);
+	*p++ = (uint8_t)(APP_USB_RESP_MAX_LEN >> 8);
+	*p++ = (uint8_t)(APP_USB_RESP_MAX_LEN & 0xFF);
+	*p++ = MAX_BINARY_ARGS_SIZE;
+	*p++ = (uint8_t)command_count;
+	Dispatcher_SendData(command_code, 0x03, 0x0000, header, sizeof(header));
+
+	// Список команд: сначала прямые, затем команды-рецепты
+	uint8_t data_payload[GET_VERSION_MAX_ENTRIES * GET_VERSION_ENTRY_SIZE];
+	p = data_payload;
+	for (uint16_t i = 0; i < command_count; i++) {
+		const bool direct = (i < DIRECT_COMMAND_TABLE_SIZE);
+		const uint16_t code = direct ? direct_command_table[i].command_code : recipe_command_table[i - DIRECT_COMMAND_TABLE_SIZE].command_code;
+		const uint16_t min_len = direct ? direct_command_table[i].min_params_len : recipe_command_table[i - DIRECT_COMMAND_TABLE_SIZE].min_params_len;
+		const uint16_t max_len = direct ? direct_command_table[i].max_params_len : recipe_command_table[i - DIRECT_COMMAND_TABLE_SIZE].max_params_len;
+		*p++ = (uint8_t)(code >> 8);
+		*p++ = (uint8_t)(code & 0xFF);
+		const bool starts_job = !direct || direct_command_table[i].starts_job;
+		*p++ = starts_job ? GET_VERSION_KIND_RECIPE : GET_VERSION_KIND_DIRECT;
+		*p++ = (uint8_t)min_len;
+		*p++ = (uint8_t)max_len;
+		if (p - data_payload == sizeof(data_payload) || i + 1 == command_count) {
+			Dispatcher_SendData(command_code, 0x03, 0x0000, data_payload, (uint16_t)(p - data_payload));
+			p = data_payload;
+		}
+	}
+	Dispatcher_SendDone(command_code, 0x0000);
+}
+
+/**
+      * @brief Handler for the direct command GET_QUEUE_STATS (0x1006)
+      *        Returns queue wait statistics per job priority class (STAT, routine, maintenance).
+      * @param params params[0] (optional): 1 = reset the accumulated statistics after reading
+     */
+void handle_get_queue_stats(uint16_t command_code, const uint8_t* params, uint16_t params_len)
+{
+	static const JobPriority_t classes[] = { JOB_PRIORITY_STAT, JOB_PRIORITY_ROUTINE, JOB_PRIORITY_MAINTENANCE };
+
+	// Per class (Big-endian): class(1) queued(2) admitted(4) mean_wait_ms(4) max_wait_ms(4)
+	uint8_t data_payload[sizeof(classes) / sizeof(classes[0]) * 15];
+	uint8_t* p = data_payload;
+	for (uint8_t i = 0; i < sizeof(classes) / sizeof(classes[0]); i++) {
+		JobClassStats_t stats;
+		JobManager_GetClassStats(classes[i], &stats);
+		uint32_t mean_wait_ms = (stats.admitted > 0) ? stats.total_wait_ms / stats.admitted : 0;
+
+		*p++ = (uint8_t)classes[i];
+		*p++ = (uint8_t)(stats.queued >> 8);
+		*p++ = (uint8_t)(stats.queued & 0xFF);
+		for (int shift = 24; shift >= 0; shift -= 8) *p++ = (uint8_t)(stats.admitted >> shift);
+		for (int shift = 24; shift >= 0; shift -= 8) *p++ = (uint8_t)(mean_wait_ms >> shift);
+		for (int shift = 24; shift >= 0; shift -= 8) *p++ = (uint8_t)(stats.max_wait_ms >> shift);
+	}
+
+	if (params_len > 0 && params[0] == 0x01) {
+		JobManager_ResetClassStats();
+	}
+
+	Dispatcher_SendData(command_code, 0x03, 0x0000, data_payload, sizeof(data_payload));
+	Dispatcher_SendDone(command_code, 0x0000);
+}
+
+/**
+ * @brief Reports a rejected upload: a text line with the reason and an ERROR response.
+ */
+static void recipe_upload_fail(uint16_t command_code, uint16_t error_code, const char* reason, int pc)
+{
+	char msg[APP_USB_RESP_MAX_LEN];
+	if (pc >= 0) {
+		snprintf(msg, sizeof(msg), "ERROR: Recipe upload: %s at pc %d.", reason, pc);
+	} else {
+		snprintf(msg, sizeof(msg), "ERROR: Recipe upload: %s.", reason);
+	}
+	Dispatcher_SendUsbResponse(msg);
+	Dispatcher_SendError(command_code, error_code);
+}
+
+/**
+      * @brief Handler for the direct command RECIPE_UPLOAD (0x1007)
+      *        Uploads a bytecode recipe in three phases (params[0]):
+      *        BEGIN  (0x01): id(1) length(1) resources(4) arg_count(1) arg_count * [offset(1) size(1) min(4) max(4) default(4)]
+      *        DATA   (0x02): first_index(1) k * instruction(12)
+      *        COMMIT (0x03): crc32(4) over all instructions in wire format
+      *        On COMMIT the recipe is validated and written to flash; it replaces a built-in recipe with the same ID.
+     */
+void handle_recipe_upload(uint16_t command_code, const uint8_t* params, uint16_t params_len)
+{
+	switch (params[0]) {
+		case RECIPE_UPLOAD_BEGIN: {
+			if (params_len < 8 || params[1] == RECIPE_NONE || params[1] >= RECIPE_STORE_MAX_ID ||
+				params[2] == 0 || params[7] > RECIPE_MAX_ARGS ||
+				params_len != 8 + params[7] * RECIPE_WIRE_ARG_SIZE) {
+				recipe_upload_fail(command_code, 0x0003, "bad header", -1);
+				return;
+			}
+			memset(&g_upload, 0, sizeof(g_upload));
+			g_upload.length = params[2];
+			g_upload.resources = read_be32(&params[3]);
+			g_upload.args.count = params[7];
+			const uint8_t* p = &params[8];
+			for (uint8_t i = 0; i < g_upload.args.count; i++, p += RECIPE_WIRE_ARG_SIZE) {
+				RecipeArgField_t* field = &g_upload.args.fields[i];
+				field->offset = p[0];
+				field->size = p[1];
+				field->min_value = (int32_t)read_be32(&p[2]);
+				field->max_value = (int32_t)read_be32(&p[6]);
+				field->default_value = (int32_t)read_be32(&p[10]);
+			}
+			g_upload.recipe_id = params[1];
+			break;
+		}
+
+		case RECIPE_UPLOAD_DATA: {
+			const uint16_t count = (params_len >= 2) ? (params_len - 2) / RECIPE_WIRE_INSTR_SIZE : 0;
+			if (g_upload.recipe_id == RECIPE_NONE) {
+				recipe_upload_fail(command_code, 0x0003, "no upload in progress", -1);
+				return;
+			}
+			if (count == 0 || params_len != 2 + count * RECIPE_WIRE_INSTR_SIZE ||
+				params[1] + count > g_upload.length) {
+				recipe_upload_fail(command_code, 0x0003, "bad data chunk", params[1]);
+				return;
+			}
+			const uint8_t* p = &params[2];
+			for (uint16_t i = 0; i < count; i++, p += RECIPE_WIRE_INSTR_SIZE) {
+				const uint8_t pc = (uint8_t)(params[1] + i);
+				RecipeInstr_t* instr = &g_upload.code[pc];
+				instr->op = p[0];
+				instr->device = p[1];
+				instr->dev_bind = p[2];
+				instr->val_bind = p[3];
+				instr->value = (int32_t)read_be32(&p[4]);
+				instr->speed = (uint16_t)((p[8] << 8) | p[9]);
+				instr->timeout_ms = (uint16_t)((p[10] << 8) | p[11]);
+				g_upload.received[pc / 32] |= 1u << (pc % 32);
+			}
+			break;
+		}
+
+		case RECIPE_UPLOAD_COMMIT: {
+			if (g_upload.recipe_id == RECIPE_NONE || params_len != 5) {
+				recipe_upload_fail(command_code, 0x0003, "no upload in progress", -1);
+				return;
+			}
+			// CRC over the wire format: the host computes it over exactly the bytes it sent
+			uint32_t crc = 0;
+			for (uint8_t pc = 0; pc < g_upload.length; pc++) {
+				if ((g_upload.received[pc / 32] & (1u << (pc % 32))) == 0) {
+					recipe_upload_fail(command_code, 0x0003, "missing instruction", pc);
+					return;
+				}
+				const RecipeInstr_t* instr = &g_upload.code[pc];
+				uint8_t wire[RECIPE_WIRE_INSTR_SIZE] = { instr->op, instr->device, instr->dev_bind, instr->val_bind };
+				write_be32(&wire[4], (uint32_t)instr->value);
+				wire[8] = (uint8_t)(instr->speed >> 8);
+				wire[9] = (uint8_t)(instr->speed & 0xFF);
+				wire[10] = (uint8_t)(instr->timeout_ms >> 8);
+				wire[11] = (uint8_t)(instr->timeout_ms & 0xFF);
+				crc = RecipeFlash_Crc32(crc, wire, sizeof(wire));
+			}
+			if (crc != read_be32(&params[1])) {
+				recipe_upload_fail(command_code, 0x0007, "CRC mismatch", -1);
+				return;
+			}
+
+			if (g_upload.resources == 0) {
+				recipe_upload_fail(command_code, 0x0003, "no resources declared", -1);
+				return;
+			}
+			const char* reason = "";
+			const int bad_pc = Recipe_Validate(g_upload.code, g_upload.length, &g_upload.args, &reason);
+			if (bad_pc >= 0) {
+				recipe_upload_fail(command_code, 0x0003, reason, bad_pc);
+				return;
+			}
+
+			// Running jobs execute their programs straight from flash: compaction only when idle
+			const RecipeFlashStatus_t status = RecipeFlash_Store(g_upload.recipe_id, g_upload.code, g_upload.length,
+			                                                     g_upload.resources, &g_upload.args,
+			                                                     JobManager_GetActiveJobCount() == 0);
+			g_upload.recipe_id = RECIPE_NONE;
+			if (status == RECIPE_FLASH_FULL) {
+				recipe_upload_fail(command_code, 0x0009, "recipe storage full, retry when idle", -1);
+				return;
+			}
+			if (status != RECIPE_FLASH_OK) {
+				recipe_upload_fail(command_code, 0x0001, "flash write failed", -1);
+				return;
+			}
+			break;
+		}
+
+		default:
+			recipe_upload_fail(command_code, 0x0003, "unknown phase", -1);
+			return;
+	}
+
+	Dispatcher_SendDone(command_code, 0x0000);
+}
+
+/**
+      * @brief Handler for the direct command RECIPE_LIST (0x1008)
+      *        DATA (Big-endian): free_bytes(4) count(1) count * [id(1) source(1) length(1) resources(4)]
+      *        source: 0 = built-in, 1 = uploaded to flash.
+     */
+void handle_recipe_list(uint16_t command_code, const uint8_t* params, uint16_t params_len)
+{
+	uint8_t data_payload[5 + (RECIPE_STORE_MAX_ID - 1) * 7];
+	uint8_t* p = &data_payload[5];
+	uint8_t count = 0;
+	for (uint8_t id = RECIPE_NONE + 1; id < RECIPE_STORE_MAX_ID; id++) {
+		uint8_t length = 0;
+		if (Recipe_Get((RecipeID_t)id, &length) == NULL) {
+			continue;
+		}
+		*p++ = id;
+		*p++ = (RecipeFlash_Find(id) != NULL) ? 1 : 0;
+		*p++ = length;
+		write_be32(p, Recipe_GetResources((RecipeID_t)id));
+		p += 4;
+		count++;
+	}
+	write_be32(data_payload, RecipeFlash_GetFreeBytes());
+	data_payload[4] = count;
+
+	Dispatcher_SendData(command_code, 0x03, 0x0000, data_payload, (uint16_t)(p - data_payload));
+	Dispatcher_SendDone(command_code, 0x0000);
+}
+
+/**
+      * @brief Handler for the direct command RECIPE_DELETE (0x1009)
+      *        Deletes an uploaded recipe; a built-in recipe with the same ID becomes active again.
+      * @param params params[0]: recipe ID
+     */
+void handle_recipe_delete(uint16_t command_code, const uint8_t* params, uint16_t params_len)
+{
+	const RecipeFlashStatus_t status = RecipeFlash_Delete(params[0], JobManager_GetActiveJobCount() == 0);
+	if (status == RECIPE_FLASH_NOT_FOUND) {
+		Dispatcher_SendError(command_code, 0x0003);
+		return;
+	}
+	if (status == RECIPE_FLASH_FULL) {
+		Dispatcher_SendError(command_code, 0x0009);
+		return;
+	}
+	if (status != RECIPE_FLASH_OK) {
+		Dispatcher_SendError(command_code, 0x0001);
+		return;
+	}
+	Dispatcher_SendDone(command_code, 0x0000);
+}
 
+/**
+      * @brief Handler for the direct command RECIPE_RUN (0x100A)
+      *        Starts a job for any recipe ID, including uploaded recipes that have no command of their own.
+      * @param params params[0]: recipe ID, params[1]: JobPriority_t, params[2..]: recipe arguments
+     */
+void handle_recipe_run(uint16_t command_code, const uint8_t* params, uint16_t params_len)
+{
+	uint8_t length = 0;
+	if (params[0] == RECIPE_NONE || params[0] >= RECIPE_STORE_MAX_ID || params[1] >= JOB_PRIORITY_COUNT ||
+	    Recipe_Get((RecipeID_t)params[0], &length) == NULL) {
+		// Свободный или удаленный слот загрузки: задание не создается, единственный итог - ERROR
+		Dispatcher_SendError(command_code, 0x0003);
+		return;
+	}
+
+	UniversalCommand_t cmd;
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.command_code = command_code;
+	cmd.recipe_id = (RecipeID_t)params[0];
+	cmd.priority = (JobPriority_t)params[1];
+	cmd.args_type = (params_len > 2) ? ARGS_TYPE_BINARY : ARGS_TYPE_NONE;
+	cmd.args.binary.len = params_len - 2;
+	memcpy(cmd.args.binary.raw, &params[2], cmd.args.binary.len);
+
+	if (JobManager_StartNewJob(&cmd) == 0) {
+		Dispatcher_SendError(command_code, 0x0004); // ERR_BUSY: нет свободных слотов заданий
+	}
+}
 
+/**
+      * @brief Handler for the direct command CYCLE (0x100B)
+      *        Controls the fixed machine cycle (cycle_scheduler.h), params[0] selects the operation:
+      *        START  (0x01): [cycle_ms(2)] - APP_CYCLE_MS if omitted
+      *        STOP   (0x02): no new tests enter the reaction disk, tests on it are finished
+      *        ORDER  (0x03): count(2) - tests to queue
+      *        STATUS (0x04): DATA state(1) cycle_ms(2) queued(2) on_disk(1) cycles(4) overruns(4) max_overrun_ms(4)
+      *                            completed(4) failed(4) tests_per_hour(4) rated_per_hour(4)
+     */
+void handle_cycle(uint16_t command_code, const uint8_t* params, uint16_t params_len)
+{
+	switch (params[0]) {
+		case CYCLE_OP_START: {
+			const uint16_t cycle_ms = (params_len >= 3) ? (uint16_t)((params[1] << 8) | params[2]) : APP_CYCLE_MS;
+			if (params_len == 2 || !CycleScheduler_Start(cycle_ms)) {
+				char msg[APP_USB_RESP_MAX_LEN];
+				snprintf(msg, sizeof(msg), "ERROR: Cycle: %u ms is shorter than the longest slot (%u ms).", cycle_ms, CycleScheduler_GetMinCycleMs());
+				Dispatcher_SendUsbResponse(msg);
+				Dispatcher_SendError(command_code, 0x0003);
+				return;
+			}
+			break;
+		}
 
+		case CYCLE_OP_STOP:
+			CycleScheduler_Stop();
+			break;
 
+		case CYCLE_OP_ORDER:
+			if (params_len != 3) {
+				Dispatcher_SendError(command_code, 0x0003);
+				return;
+			}
+			if (!CycleScheduler_OrderTests((uint16_t)((params[1] << 8) | params[2]))) {
+				Dispatcher_SendError(command_code, 0x0009); // Очередь заказа заполнена
+				return;
+			}
+			break;
 
+		case CYCLE_OP_STATUS: {
+			CycleStats_t stats;
+			CycleScheduler_GetStats(&stats);
+			uint8_t data_payload[38];
+			uint8_t* p = data_payload;
+			*p++ = stats.state;
+			*p++ = (uint8_t)(stats.cycle_ms >> 8);
+			*p++ = (uint8_t)(stats.cycle_ms & 0xFF);
+			*p++ = (uint8_t)(stats.tests_queued >> 8);
+			*p++ = (uint8_t)(stats.tests_queued & 0xFF);
+			*p++ = stats.tests_on_disk;
+			const uint32_t fields[] = { stats.cycles, stats.overruns, stats.max_overrun_ms, stats.tests_completed,
+			                            stats.tests_failed, stats.tests_per_hour, stats.rated_per_hour };
+			for (uint8_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++, p += 4) {
+				write_be32(p, fields[i]);
+			}
+			Dispatcher_SendData(command_code, 0x03, 0x0000, data_payload, (uint16_t)(p - data_payload));
+			break;
+		}
 
+		default:
+			Dispatcher_SendError(command_code, 0x0003);
+			return;
+	}
+
+	Dispatcher_SendDone(command_code, 0x0000);
+}
+
+/**
+      * @brief Handler for the direct command JOB_CONTROL (0x100C)
+      *        Cancels, pauses or resumes a job by the ID from "INFO: Job #N started/queued".
+      *        Executors of the interrupted step are stopped before DONE, so the host can
+      *        recover right away (clot, bubble) instead of waiting for the action timeout.
+      * @param params params[0]: CANCEL (0x01) / PAUSE (0x02) / RESUME (0x03), params[1..2]: job ID (Big-endian)
+     */
+void handle_job_control(uint16_t command_code, const uint8_t* params, uint16_t params_len)
+{
+	const uint32_t job_id = ((uint32_t)params[1] << 8) | params[2];
+	bool done;
+	switch (params[0]) {
+		case JOB_CONTROL_CANCEL: done = JobManager_CancelJob(job_id); break;
+		case JOB_CONTROL_PAUSE:  done = JobManager_PauseJob(job_id); break;
+		case JOB_CONTROL_RESUME: done = JobManager_ResumeJob(job_id); break;
+		default:
+			Dispatcher_SendError(command_code, 0x0003);
+			return;
+	}
+
+	if (!done) {
+		char msg[APP_USB_RESP_MAX_LEN];
+		snprintf(msg, sizeof(msg), "ERROR: Job control: job #%lu is not active or not in a state for operation 0x%02X.",
+		         (unsigned long)job_id, params[0]);
+		Dispatcher_SendUsbResponse(msg);
+		Dispatcher_SendError(command_code, 0x0003);
+		return;
+	}
+	Dispatcher_SendDone(command_code, 0x0000);
+}
+
+/**
+      * @brief Handler for the direct command JOB_LIST (0x100D)
+      *        Binary snapshot of active, paused and queued jobs, so the host can poll
+      *        instead of parsing INFO lines. Jobs that do not fit one DATA frame are
+      *        requested again starting from params[0].
+      * @param params params[0] (optional): index of the first job to report
+      *        DATA: total(1) first(1) count(1), count * JOB_LIST_ENTRY_SIZE (Big-endian)
+     */
+void handle_job_list(uint16_t command_code, const uint8_t* params, uint16_t params_len)
+{
+	const uint8_t first = (params_len > 0) ? params[0] : 0;
+	JobSnapshot_t jobs[JOB_LIST_MAX_ENTRIES];
+	uint8_t total = 0;
+	const uint8_t count = JobManager_GetSnapshot(first, jobs, JOB_LIST_MAX_ENTRIES, &total);
+
+	uint8_t data_payload[JOB_LIST_HEADER_SIZE + JOB_LIST_MAX_ENTRIES * JOB_LIST_ENTRY_SIZE];
+	uint8_t* p = data_payload;
+	*p++ = total;
+	*p++ = first;
+	*p++ = count;
+	for (uint8_t i = 0; i < count; i++) {
+		*p++ = (uint8_t)(jobs[i].job_id >> 8);
+		*p++ = (uint8_t)(jobs[i].job_id & 0xFF);
+		*p++ = jobs[i].recipe_id;
+		*p++ = jobs[i].status;
+		*p++ = jobs[i].priority;
+		*p++ = jobs[i].step_pc;
+		*p++ = jobs[i].pending_mask;
+		*p++ = jobs[i].waiting_mask;
+		write_be32(p, jobs[i].elapsed_ms);
+		p += 4;
+		*p++ = (uint8_t)(jobs[i].step_ms >> 8);
+		*p++ = (uint8_t)(jobs[i].step_ms & 0xFF);
+	}
+	Dispatcher_SendData(command_code, 0x03, 0x0000, data_payload, (uint16_t)(p - data_payload));
+	Dispatcher_SendDone(command_code, 0x0000);
+}
+
+/**
+      * @brief Handler for the direct command JOB_HISTORY (0x100E)
+      *        Dumps finished jobs from the history ring with per-step timing, oldest first,
+      *        one DATA frame per job. The host passes the last seq it has seen to fetch only new jobs.
+      * @param params params[0..3] (optional): after_seq, report jobs with a greater seq (Big-endian)
+      *        DATA: JOB_HISTORY_HEADER_SIZE, step_count * JOB_HISTORY_STEP_SIZE (Big-endian)
+     */
+void handle_job_history(uint16_t command_code, const uint8_t* params, uint16_t params_len)
+{
+	if (params_len != 0 && params_len != 4) {
+		Dispatcher_SendError(command_code, 0x0003);
+		return;
+	}
+	uint32_t after_seq = (params_len == 4) ? read_be32(params) : 0;
+
+	uint8_t data_payload[JOB_HISTORY_HEADER_SIZE + JOB_HISTORY_MAX_STEPS * JOB_HISTORY_STEP_SIZE];
+	const JobHistoryEntry_t* entry;
+	while ((entry = JobHistory_GetNext(after_seq)) != NULL) {
+		uint8_t* p = data_payload;
+		write_be32(p, entry->seq);
+		p += 4;
+		*p++ = (uint8_t)(entry->job_id >> 8);
+		*p++ = (uint8_t)(entry->job_id & 0xFF);
+		*p++ = entry->recipe_id;
+		*p++ = entry->status;
+		write_be32(p, entry->queued_ms);
+		p += 4;
+		write_be32(p, entry->start_ms);
+		p += 4;
+		write_be32(p, entry->end_ms);
+		p += 4;
+		*p++ = entry->step_count;
+		*p++ = entry->steps_dropped;
+		for (uint8_t i = 0; i < entry->step_count; i++) {
+			const JobHistoryStep_t* step = &entry->steps[i];
+			*p++ = step->step_pc;
+			*p++ = step->slowest_exec;
+			*p++ = (uint8_t)(step->runs >> 8);
+			*p++ = (uint8_t)(step->runs & 0xFF);
+			write_be32(p, step->total_ms);
+			p += 4;
+			write_be32(p, step->max_ms);
+			p += 4;
+		}
+		Dispatcher_SendData(command_code, 0x03, 0x0000, data_payload, (uint16_t)(p - data_payload));
+		after_seq = entry->seq;
+	}
+	Dispatcher_SendDone(command_code, 0x0000);
+}
+
+/**
+      * @brief Handler for the direct command JOB_TRACE (0x100F)
+      *        Stops the job trace (job_trace.h) and dumps it as a raw byte stream, one DATA frame
+      *        per chunk. The trace stays frozen until reboot, so an interrupted dump is resumed
+      *        from the last offset received.
+      * @param params params[0..3] (optional): offset of the first byte to send (Big-endian)
+      *        DATA: offset(4, Big-endian), up to JOB_TRACE_CHUNK_SIZE trace bytes
+     */
+void handle_job_trace(uint16_t command_code, const uint8_t* params, uint16_t params_len)
+{
+	if (params_len != 0 && params_len != 4) {
+		Dispatcher_SendError(command_code, 0x0003);
+		return;
+	}
+	uint32_t offset = (params_len == 4) ? read_be32(params) : 0;
+
+	JobTrace_Stop();
+	uint32_t length = 0;
+	const uint8_t* trace = JobTrace_GetData(&length);
+	if (trace == NULL) {
+		Dispatcher_SendUsbResponse("ERROR: Job trace: recording is disabled in this build (APP_JOB_TRACE_BYTES).");
+		Dispatcher_SendError(command_code, 0x000A);
+		return;
+	}
+	if (offset > length) {
+		Dispatcher_SendError(command_code, 0x0003);
+		return;
+	}
+
+	uint8_t data_payload[JOB_TRACE_CHUNK_HEADER + JOB_TRACE_CHUNK_SIZE];
+	while (offset < length) {
+		const uint32_t chunk = (length - offset < JOB_TRACE_CHUNK_SIZE) ? length - offset : JOB_TRACE_CHUNK_SIZE;
+		write_be32(data_payload, offset);
+		memcpy(&data_payload[JOB_TRACE_CHUNK_HEADER], &trace[offset], chunk);
+		Dispatcher_SendData(command_code, 0x03, 0x0000, data_payload, (uint16_t)(JOB_TRACE_CHUNK_HEADER + chunk));
+		offset += chunk;
+	}
+	Dispatcher_SendDone(command_code, 0x0000);
+}
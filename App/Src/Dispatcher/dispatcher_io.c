@@ -6,6 +6,8 @@
  */
 
 #include "Dispatcher/dispatcher_io.h"
+#include "Dispatcher/job_trace.h"
+#include "Dispatcher/host_seq.h"
 #include "shared_resources.h" // Для доступа к usb_tx_queue_handle
 #include "app_config.h"       // Для APP_USB_RESP_MAX_LEN
 #include <string.h>           // Для strncpy
@@ -31,6 +33,7 @@ static void send_packet_to_queue(const void* data, uint16_t length, bool is_stri
 		 tx_packet.data[length] = '\0';
 		 }
 
+	 JobTrace_Output(tx_packet.data, length);
 	 xQueueSend(usb_tx_queue_handle, &tx_packet, pdMS_TO_TICKS(100));
 	 }
 
@@ -50,8 +53,46 @@ static uint8_t calculate_crc(const uint8_t* data, uint16_t length)
 	return crc;
 	}
 
+// Ответ команде с номером (шапка "CS>", см. host_seq.h): номер перед кодом команды.
+// Возвращает false, если текущая команда без номера - ответ собирает вызывающая функция.
+static bool send_sequenced(uint16_t command_code, uint8_t response_type, uint16_t status, const uint8_t* data, uint16_t data_len)
+{
+	uint16_t seq;
+	if (!HostSeq_Current(&seq)) {
+		return false;
+		}
+	HostSeq_Record(command_code, response_type, status);
+
+	uint16_t payload_len = (uint16_t)(2 + 2 + 1 + 2 + data_len + 1); // Seq + Cmd + Type + Status + Data + CRC
+	uint16_t total_packet_len = 3 + 2 + payload_len;
+	if (total_packet_len > APP_USB_RESP_MAX_LEN) {
+		return true; // Как Dispatcher_SendData: слишком длинный пакет не отправляется
+		}
+
+	uint8_t packet[APP_USB_RESP_MAX_LEN];
+	packet[0] = 0x43; packet[1] = 0x53; packet[2] = 0x3E; // "CS>"
+	packet[3] = (uint8_t)(payload_len >> 8);
+	packet[4] = (uint8_t)(payload_len & 0xFF);
+	packet[5] = (uint8_t)(seq >> 8);
+	packet[6] = (uint8_t)(seq & 0xFF);
+	packet[7] = (uint8_t)(command_code >> 8);
+	packet[8] = (uint8_t)(command_code & 0xFF);
+	packet[9] = response_type;
+	packet[10] = (uint8_t)(status >> 8);
+	packet[11] = (uint8_t)(status & 0xFF);
+	if (data_len > 0 && data != NULL) {
+		memcpy(&packet[12], data, data_len);
+		}
+	packet[12 + data_len] = calculate_crc(&packet[5], (uint16_t)(payload_len - 1)); // От номера до конца данных
+	send_packet_to_queue(packet, total_packet_len, false);
+	return true;
+	}
+
 void Dispatcher_SendAck(uint16_t command_code)
 {
+	if (send_sequenced(command_code, 0x01, 0x0000, NULL, 0)) {
+		return;
+		}
 	uint8_t ack_packet[11];
 	ack_packet[0] = 0x43; ack_packet[1] = 0x4D; ack_packet[2] = 0x3E; // Header
 	ack_packet[3] = 0x00; ack_packet[4] = 0x06; // Length
@@ -66,6 +107,9 @@ void Dispatcher_SendAck(uint16_t command_code)
 
 void Dispatcher_SendNack(uint16_t command_code, uint16_t error_code)
 {
+	if (send_sequenced(command_code, 0x00, error_code, NULL, 0)) {
+		return;
+		}
 	uint8_t nack_packet[11];
 	nack_packet[0] = 0x43; nack_packet[1] = 0x4D; nack_packet[2] = 0x3E; // Header
 	nack_packet[3] = 0x00; nack_packet[4] = 0x06; // Length
@@ -80,6 +124,9 @@ void Dispatcher_SendNack(uint16_t command_code, uint16_t error_code)
 
 void Dispatcher_SendDone(uint16_t command_code, uint16_t status)
 {
+	if (send_sequenced(command_code, 0x02, status, NULL, 0)) {
+		return;
+		}
 	// Структура идентична ACK/NACK
 	uint8_t done_packet[11];
 
@@ -111,6 +158,9 @@ void Dispatcher_SendError(uint16_t command_code, uint16_t error_code)
 	// По протоколу, NACK и ERROR могут иметь разный семантический смысл:
 	// NACK - ошибка в самом пакете (CRC, неверный формат).
 	// ERROR - ошибка выполнения самой команды на уровне логики.
+	if (send_sequenced(command_code, 0x04, error_code, NULL, 0)) {
+		return;
+		}
 
 	uint8_t error_packet[11];
 
@@ -140,6 +190,9 @@ void Dispatcher_SendError(uint16_t command_code, uint16_t error_code)
 
 void Dispatcher_SendData(uint16_t command_code, uint8_t response_type, uint16_t status, const uint8_t* data, uint16_t data_len)
 {
+	if (send_sequenced(command_code, response_type, status, data, data_len)) {
+		return;
+		}
     // Total payload length: Cmd Code (2) + Type (1) + Status (2) + Data (data_len) + CRC (1)
 	uint16_t payload_segment_len_for_crc = 2 + 1 + 2 + data_len; // Command Code + Type + Status + Data
 	uint16_t payload_len = payload_segment_len_for_crc + 1; // Add 1 byte for CRC
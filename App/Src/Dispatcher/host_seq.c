@@ -0,0 +1,179 @@
+/*
+ * host_seq.c
+ *
+ *  Created on: Mar 9, 2026
+ *      Author: andrey
+ */
+
+#include "Dispatcher/host_seq.h"
+#include "Dispatcher/dispatcher_io.h"
+#include <stddef.h>
+#include <string.h>
+
+#define HOST_SEQ_NO_REPLY       0xFF    // Ответ этого вида еще не отправлялся
+#define HOST_SEQ_ERR_BUSY       0x0004  // ERR_BUSY (errors.md): все строки заняты выполняющимися заданиями
+
+/**
+ * @brief Запомненные ответы одной команде с номером.
+ */
+typedef struct {
+	uint16_t seq;
+	uint16_t command_code;
+	uint16_t ack_status;
+	uint16_t final_status;
+	uint8_t crc;
+	uint8_t ack_type;           // 0x01 ACK, 0x00 NACK или HOST_SEQ_NO_REPLY
+	uint8_t final_type;         // 0x02 DONE, 0x04 ERROR или HOST_SEQ_NO_REPLY
+	bool used;
+} HostSeqEntry_t;
+
+// --- Внутренние переменные ---
+// Только задача диспетчера: разбор команд и завершение заданий (см. job_inbox.h)
+static HostSeqEntry_t g_entries[HOST_SEQ_CACHE_SIZE];
+static uint8_t g_next = 0;          // Строка, которую займет следующая новая команда
+static bool g_active = false;       // Ответы адресуются команде g_seq
+static uint16_t g_seq = 0;
+
+// --- Внутренние функции ---
+
+static HostSeqEntry_t* HostSeq_Find(uint16_t seq)
+{
+	for (uint8_t i = 0; i < HOST_SEQ_CACHE_SIZE; i++) {
+		if (g_entries[i].used && g_entries[i].seq == seq) {
+			return &g_entries[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Строка команды, чье задание еще выполняется (ACK отправлен, итога нет).
+ *        Ее нельзя вытеснять: повтор такой команды запустил бы задание второй раз.
+ */
+static bool HostSeq_IsPinned(const HostSeqEntry_t* entry)
+{
+	return entry->used && entry->ack_type == 0x01 && entry->final_type == HOST_SEQ_NO_REPLY;
+}
+
+/**
+ * @brief Строка для новой команды: самая старая, кроме закрепленных.
+ * @return NULL - все строки закреплены.
+ */
+static HostSeqEntry_t* HostSeq_Evict(void)
+{
+	for (uint8_t n = 0; n < HOST_SEQ_CACHE_SIZE; n++) {
+		const uint8_t i = (uint8_t)((g_next + n) % HOST_SEQ_CACHE_SIZE);
+		if (!HostSeq_IsPinned(&g_entries[i])) {
+			g_next = (uint8_t)((i + 1) % HOST_SEQ_CACHE_SIZE);
+			return &g_entries[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Повторяет запомненные ответы. Итог выполняющегося задания не повторяется:
+ *        он придет при завершении.
+ */
+static void HostSeq_Replay(const HostSeqEntry_t* entry)
+{
+	if (entry->ack_type == 0x01) {
+		Dispatcher_SendAck(entry->command_code);
+	} else if (entry->ack_type == 0x00) {
+		Dispatcher_SendNack(entry->command_code, entry->ack_status);
+	}
+	if (entry->final_type == 0x02) {
+		Dispatcher_SendDone(entry->command_code, entry->final_status);
+	} else if (entry->final_type == 0x04) {
+		Dispatcher_SendError(entry->command_code, entry->final_status);
+	}
+}
+
+// --- API функции ---
+
+void HostSeq_Init(void)
+{
+	memset(g_entries, 0, sizeof(g_entries));
+	g_next = 0;
+	g_active = false;
+	g_seq = 0;
+}
+
+bool HostSeq_Begin(uint16_t seq, uint16_t command_code, uint8_t crc)
+{
+	HostSeqEntry_t* entry = HostSeq_Find(seq);
+	g_active = true;
+	g_seq = seq;
+
+	if (entry != NULL && entry->command_code == command_code && entry->crc == crc) {
+		HostSeq_Replay(entry);
+		HostSeq_End();
+		return false;
+	}
+
+	if (entry == NULL) {
+		// Вытесняется самая старая завершенная команда: ее повтор будет выполнен заново
+		entry = HostSeq_Evict();
+	} else if (HostSeq_IsPinned(entry)) {
+		// Номер занят командой, чье задание выполняется: ее DONE адресован этому номеру
+		entry = NULL;
+	}
+	if (entry == NULL) {
+		// Команда не запоминается: ПК повторит ее с тем же номером позже
+		Dispatcher_SendNack(command_code, HOST_SEQ_ERR_BUSY);
+		HostSeq_End();
+		return false;
+	}
+	entry->seq = seq;
+	entry->command_code = command_code;
+	entry->crc = crc;
+	entry->ack_type = HOST_SEQ_NO_REPLY;
+	entry->final_type = HOST_SEQ_NO_REPLY;
+	entry->used = true;
+	return true;
+}
+
+void HostSeq_Resume(uint16_t seq)
+{
+	g_active = true;
+	g_seq = seq;
+}
+
+void HostSeq_End(void)
+{
+	g_active = false;
+}
+
+bool HostSeq_Current(uint16_t* out_seq)
+{
+	*out_seq = g_seq;
+	return g_active;
+}
+
+void HostSeq_Record(uint16_t command_code, uint8_t response_type, uint16_t status)
+{
+	if (!g_active) {
+		return;
+	}
+	HostSeqEntry_t* entry = HostSeq_Find(g_seq);
+	if (entry == NULL || entry->command_code != command_code) {
+		return; // Строка уже отдана другой команде
+	}
+	switch (response_type) {
+		case 0x00: // NACK
+		case 0x01: // ACK
+			if (HostSeq_IsPinned(entry)) {
+				break; // NACK ERR_BUSY другой команде с номером выполняющейся: строка не ее
+			}
+			entry->ack_type = response_type;
+			entry->ack_status = status;
+			break;
+		case 0x02: // DONE
+		case 0x04: // ERROR
+			entry->final_type = response_type;
+			entry->final_status = status;
+			break;
+		default:   // DATA не запоминаются
+			break;
+	}
+}
@@ -0,0 +1,102 @@
+/*
+ * job_history.c
+ *
+ *  Created on: Mar 9, 2026
+ *      Author: andrey
+ */
+
+#include "Dispatcher/job_history.h"
+#include <string.h>
+#include <stddef.h> // Для offsetof
+
+// --- Внутренние переменные ---
+// Записи выполняющихся заданий (по слоту JobManager'а) и кольцо завершенных.
+// Запись с номером seq лежит в g_ring[(seq - 1) % JOB_HISTORY_DEPTH].
+static JobHistoryEntry_t g_open[APP_MAX_ACTIVE_JOBS];
+static JobHistoryEntry_t g_ring[JOB_HISTORY_DEPTH];
+static bool g_started[APP_MAX_ACTIVE_JOBS];
+static uint32_t g_last_seq = 0;
+
+// --- API функции ---
+
+void JobHistory_Init(void)
+{
+	memset(g_open, 0, sizeof(g_open));
+	memset(g_ring, 0, sizeof(g_ring));
+	memset(g_started, 0, sizeof(g_started));
+	g_last_seq = 0;
+}
+
+void JobHistory_Open(uint8_t slot, uint32_t queued_ms)
+{
+	JobHistoryEntry_t* entry = &g_open[slot];
+	entry->queued_ms = queued_ms;
+	entry->step_count = 0;
+	entry->steps_dropped = 0;
+	g_started[slot] = false;
+}
+
+void JobHistory_Started(uint8_t slot, uint32_t now_ms)
+{
+	g_open[slot].start_ms = now_ms;
+	g_started[slot] = true;
+}
+
+void JobHistory_Step(uint8_t slot, uint8_t step_pc, uint32_t duration_ms, uint8_t exec_id)
+{
+	JobHistoryEntry_t* entry = &g_open[slot];
+	JobHistoryStep_t* step = NULL;
+	for (uint8_t i = 0; i < entry->step_count; i++) {
+		if (entry->steps[i].step_pc == step_pc) {
+			step = &entry->steps[i];
+			break;
+		}
+	}
+	if (step == NULL) {
+		if (entry->step_count >= JOB_HISTORY_MAX_STEPS) {
+			if (entry->steps_dropped < 0xFF) {
+				entry->steps_dropped++;
+			}
+			return;
+		}
+		step = &entry->steps[entry->step_count++];
+		memset(step, 0, sizeof(*step));
+		step->step_pc = step_pc;
+	}
+
+	step->total_ms += duration_ms;
+	if (step->runs < 0xFFFF) {
+		step->runs++;
+	}
+	if (step->runs == 1 || duration_ms > step->max_ms) {
+		step->max_ms = duration_ms;
+		step->slowest_exec = exec_id;
+	}
+}
+
+void JobHistory_Close(uint8_t slot, uint16_t job_id, uint8_t recipe_id, uint8_t status, uint32_t end_ms)
+{
+	JobHistoryEntry_t* entry = &g_open[slot];
+	entry->seq = ++g_last_seq;
+	entry->end_ms = end_ms;
+	entry->job_id = job_id;
+	entry->recipe_id = recipe_id;
+	entry->status = status;
+	if (!g_started[slot]) {
+		entry->start_ms = end_ms; // Задание завершилось, не дождавшись запуска
+	}
+
+	// Копируются только заполненные строки шагов
+	JobHistoryEntry_t* dst = &g_ring[(entry->seq - 1) % JOB_HISTORY_DEPTH];
+	memcpy(dst, entry, offsetof(JobHistoryEntry_t, steps) + entry->step_count * sizeof(JobHistoryStep_t));
+}
+
+const JobHistoryEntry_t* JobHistory_GetNext(uint32_t after_seq)
+{
+	const uint32_t oldest = (g_last_seq > JOB_HISTORY_DEPTH) ? (g_last_seq - JOB_HISTORY_DEPTH + 1) : 1;
+	const uint32_t seq = (after_seq < oldest) ? oldest : after_seq + 1;
+	if (seq > g_last_seq) {
+		return NULL;
+	}
+	return &g_ring[(seq - 1) % JOB_HISTORY_DEPTH];
+}
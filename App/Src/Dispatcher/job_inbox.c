@@ -0,0 +1,126 @@
+/*
+ * job_inbox.c
+ *
+ *  Created on: Mar 9, 2026
+ *      Author: andrey
+ */
+
+#include "Dispatcher/job_inbox.h"
+#include "Dispatcher/job_manager.h"
+#include "Dispatcher/cycle_scheduler.h"
+#include "Dispatcher/job_trace.h"
+#include "Tasks/task_dispatcher.h"
+#include "Tasks/task_jobs_monitor.h"
+#include <stdatomic.h>
+
+#if (JOB_INBOX_DEPTH & (JOB_INBOX_DEPTH - 1)) != 0
+#error "APP_JOB_INBOX_DEPTH must be a power of two"
+#endif
+
+#define JOB_INBOX_MASK      (JOB_INBOX_DEPTH - 1u)
+
+/*
+ * Ячейка кольца. Номер ячейки с индексом i проходит значения:
+ *   pos          - свободна для записи с позиции pos (pos & MASK == i);
+ *   pos + 1      - запись с позиции pos закончена, ее можно читать;
+ *   pos + DEPTH  - прочитана, свободна для позиции следующего круга.
+ */
+typedef struct {
+	atomic_uint seq;
+	CAN_Response_t response;
+} JobInboxCell_t;
+
+// --- Внутренние переменные ---
+static JobInboxCell_t g_cells[JOB_INBOX_DEPTH] APP_DTCM_BSS;
+static atomic_uint g_tail;          // Следующая позиция записи (производители)
+static unsigned int g_head = 0;     // Следующая позиция чтения (только владелец)
+static atomic_bool g_timer_pending;
+static atomic_uint g_dropped;
+
+// --- API функции ---
+
+void JobInbox_Init(void)
+{
+	for (unsigned int i = 0; i < JOB_INBOX_DEPTH; i++) {
+		atomic_init(&g_cells[i].seq, i);
+		}
+	atomic_init(&g_tail, 0u);
+	g_head = 0;
+	atomic_init(&g_timer_pending, false);
+	atomic_init(&g_dropped, 0u);
+}
+
+bool JobInbox_PostResponse(const CAN_Response_t* response)
+{
+	unsigned int pos = atomic_load_explicit(&g_tail, memory_order_relaxed);
+	JobInboxCell_t* cell;
+	for (;;) {
+		cell = &g_cells[pos & JOB_INBOX_MASK];
+		const unsigned int seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+		const int diff = (int)(seq - pos);
+		if (diff == 0) {
+			// Ячейка свободна: захватываем позицию (при неудаче pos обновится)
+			if (atomic_compare_exchange_weak_explicit(&g_tail, &pos, pos + 1,
+			                                          memory_order_relaxed, memory_order_relaxed)) {
+				break;
+				}
+			}
+		else if (diff < 0) {
+			// Владелец еще не прочитал ячейку прошлого круга: кольцо заполнено
+			atomic_fetch_add_explicit(&g_dropped, 1u, memory_order_relaxed);
+			return false;
+			}
+		else {
+			pos = atomic_load_explicit(&g_tail, memory_order_relaxed); // Позицию заняли раньше нас
+			}
+		}
+
+	cell->response = *response;
+	atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+	Dispatcher_Wakeup();
+	return true;
+}
+
+void JobInbox_PostTimer(void)
+{
+	atomic_store_explicit(&g_timer_pending, true, memory_order_release);
+	Dispatcher_Wakeup();
+}
+
+void JobInbox_Process(void)
+{
+	// Ответы - в порядке захвата позиций. Ячейка, запись в которую еще не
+	// закончена, останавливает чтение: ее производитель разбудит владельца снова.
+	for (;;) {
+		JobInboxCell_t* cell = &g_cells[g_head & JOB_INBOX_MASK];
+		const unsigned int seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+		if (seq != g_head + 1) {
+			break;
+			}
+		const CAN_Response_t response = cell->response;
+		atomic_store_explicit(&cell->seq, g_head + JOB_INBOX_DEPTH, memory_order_release);
+		g_head++;
+		JobTrace_Response(&response);
+		JobManager_ProcessExecutorResponse(response.job_id, response.executor_id, response.action_tag, response.status_ok);
+		}
+
+	if (atomic_exchange_explicit(&g_timer_pending, false, memory_order_acq_rel)) {
+		JobInbox_RunTimers();
+		}
+}
+
+void JobInbox_RunTimers(void)
+{
+	JobTrace_Timer();
+	uint32_t next_deadline_ms = JobManager_Run();
+	uint32_t next_cycle_ms = CycleScheduler_Run(); // Слоты машинного цикла
+	if (next_cycle_ms < next_deadline_ms) {
+		next_deadline_ms = next_cycle_ms;
+		}
+	JobsMonitor_Arm(next_deadline_ms);
+}
+
+uint32_t JobInbox_GetDroppedCount(void)
+{
+	return atomic_load_explicit(&g_dropped, memory_order_relaxed);
+}
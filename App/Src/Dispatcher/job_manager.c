@@ -8,275 +8,1350 @@
 #include "Dispatcher/job_manager.h"
 #include "Dispatcher/dispatcher_io.h"
 #include "Dispatcher/can_packer.h"
+#include "Dispatcher/action_frames.h"
+#include "Dispatcher/motion_profile.h"
+#include "Dispatcher/deadline_queue.h"
+#include "Dispatcher/job_history.h"
+#include "Dispatcher/job_inbox.h"
+#include "Dispatcher/job_trace.h"
+#include "Dispatcher/host_seq.h"
 #include "shared_resources.h"
 #include "app_config.h"
 #include "app_init_checker.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include "main.h" // Для HAL_GetTick()
 
 // --- Внутренние переменные ---
-static JobContext_t g_active_jobs[MAX_CONCURRENT_JOBS];
-static uint32_t g_next_job_id = 1;
+static JobContext_t g_active_jobs[MAX_CONCURRENT_JOBS] APP_DTCM_BSS;
+
+// Свободные слоты: кольцевая очередь номеров. Слот, освободившийся последним, занимается
+// последним - так его job_id дольше не повторяется.
+static uint8_t g_free_slots[MAX_CONCURRENT_JOBS] APP_DTCM_BSS;
+static uint8_t g_free_head = 0;
+static uint8_t g_free_count = 0;
+
+// job_id = (поколение слота << JOB_ID_SLOT_BITS) | номер слота.
+// Поиск задания по ID - O(1), а ответ на завершенное задание из того же слота
+// отсекается несовпадением поколения. ID укладывается в 16-битный тег CAN-кадра.
+#define JOB_ID_SLOT_BITS        6
+#define JOB_ID_SLOT_MASK        ((1u << JOB_ID_SLOT_BITS) - 1)
+#define JOB_ID_GENERATION_MAX   (CAN_JOB_TAG_MAX >> JOB_ID_SLOT_BITS)
+
+#if MAX_CONCURRENT_JOBS > (1 << JOB_ID_SLOT_BITS)
+#error "Номер слота задания не помещается в JOB_ID_SLOT_BITS"
+#endif
+
+// --- Планировщик: очередь заданий, ожидающих ресурсы ---
+static uint8_t g_wait_queue[MAX_CONCURRENT_JOBS] APP_DTCM_BSS; // Номера слотов в порядке поступления
+static uint8_t g_wait_count = 0;
+static ResourceMask_t g_locked_resources = 0; // Ресурсы, захваченные выполняющимися заданиями
+static bool g_scheduling = false;             // Защита от рекурсии: задание может завершиться прямо при запуске
+static bool g_schedule_again = false;
+static JobClassStats_t g_class_stats[JOB_PRIORITY_COUNT];
+
+// --- Выполнение шагов: задания, готовые перейти к следующему шагу ---
+// Шаг запускается не из обработчика события (ответ исполнителя, таймер, запуск из очереди),
+// а из цикла JobManager_RunReadySteps: глубина стека не растет с числом мгновенных шагов
+// и заданий, запущенных друг за другом.
+static uint8_t g_ready_queue[MAX_CONCURRENT_JOBS] APP_DTCM_BSS; // Номера слотов в порядке готовности
+static uint8_t g_ready_head = 0;
+static uint8_t g_ready_count = 0;
+static uint64_t g_ready_slots = 0;            // Бит слота: слот уже в g_ready_queue
+static bool g_running_steps = false;          // Цикл уже выполняется: вложенный вызов только ставит в очередь
+
+// Очередность обслуживания классов: 0 - первым
+static const uint8_t k_priority_rank[JOB_PRIORITY_COUNT] = {
+	[JOB_PRIORITY_STAT]        = 0,
+	[JOB_PRIORITY_ROUTINE]     = 1,
+	[JOB_PRIORITY_MAINTENANCE] = 2,
+};
+
+// Таймер действия: слот задания * APP_MAX_STEP_ACTIONS + номер действия в шаге
+#define JOB_ACTION_TIMER(job, action_index) \
+	((TimerId_t)(((job) - g_active_jobs) * APP_MAX_STEP_ACTIONS + (action_index)))
+
+// Тег действия в кадре CAN (Data[7]): счетчик шагов задания (5 бит) и номер действия в шаге (3 бита).
+// Счетчик шагов отсекает запоздавшие ответы на действие с тем же номером из предыдущего шага.
+#define JOB_ACTION_TAG(job, action_index)   ((uint8_t)((((job)->step_seq & 0x1F) << 3) | (action_index)))
+#define JOB_ACTION_TAG_STEP(tag)            ((uint8_t)((tag) >> 3))
+#define JOB_ACTION_TAG_INDEX(tag)           ((uint8_t)((tag) & 0x07))
+
+#if APP_MAX_STEP_ACTIONS > 8
+#error "pending_mask и тег действия рассчитаны не более чем на 8 действий в шаге"
+#endif
+
+static uint32_t g_stale_responses = 0; // Отброшенные повторные/запоздавшие ответы исполнителей
 
 // --- Прототипы внутренних функций ---
+static uint32_t JobManager_CreateJob(const UniversalCommand_t* parsed_cmd, JobDoneCallback_t on_done, uint8_t owner_tag);
 static JobContext_t* JobManager_FindJob(uint32_t job_id);
-static JobContext_t* JobManager_FindFreeSlot(void);
+static JobContext_t* JobManager_AllocSlot(void);
+static void JobManager_FreeSlot(JobContext_t* job);
+static void JobManager_Schedule(void);
+static void JobManager_Admit(JobContext_t* job);
+static void JobManager_Dequeue(JobContext_t* job);
+static uint8_t JobManager_EffectiveRank(const JobContext_t* job, uint32_t now_ms);
+static void JobManager_SortWaitQueue(uint32_t now_ms);
+static void JobManager_MakeReady(JobContext_t* job);
+static void JobManager_RunReadySteps(void);
 static void JobManager_ExecuteStep(JobContext_t* job);
+static bool JobManager_ExecuteControl(JobContext_t* job, const RecipeInstr_t* instr);
+static bool JobManager_StartAction(JobContext_t* job, uint8_t index);
+static void JobManager_SendActionFrames(const JobContext_t* job, uint8_t index, const RecipeInstr_t* instr, uint8_t device, int32_t value);
+static bool JobManager_StartReadyActions(JobContext_t* job);
+static void JobManager_StartHoming(JobContext_t* job, uint8_t index);
+static void JobManager_SendMotionSetup(uint8_t device, uint16_t speed);
+static uint8_t JobManager_StepActionCount(const JobContext_t* job);
+static bool JobManager_PumpStoppedInStep(const JobContext_t* job, uint8_t start_index, uint8_t unfinished);
+static uint8_t JobManager_ActionDeps(const JobContext_t* job, uint8_t index);
+static int32_t JobManager_InstrValue(const JobContext_t* job, const RecipeInstr_t* instr);
+static void JobManager_DecodeAction(const JobContext_t* job, const RecipeInstr_t* instr, AtomicAction_t* out_action);
+static ResourceMask_t JobManager_CollectDevices(const JobContext_t* job);
+static void JobManager_FailStep(JobContext_t* job, uint8_t action_index, JobStatus_t status, const char* reason_fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+static void JobManager_StopStep(JobContext_t* job, uint8_t failed_action, bool all_devices);
+static void JobManager_StopDevices(const JobContext_t* job, ResourceMask_t devices);
+static void JobManager_AbortJob(JobContext_t* job);
 static void JobManager_CompleteJob(JobContext_t* job, JobStatus_t final_status);
+static void JobManager_SendDone(const JobContext_t* job, uint16_t status);
 static void JobManager_SignalSystemReady(void);
+static void JobManager_ActionDone(JobContext_t* job, uint8_t action_index);
+static void JobManager_RecordStep(JobContext_t* job, uint8_t action_index);
+static void JobManager_ArmActionTimer(JobContext_t* job, uint8_t action_index, uint32_t deadline_ms);
+static void JobManager_CancelTimers(JobContext_t* job);
+static bool JobManager_GetActionTarget(const AtomicAction_t* action, uint8_t* executor_id, uint8_t* device_id);
+static void JobManager_ForgetMotion(const JobContext_t* job, uint8_t action_index);
+static const char* JobManager_ActionName(ActionType_t action);
+static const char* JobManager_StepActionName(const JobContext_t* job, uint8_t action_index, const AtomicAction_t* action);
+static void JobManager_Report(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+static bool JobManager_SendCan(const CAN_Message_t* msg);
+static void JobManager_ReportFailure(const JobContext_t* job, const char* reason_fmt, va_list reason_args);
 
 // --- API функции ---
 
 void JobManager_Init(void)
 {
+	// Таблица лежит в NOLOAD-секции: инициализируем все слоты явно
+	memset(g_active_jobs, 0, sizeof(g_active_jobs));
 	for (int i = 0; i < MAX_CONCURRENT_JOBS; i++) {
 		g_active_jobs[i].status = JOB_STATUS_IDLE;
-        g_active_jobs[i].job_id = 0;
+		g_free_slots[i] = (uint8_t)i;
      }
-     g_next_job_id = 1;
+     g_free_head = 0;
+     g_free_count = MAX_CONCURRENT_JOBS;
+     g_wait_count = 0;
+     g_locked_resources = 0;
+     g_scheduling = false;
+     g_schedule_again = false;
+     g_ready_head = 0;
+     g_ready_count = 0;
+     g_ready_slots = 0;
+     g_running_steps = false;
+     memset(g_class_stats, 0, sizeof(g_class_stats));
+     DeadlineQueue_Init();
+     JobHistory_Init();
+     JobInbox_Init();
+     JobTrace_Init();
+     ActionFrames_Init();
+     MotionProfile_Init();
+     HostSeq_Init();
 }
 
 uint32_t JobManager_StartNewJob(const UniversalCommand_t* parsed_cmd)
 {
-	JobContext_t* job = JobManager_FindFreeSlot();
+	return JobManager_StartOwnedJob(parsed_cmd, NULL, 0);
+}
+
+uint32_t JobManager_StartOwnedJob(const UniversalCommand_t* parsed_cmd, JobDoneCallback_t on_done, uint8_t owner_tag)
+{
+	const uint32_t job_id = JobManager_CreateJob(parsed_cmd, on_done, owner_tag);
+	JobManager_RunReadySteps();
+	return job_id;
+}
+
+bool JobManager_ProcessExecutorResponse(uint32_t job_id, uint8_t executor_id, uint8_t action_tag, bool action_status_ok)
+{
+	JobContext_t* job = JobManager_FindJob(job_id);
+	const uint8_t action_index = JOB_ACTION_TAG_INDEX(action_tag);
+	const uint8_t action_bit = (uint8_t)(1u << action_index);
+
+	// Запоздавшие и повторные ответы (задание завершено, шаг сменился, действие уже засчитано)
+	// отбрасываются без сообщений - их видно только в счетчике
+	if (job == NULL || job->status != JOB_STATUS_RUNNING ||
+	    JOB_ACTION_TAG_STEP(action_tag) != (job->step_seq & 0x1F) ||
+	    !(job->pending_mask & action_bit)) {
+		g_stale_responses++;
+		return false;
+	}
+
+	AtomicAction_t action;
+	JobManager_DecodeAction(job, &job->code[job->step_pc + action_index], &action);
+	uint8_t action_executor = 0, action_device = 0;
+	if (!JobManager_GetActionTarget(&action, &action_executor, &action_device) || action_executor != executor_id) {
+		g_stale_responses++; // Тег совпал, но ответил не тот исполнитель
+		return false;
+	}
+
+	DeadlineQueue_Cancel(JOB_ACTION_TIMER(job, action_index));
+
+	if (!action_status_ok) {
+		JobManager_FailStep(job, action_index, JOB_STATUS_ERROR, "Exec %u device %u reported error for pc %u (%s)",
+		                    executor_id, action_device, job->step_pc + action_index, JobManager_StepActionName(job, action_index, &action));
+	} else {
+		JobManager_ActionDone(job, action_index);
+	}
+	JobManager_RunReadySteps();
+	return true;
+}
+
+bool JobManager_CancelJob(uint32_t job_id)
+{
+	JobContext_t* job = JobManager_FindJob(job_id);
+	if (job == NULL) {
+		return false;
+	}
+	// Останавливаются все моторы и насосы задания: насос, включенный прежним шагом, еще работает
+	if (job->status == JOB_STATUS_RUNNING) {
+		JobManager_StopStep(job, APP_MAX_STEP_ACTIONS, true);
+	} else if (job->status == JOB_STATUS_PAUSED) {
+		JobManager_StopDevices(job, job->resources);
+	}
+	JobManager_Report("WARNING: Job #%lu cancelled by host at pc %u.", (unsigned long)job->job_id, job->step_pc);
+	JobManager_CompleteJob(job, JOB_STATUS_CANCELLED);
+	JobManager_RunReadySteps(); // Освободившиеся ресурсы могли запустить задания из очереди
+	return true;
+}
+
+bool JobManager_PauseJob(uint32_t job_id)
+{
+	JobContext_t* job = JobManager_FindJob(job_id);
+	if (job == NULL || job->status != JOB_STATUS_RUNNING) {
+		return false;
+	}
+	// Выполненные действия шага при продолжении не повторяются: запоминаем, что осталось
+	const uint8_t interrupted = job->pending_mask;
+	const uint8_t unfinished = (uint8_t)(job->pending_mask | job->waiting_mask);
+	const uint8_t num_actions = JobManager_StepActionCount(job);
+	JobManager_StopStep(job, APP_MAX_STEP_ACTIONS, false);
+
+	uint8_t restart = unfinished, homing = 0;
+	for (uint8_t i = 0; i < num_actions; i++) {
+		const uint8_t bit = (uint8_t)(1u << i);
+		const uint8_t op = job->code[job->step_pc + i].op;
+		if ((interrupted & bit) && op == RECIPE_OP_ROTATE_MOTOR) {
+			homing |= bit; // Пройденная часть перемещения неизвестна: сначала HOME
+		} else if (!(unfinished & bit) && op == RECIPE_OP_START_PUMP && !JobManager_PumpStoppedInStep(job, i, unfinished)) {
+			restart |= bit; // Насос выключен остановкой шага, а блок ждет его работы
+		}
+	}
+	job->waiting_mask = (uint8_t)(restart & ~homing);
+	job->homing_mask = homing;
+	job->status = JOB_STATUS_PAUSED;
+	JobManager_Report("WARNING: Job #%lu paused at pc %u.", (unsigned long)job->job_id, job->step_pc);
+	return true;
+}
+
+bool JobManager_ResumeJob(uint32_t job_id)
+{
+	JobContext_t* job = JobManager_FindJob(job_id);
+	if (job == NULL || job->status != JOB_STATUS_PAUSED) {
+		return false;
+	}
+	// Прерванный шаг продолжается: запускаются только оставшиеся действия (JobManager_PauseJob).
+	// Новый step_seq отсекает ответы на действия, прерванные паузой.
+	job->status = JOB_STATUS_RUNNING;
+	job->step_seq++;
+	job->step_start_time_ms = HAL_GetTick();
+	JobManager_Report("INFO: Job #%lu resumed at pc %u: actions 0x%02X left, motors of 0x%02X are homed first.",
+	                  (unsigned long)job->job_id, job->step_pc, job->waiting_mask | job->homing_mask, job->homing_mask);
+
+	for (uint8_t i = 0; i < APP_MAX_STEP_ACTIONS; i++) {
+		if (job->homing_mask & (1u << i)) {
+			JobManager_StartHoming(job, i);
+		}
+	}
+	if (job->waiting_mask == 0 || JobManager_StartReadyActions(job)) {
+		if (job->pending_mask == 0) {
+			JobManager_RecordStep(job, APP_MAX_STEP_ACTIONS);
+			job->fail_pc = RECIPE_PC_NONE;
+			JobManager_MakeReady(job); // job->pc уже указывает за прерванный шаг
+		}
+	}
+	JobManager_RunReadySteps();
+	return true;
+}
+
+uint16_t JobManager_GetActiveJobCount(void)
+{
+	return (uint16_t)(MAX_CONCURRENT_JOBS - g_free_count);
+}
+
+uint8_t JobManager_GetSnapshot(uint8_t first, JobSnapshot_t* out, uint8_t max_count, uint8_t* out_total)
+{
+	const uint32_t now = HAL_GetTick();
+	uint8_t total = 0, count = 0;
+	for (uint8_t slot = 0; slot < MAX_CONCURRENT_JOBS; slot++) {
+		const JobContext_t* job = &g_active_jobs[slot];
+		if (job->status == JOB_STATUS_IDLE) {
+			continue;
+		}
+		if (total++ < first || count >= max_count) {
+			continue;
+		}
+		JobSnapshot_t* snap = &out[count++];
+		const bool queued = (job->status == JOB_STATUS_QUEUED);
+		const uint32_t step_ms = now - job->step_start_time_ms;
+		snap->elapsed_ms = now - job->queued_at_ms;
+		snap->job_id = job->job_id;
+		snap->step_ms = queued ? 0 : (uint16_t)((step_ms > 0xFFFF) ? 0xFFFF : step_ms);
+		snap->recipe_id = job->initial_recipe_id;
+		snap->status = job->status;
+		snap->priority = job->priority;
+		snap->step_pc = job->step_pc;
+		snap->pending_mask = job->pending_mask;
+		snap->waiting_mask = job->waiting_mask;
+	}
+	*out_total = total;
+	return count;
+}
+
+uint32_t JobManager_GetStaleResponseCount(void)
+{
+	return g_stale_responses;
+}
+
+void JobManager_GetClassStats(JobPriority_t priority, JobClassStats_t* out_stats)
+{
+	if (priority >= JOB_PRIORITY_COUNT) {
+		memset(out_stats, 0, sizeof(*out_stats));
+		return;
+	}
+	*out_stats = g_class_stats[priority];
+	out_stats->queued = 0;
+	for (uint8_t i = 0; i < g_wait_count; i++) {
+		if (g_active_jobs[g_wait_queue[i]].priority == priority) {
+			out_stats->queued++;
+		}
+	}
+}
+
+void JobManager_ResetClassStats(void)
+{
+	memset(g_class_stats, 0, sizeof(g_class_stats));
+}
+
+uint32_t JobManager_Run(void)
+{
+	const uint32_t now = HAL_GetTick();
+	TimerId_t timer_id;
+
+	while (DeadlineQueue_PopExpired(now, &timer_id)) {
+		JobContext_t* job = &g_active_jobs[timer_id / APP_MAX_STEP_ACTIONS];
+		const uint8_t action_index = (uint8_t)(timer_id % APP_MAX_STEP_ACTIONS);
+		if (job->status != JOB_STATUS_RUNNING || !(job->pending_mask & (1u << action_index))) {
+			continue;
+		}
+
+		AtomicAction_t action;
+		JobManager_DecodeAction(job, &job->code[job->step_pc + action_index], &action);
+		if (action.action == ACTION_WAIT_MS) {
+			// Ожидание закончилось: засчитываем его как выполненное действие
+			JobManager_ActionDone(job, action_index);
+		} else {
+			uint8_t executor_id = 0, device_id = 0;
+			JobManager_GetActionTarget(&action, &executor_id, &device_id);
+			const bool homing = (job->homing_mask & (1u << action_index)) != 0; // HOME ждет общий срок
+			JobManager_FailStep(job, action_index, JOB_STATUS_TIMEOUT, "Timed out: pc %u (%s) on Exec %u device %u missed its %u ms deadline",
+			                    job->step_pc + action_index, JobManager_StepActionName(job, action_index, &action),
+			                    executor_id, device_id, (action.timeout_ms && !homing) ? action.timeout_ms : JOB_TIMEOUT_MS);
+		}
+		JobManager_RunReadySteps();
+	}
+
+	uint32_t next_deadline;
+	if (!DeadlineQueue_Next(&next_deadline)) {
+		return JOB_MANAGER_NO_DEADLINE;
+	}
+	return Deadline_IsReached(now, next_deadline) ? 0 : (next_deadline - now);
+}
+
+// --- Внутренние функции ---
+
+/**
+ * @brief Создает задание и ставит его в очередь планировщика. Шаги запущенного
+ *        задания выполняет JobManager_RunReadySteps.
+ *        Задание с неизвестным рецептом или аргументом вне диапазона завершается
+ *        сразу: итог (DONE 0x0001 или on_done) уже отправлен, возвращается его ID.
+ * @return ID задания или 0, если свободных слотов нет (ответа еще не было).
+ */
+static uint32_t JobManager_CreateJob(const UniversalCommand_t* parsed_cmd, JobDoneCallback_t on_done, uint8_t owner_tag)
+{
+	JobContext_t* job = JobManager_AllocSlot();
     if (job == NULL) {
     	Dispatcher_SendUsbResponse("ERROR: No free job slots to start new job.");
         return 0;
     }
+    job->on_done = on_done;
+    job->owner_tag = owner_tag;
+    job->queued_at_ms = HAL_GetTick();
+    JobHistory_Open((uint8_t)(job - g_active_jobs), job->queued_at_ms);
 
     // Сохраняем ID до того, как он может быть обнулен в JobManager_CompleteJob
-    const uint32_t new_job_id = g_next_job_id++;
-    if (g_next_job_id == 0) g_next_job_id = 1;
+    const uint32_t new_job_id = job->job_id;
 
-    job->job_id = new_job_id;
     job->status = JOB_STATUS_RUNNING;
+    job->resources = 0; // Ресурсы еще не захвачены
     job->initial_recipe_id = parsed_cmd->recipe_id;
-    job->current_recipe = Recipe_Get(parsed_cmd->recipe_id);
-    if (job->current_recipe == NULL) {
-         char err_msg[APP_USB_RESP_MAX_LEN];
-         snprintf(err_msg, sizeof(err_msg), "ERROR: Job %lu: Unknown recipe ID %d.", (unsigned long)job->job_id, parsed_cmd->recipe_id);
-         Dispatcher_SendUsbResponse(err_msg);
+    job->command_code = parsed_cmd->command_code;
+    job->host_sequenced = HostSeq_Current(&job->host_seq); // Команда с номером: DONE повторится на ее повтор
+    job->code = Recipe_Get(parsed_cmd->recipe_id, &job->code_len);
+    if (job->code == NULL) {
+         JobManager_Report("ERROR: Job %lu: Unknown recipe ID %d.", (unsigned long)job->job_id, parsed_cmd->recipe_id);
          JobManager_CompleteJob(job, JOB_STATUS_ERROR);
-         return 0;
+         return new_job_id; // Команда уже получила итог: второй ответ (ERROR) не нужен
     }
-    job->current_step_index = 0;
-    job->pending_actions_count = 0;
+    job->pc = 0;
+    job->step_pc = 0;
+    job->fail_pc = RECIPE_PC_NONE;
+    job->loop_depth = 0;
+    job->pending_mask = 0;
+    job->waiting_mask = 0;
+    job->homing_mask = 0;
+    job->step_seq = 0;
     job->step_start_time_ms = HAL_GetTick();
-    job->initial_cmd = *parsed_cmd;
 
-    char ack_msg[APP_USB_RESP_MAX_LEN];
-    snprintf(ack_msg, sizeof(ack_msg), "INFO: Job #%lu started (Recipe ID:%d).", (unsigned long)job->job_id, job->initial_recipe_id);
-    Dispatcher_SendUsbResponse(ack_msg);
+    const int bad_arg = Recipe_DecodeArgs(parsed_cmd->recipe_id, parsed_cmd, job->args);
+    if (bad_arg >= 0) {
+         JobManager_Report("ERROR: Job %lu: Argument %d of recipe ID %d is out of range.", (unsigned long)job->job_id, bad_arg, parsed_cmd->recipe_id);
+         JobManager_CompleteJob(job, JOB_STATUS_ERROR);
+         return new_job_id;
+    }
+    // Моторы и насосы берутся из действий после подстановки аргументов
+    job->resources = Recipe_GetResources(parsed_cmd->recipe_id) | JobManager_CollectDevices(job);
+    job->priority = (parsed_cmd->priority < JOB_PRIORITY_COUNT) ? parsed_cmd->priority : JOB_PRIORITY_ROUTINE;
+
+    // Задание встает в очередь; планировщик запускает его сразу, если ресурсы свободны
+    job->status = JOB_STATUS_QUEUED;
+    g_wait_queue[g_wait_count++] = (uint8_t)(job - g_active_jobs);
+    JobManager_Schedule();
 
-    JobManager_ExecuteStep(job);
+    if (job->job_id == new_job_id && job->status == JOB_STATUS_QUEUED) {
+        JobManager_Report("INFO: Job #%lu queued (Recipe ID:%d), waiting for resources 0x%08lX.",
+                          (unsigned long)job->job_id, job->initial_recipe_id, (unsigned long)(job->resources & g_locked_resources));
+    }
     
     // Возвращаем сохраненный ID, так как job->job_id может быть уже равен 0
     return new_job_id;
 }
 
-bool JobManager_ProcessExecutorResponse(uint32_t job_id, uint8_t executor_id, bool action_status_ok)
+static JobContext_t* JobManager_FindJob(uint32_t job_id)
 {
-	JobContext_t* job = JobManager_FindJob(job_id);
-    if (job == NULL || job->status != JOB_STATUS_RUNNING) {
-             char err_msg[APP_USB_RESP_MAX_LEN];
-             snprintf(err_msg, sizeof(err_msg), "WARNING: Response for unknown/inactive Job #%lu from Exec %u.", (unsigned long)job_id, executor_id);
-             Dispatcher_SendUsbResponse(err_msg);
-             return false;
-    }
+	const uint32_t slot = job_id & JOB_ID_SLOT_MASK;
+	if (job_id == 0 || slot >= MAX_CONCURRENT_JOBS) {
+		return NULL;
+	}
+	JobContext_t* job = &g_active_jobs[slot];
+	if (job->status == JOB_STATUS_IDLE || job->job_id != job_id) {
+		return NULL; // Слот свободен или уже занят следующим поколением
+	}
+	return job;
+}
 
-     if (!action_status_ok) {
-             char err_msg[APP_USB_RESP_MAX_LEN];
-             snprintf(err_msg, sizeof(err_msg), "ERROR: Job #%lu: Exec %u reported error for step %u.", (unsigned long)job->job_id, executor_id, job->current_step_index);
-             Dispatcher_SendUsbResponse(err_msg);
-             JobManager_CompleteJob(job, JOB_STATUS_ERROR);
-             return true;
-     }
+/**
+ * @brief Занимает слот из очереди свободных и выдает ему новый job_id.
+ */
+static JobContext_t* JobManager_AllocSlot(void)
+{
+	if (g_free_count == 0) {
+		return NULL;
+	}
+	const uint8_t slot = g_free_slots[g_free_head];
+	g_free_head = (uint8_t)((g_free_head + 1) % MAX_CONCURRENT_JOBS);
+	g_free_count--;
 
-      if (job->pending_actions_count > 0) {
-          job->pending_actions_count--;
-      } else {
-        	char warn_msg[APP_USB_RESP_MAX_LEN];
-            snprintf(warn_msg, sizeof(warn_msg), "WARNING: Job #%lu: Duplicate/unexpected response for step %u from Exec %u.", (unsigned long)job->job_id, job->current_step_index, executor_id);
-            Dispatcher_SendUsbResponse(warn_msg);
-            return false;
-      }
+	JobContext_t* job = &g_active_jobs[slot];
+	// Поколение 0 не используется: иначе job_id слота 0 совпал бы с CAN_JOB_TAG_NONE
+	if (++job->generation > JOB_ID_GENERATION_MAX) {
+		job->generation = 1;
+	}
+	job->job_id = (uint16_t)((job->generation << JOB_ID_SLOT_BITS) | slot);
+	return job;
+}
 
-      if (job->pending_actions_count == 0) {
-          job->current_step_index++;
-          JobManager_ExecuteStep(job);
-      }
-      return true;
+static void JobManager_FreeSlot(JobContext_t* job)
+{
+	job->status = JOB_STATUS_IDLE;
+	job->job_id = 0;
+	g_free_slots[(g_free_head + g_free_count) % MAX_CONCURRENT_JOBS] = (uint8_t)(job - g_active_jobs);
+	g_free_count++;
 }
 
-void JobManager_Run(void)
+/**
+ * @brief Проход планировщика: запускает задания из очереди, чьи ресурсы свободны.
+ *        Очередь просматривается по убыванию приоритета (с учетом старения), внутри
+ *        класса - в порядке поступления. Задание не обгоняет более срочное, с которым
+ *        делит ресурсы: освободившийся ресурс достанется ему. Задания с непересекающимися
+ *        ресурсами запускаются параллельно, так что обслуживание заполняет простои.
+ */
+static void JobManager_Schedule(void)
 {
-	for (int i = 0; i < MAX_CONCURRENT_JOBS; i++) {
-		JobContext_t* job = &g_active_jobs[i];
-		if (job->status == JOB_STATUS_RUNNING) {
-			if ((HAL_GetTick() - job->step_start_time_ms) > JOB_TIMEOUT_MS) {
-				char err_msg[APP_USB_RESP_MAX_LEN];
-				snprintf(err_msg, sizeof(err_msg), "ERROR: Job #%lu timed out at step %u.", (unsigned long)job->job_id, job->current_step_index);
-				Dispatcher_SendUsbResponse(err_msg);
-				JobManager_CompleteJob(job, JOB_STATUS_TIMEOUT);
-				continue;
-            }
-            const ProcessStep_t* current_step = &job->current_recipe[job->current_step_index];
-            if (current_step->num_actions == 1 && current_step->atomic_actions[0].action == ACTION_WAIT_MS) {
-                if ((HAL_GetTick() - job->step_start_time_ms) >= current_step->atomic_actions[0].params.wait.delay_ms) {
-                    JobManager_ProcessExecutorResponse(job->job_id, 0, true);
-                }
-            }
+	if (g_scheduling) {
+		g_schedule_again = true; // Вызов из запускаемого задания: повторим проход после текущего
+		return;
+	}
+	g_scheduling = true;
+	do {
+		g_schedule_again = false;
+		JobManager_SortWaitQueue(HAL_GetTick());
+		ResourceMask_t blocked = 0; // Ресурсы заданий, оставшихся в очереди перед текущим
+		uint8_t kept = 0;
+		for (uint8_t i = 0; i < g_wait_count; i++) {
+			JobContext_t* job = &g_active_jobs[g_wait_queue[i]];
+			if ((job->resources & (g_locked_resources | blocked)) == 0) {
+				JobManager_Admit(job);
+			} else {
+				blocked |= job->resources;
+				g_wait_queue[kept++] = g_wait_queue[i];
+			}
 		}
+		g_wait_count = kept;
+	} while (g_schedule_again);
+	g_scheduling = false;
+}
+
+static void JobManager_Admit(JobContext_t* job)
+{
+	g_locked_resources |= job->resources;
+	job->status = JOB_STATUS_RUNNING;
+
+	const uint32_t now = HAL_GetTick();
+	const uint32_t wait_ms = now - job->queued_at_ms;
+	JobHistory_Started((uint8_t)(job - g_active_jobs), now);
+	JobClassStats_t* stats = &g_class_stats[job->priority];
+	stats->admitted++;
+	stats->total_wait_ms += wait_ms;
+	if (wait_ms > stats->max_wait_ms) {
+		stats->max_wait_ms = wait_ms;
 	}
+
+    JobManager_Report("INFO: Job #%lu started (Recipe ID:%d).", (unsigned long)job->job_id, job->initial_recipe_id);
+
+    JobManager_MakeReady(job);
 }
 
-// --- Внутренние функции ---
+static void JobManager_Dequeue(JobContext_t* job)
+{
+	const uint8_t slot = (uint8_t)(job - g_active_jobs);
+	uint8_t kept = 0;
+	for (uint8_t i = 0; i < g_wait_count; i++) {
+		if (g_wait_queue[i] != slot) {
+			g_wait_queue[kept++] = g_wait_queue[i];
+		}
+	}
+	g_wait_count = kept;
+}
 
-static JobContext_t* JobManager_FindJob(uint32_t job_id)
+/**
+ * @brief Очередность задания с учетом старения: каждые APP_JOB_AGING_MS ожидания
+ *        поднимают задание на один класс, поэтому рутинная работа не голодает.
+ */
+static uint8_t JobManager_EffectiveRank(const JobContext_t* job, uint32_t now_ms)
 {
-	for (int i = 0; i < MAX_CONCURRENT_JOBS; i++) {
-		if (g_active_jobs[i].status != JOB_STATUS_IDLE && g_active_jobs[i].job_id == job_id) {
-			return &g_active_jobs[i];
+	const uint8_t rank = k_priority_rank[job->priority];
+	const uint32_t promotions = (now_ms - job->queued_at_ms) / APP_JOB_AGING_MS;
+	return (promotions >= rank) ? 0 : (uint8_t)(rank - promotions);
+}
+
+/**
+ * @brief Сортирует очередь вставками по (очередность, момент постановки).
+ *        Очередь короткая и почти всегда уже упорядочена - O(n) на проход.
+ */
+static void JobManager_SortWaitQueue(uint32_t now_ms)
+{
+	uint8_t ranks[MAX_CONCURRENT_JOBS];
+	for (uint8_t i = 0; i < g_wait_count; i++) {
+		ranks[i] = JobManager_EffectiveRank(&g_active_jobs[g_wait_queue[i]], now_ms);
+	}
+	for (uint8_t i = 1; i < g_wait_count; i++) {
+		const uint8_t slot = g_wait_queue[i];
+		const uint8_t rank = ranks[i];
+		const uint32_t queued_at = g_active_jobs[slot].queued_at_ms;
+		uint8_t j = i;
+		while (j > 0 && (ranks[j - 1] > rank ||
+		       (ranks[j - 1] == rank && (int32_t)(g_active_jobs[g_wait_queue[j - 1]].queued_at_ms - queued_at) > 0))) {
+			g_wait_queue[j] = g_wait_queue[j - 1];
+			ranks[j] = ranks[j - 1];
+			j--;
+		}
+		g_wait_queue[j] = slot;
+		ranks[j] = rank;
+	}
+}
+
+/**
+ * @brief Ставит задание в очередь на выполнение следующего шага.
+ */
+static void JobManager_MakeReady(JobContext_t* job)
+{
+	const uint8_t slot = (uint8_t)(job - g_active_jobs);
+	if (g_ready_slots & (1ull << slot)) {
+		return;
+	}
+	g_ready_slots |= (1ull << slot);
+	g_ready_queue[(g_ready_head + g_ready_count) % MAX_CONCURRENT_JOBS] = slot;
+	g_ready_count++;
+}
+
+/**
+ * @brief Выполняет шаги готовых заданий, пока очередь не опустеет. Вызывается в конце
+ *        каждой функции API, которая могла сделать задание готовым. Задание, завершенное
+ *        или поставленное на паузу после постановки в очередь, пропускается; слот,
+ *        занятый за это время новым заданием, выполняется, только если оно запущено.
+ */
+static void JobManager_RunReadySteps(void)
+{
+	if (g_running_steps) {
+		return; // Вызов из выполняемого шага (например, on_done запустил задание)
+	}
+	g_running_steps = true;
+	while (g_ready_count > 0) {
+		const uint8_t slot = g_ready_queue[g_ready_head];
+		g_ready_head = (uint8_t)((g_ready_head + 1) % MAX_CONCURRENT_JOBS);
+		g_ready_count--;
+		g_ready_slots &= ~(1ull << slot);
+		if (g_active_jobs[slot].status == JOB_STATUS_RUNNING) {
+			JobManager_ExecuteStep(&g_active_jobs[slot]);
+		}
+	}
+	g_running_steps = false;
+}
+
+/**
+ * @brief Интерпретатор рецепта: выполняет управляющие инструкции от job->pc до
+ *        очередного шага (действия или блока PAR_BEGIN..PAR_END) и запускает его.
+ *        Возвращается, когда шаг ждет исполнителей или задание завершено.
+ *        Шаг, все действия которого выполнены сразу при отправке, не прерывает цикл.
+ *        Вызывается только из JobManager_RunReadySteps.
+ */
+static void JobManager_ExecuteStep(JobContext_t* job)
+{
+    uint16_t budget = RECIPE_MAX_LENGTH; // Управляющих инструкций подряд: защита от цикла без действий
+
+    for (;;) {
+        if (job->pc >= job->code_len) {
+            JobManager_Report("ERROR: Job #%lu: pc %u is outside the recipe (%u instructions).", (unsigned long)job->job_id, job->pc, job->code_len);
+            JobManager_AbortJob(job);
+            return;
+        }
+
+        const RecipeInstr_t* instr = &job->code[job->pc];
+        if (!RECIPE_OP_IS_ACTION(instr->op) && instr->op != RECIPE_OP_PAR_BEGIN) {
+            if (instr->op == RECIPE_OP_END) {
+                JobManager_CompleteJob(job, JOB_STATUS_COMPLETED);
+                return;
+            }
+            if (--budget == 0 || !JobManager_ExecuteControl(job, instr)) {
+                JobManager_Report("ERROR: Job #%lu: Invalid control instruction 0x%02X at pc %u.", (unsigned long)job->job_id, instr->op, job->pc);
+                JobManager_AbortJob(job);
+                return;
+            }
+            continue;
+        }
+        budget = RECIPE_MAX_LENGTH;
+
+        // Границы шага: одно действие или все действия блока PAR_BEGIN..PAR_END
+        uint8_t num_actions = 1;
+        job->step_pc = job->pc;
+        if (instr->op == RECIPE_OP_PAR_BEGIN) {
+            job->step_pc = (uint8_t)(job->pc + 1);
+            num_actions = 0;
+            while (job->step_pc + num_actions < job->code_len && RECIPE_OP_IS_ACTION(job->code[job->step_pc + num_actions].op)) {
+                num_actions++;
+            }
+            if (num_actions == 0 || job->step_pc + num_actions >= job->code_len || job->code[job->step_pc + num_actions].op != RECIPE_OP_PAR_END ||
+                num_actions > APP_MAX_STEP_ACTIONS) {
+                JobManager_Report("ERROR: Job #%lu: Parallel block at pc %u must hold 1..%u actions and end with PAR_END.", (unsigned long)job->job_id, job->pc, APP_MAX_STEP_ACTIONS);
+                JobManager_AbortJob(job);
+                return;
+            }
+            job->pc = (uint8_t)(job->step_pc + num_actions + 1);
+        } else {
+            job->pc++;
+        }
+
+        job->step_start_time_ms = HAL_GetTick();
+        job->pending_mask = 0;
+        job->homing_mask = 0;
+        job->step_seq++;
+
+        JobManager_Report("INFO: Job #%lu: Executing step at pc %u (%u actions).", (unsigned long)job->job_id, job->step_pc, num_actions);
+
+        // Действия без предшественников стартуют сразу, остальные - по мере завершения зависимостей
+        job->waiting_mask = (uint8_t)((1u << num_actions) - 1);
+        if (!JobManager_StartReadyActions(job)) {
+            return;
         }
+
+        if (job->pending_mask != 0) {
+            return; // Шаг продолжится в JobManager_ActionDone
+        }
+        JobManager_RecordStep(job, (uint8_t)(num_actions - 1));
+        job->fail_pc = RECIPE_PC_NONE; // Шаг выполнен: переход по ошибке больше не нужен
     }
-	return NULL;
 }
 
-static JobContext_t* JobManager_FindFreeSlot(void)
+/**
+ * @brief Запускает действие index текущего шага: отправляет команду исполнителю
+ *        или взводит таймер ожидания.
+ * @return false, если действие неизвестно (задание завершено с ошибкой).
+ */
+static bool JobManager_StartAction(JobContext_t* job, uint8_t index)
 {
-	for (int i = 0; i < MAX_CONCURRENT_JOBS; i++) {
-		if (g_active_jobs[i].status == JOB_STATUS_IDLE) {
-			return &g_active_jobs[i];
+    const uint32_t now = HAL_GetTick();
+    const RecipeInstr_t* instr = &job->code[job->step_pc + index];
+    AtomicAction_t action;
+    JobManager_DecodeAction(job, instr, &action);
+
+    switch (action.action) {
+        case ACTION_ROTATE_MOTOR:
+            JobManager_Report("DEBUG: Job #%lu: Sent ROTATE_MOTOR (ID:%u, Steps:%ld, Speed:%u) to Exec.",
+                (unsigned long)job->job_id, action.params.rotate_motor.motor_id, (long)action.params.rotate_motor.steps, action.params.rotate_motor.speed);
+            JobManager_SendActionFrames(job, index, instr, action.params.rotate_motor.motor_id, action.params.rotate_motor.steps);
+            break;
+        case ACTION_START_PUMP:
+            JobManager_Report("DEBUG: Job #%lu: Sent START_PUMP (ID:%u) to Exec.", (unsigned long)job->job_id, action.params.pump.pump_id);
+            JobManager_SendActionFrames(job, index, instr, action.params.pump.pump_id, 0);
+            break;
+        case ACTION_STOP_PUMP:
+            JobManager_Report("DEBUG: Job #%lu: Sent STOP_PUMP (ID:%u) to Exec.", (unsigned long)job->job_id, action.params.pump.pump_id);
+            JobManager_SendActionFrames(job, index, instr, action.params.pump.pump_id, 0);
+            break;
+        case ACTION_HOME_MOTOR:
+            JobManager_Report("DEBUG: Job #%lu: Sent HOME_MOTOR (ID:%u, Speed:%u) to Exec.",
+                (unsigned long)job->job_id, action.params.home_motor.motor_id, action.params.home_motor.speed);
+            JobManager_SendActionFrames(job, index, instr, action.params.home_motor.motor_id, 0);
+            break;
+        case ACTION_WAIT_MS:
+            JobManager_Report("DEBUG: Job #%lu: Started WAIT_MS for %lu ms.", (unsigned long)job->job_id, (unsigned long)action.params.wait.delay_ms);
+            // Действие завершится по своему таймеру в JobManager_Run
+            job->pending_mask |= (uint8_t)(1u << index);
+            JobManager_ArmActionTimer(job, index, now + action.params.wait.delay_ms);
+            return true;
+        default:
+            JobManager_Report("ERROR: Job #%lu: Unknown action %d at pc %u.", (unsigned long)job->job_id, action.action, job->step_pc + index);
+            JobManager_AbortJob(job);
+            return false;
+    }
+
+#if !APP_SIMULATE_EXECUTOR_RESPONSES // Иначе действие считается выполненным сразу после отправки
+    // Срок ответа исполнителя: свой у действия или общий по умолчанию
+    job->pending_mask |= (uint8_t)(1u << index);
+    JobManager_ArmActionTimer(job, index, now + (action.timeout_ms ? action.timeout_ms : JOB_TIMEOUT_MS));
+#endif
+    return true;
+}
+
+/**
+ * @brief Отправляет кадр действия по шаблону инструкции (action_frames.h): заменяются только
+ *        слоты с привязкой к аргументам задания и тег задания. Движению мотора предшествуют
+ *        кадры настройки, если параметры мотора отличаются от профиля (motion_profile.h).
+ */
+static void JobManager_SendActionFrames(const JobContext_t* job, uint8_t index, const RecipeInstr_t* instr, uint8_t device, int32_t value)
+{
+    const ActionFrames_t* frames = ActionFrames_Get(instr);
+    if (!frames->has_frame) {
+        return;
+    }
+    if (instr->op == RECIPE_OP_ROTATE_MOTOR || instr->op == RECIPE_OP_HOME_MOTOR) {
+        JobManager_SendMotionSetup(device, instr->speed);
+    }
+
+    CAN_Message_t can_msg = frames->frame;
+    if (instr->dev_bind != 0) {
+        Packer_SetDevice(&can_msg, device);
+    }
+    if (frames->value_slot && instr->val_bind != 0) {
+        Packer_SetPayload(&can_msg, value);
+    }
+    Packer_SetJobTag(&can_msg, job->job_id, JOB_ACTION_TAG(job, index));
+    JobManager_SendCan(&can_msg);
+}
+
+/**
+ * @brief Кадры настройки мотора перед движением, если его параметры отличаются от заданных speed (скорость или MOTION_PROFILE(n)).
+ */
+static void JobManager_SendMotionSetup(uint8_t device, uint16_t speed)
+{
+    CAN_Message_t setup[MOTION_SETUP_FRAMES_MAX];
+    const uint8_t count = MotionProfile_PrepareFrames(device, speed, setup);
+    for (uint8_t i = 0; i < count; i++) {
+        if (!JobManager_SendCan(&setup[i])) {
+            MotionProfile_Forget(device); // Кадр потерян: параметры мотора неизвестны
         }
     }
-	return NULL;
 }
 
-static void JobManager_ExecuteStep(JobContext_t* job)
+/**
+ * @brief Выводит в HOME мотор перемещения index, прерванного паузой: сколько мотор прошел
+ *        до остановки, неизвестно. Ответ на HOME приходит с тегом действия index, после него
+ *        перемещение повторяется целиком (JobManager_ActionDone).
+ */
+static void JobManager_StartHoming(JobContext_t* job, uint8_t index)
+{
+    const RecipeInstr_t* instr = &job->code[job->step_pc + index];
+    AtomicAction_t action;
+    JobManager_DecodeAction(job, instr, &action);
+    const uint8_t motor_id = action.params.rotate_motor.motor_id;
+
+    JobManager_Report("DEBUG: Job #%lu: Sent HOME_MOTOR (ID:%u) before repeating pc %u.",
+        (unsigned long)job->job_id, motor_id, job->step_pc + index);
+    JobManager_SendMotionSetup(motor_id, instr->speed);
+    CAN_Message_t can_msg;
+    Packer_CreateHomeMotorMsg(motor_id, job->job_id, JOB_ACTION_TAG(job, index), &can_msg);
+    JobManager_SendCan(&can_msg);
+
+    job->pending_mask |= (uint8_t)(1u << index);
+    JobManager_ArmActionTimer(job, index, HAL_GetTick() + JOB_TIMEOUT_MS);
+}
+
+/**
+ * @brief Запускает ожидающие действия шага, у которых завершены все предшественники
+ *        (граф зависимостей блока PAR, см. RECIPE_AFTER). Действие без зависимостей
+ *        запускается сразу, поэтому обычный блок PAR стартует целиком.
+ * @return false, если задание завершено с ошибкой.
+ */
+static bool JobManager_StartReadyActions(JobContext_t* job)
 {
-	const ProcessStep_t* current_step = &job->current_recipe[job->current_step_index];
-    if (current_step->atomic_actions == NULL || current_step->num_actions == 0) {
-    	JobManager_CompleteJob(job, JOB_STATUS_COMPLETED);
-    	return;
+    bool started;
+    do {
+        started = false;
+        const uint8_t done_mask = (uint8_t)~(job->pending_mask | job->waiting_mask);
+        for (uint8_t i = 0; i < APP_MAX_STEP_ACTIONS; i++) {
+            if (!(job->waiting_mask & (1u << i)) || (JobManager_ActionDeps(job, i) & ~done_mask) != 0) {
+                continue;
+            }
+            job->waiting_mask &= (uint8_t)~(1u << i);
+            if (!JobManager_StartAction(job, i)) {
+                return false;
+            }
+            started = true; // Без ответов исполнителей (симуляция) действие уже выполнено
+        }
+    } while (started && job->waiting_mask != 0);
+    return true;
+}
+
+/**
+ * @brief Число действий текущего шага: одно или все действия блока PAR_BEGIN..PAR_END.
+ */
+static uint8_t JobManager_StepActionCount(const JobContext_t* job)
+{
+    if (job->step_pc == 0 || job->code[job->step_pc - 1].op != RECIPE_OP_PAR_BEGIN) {
+        return 1;
+    }
+    uint8_t count = 0;
+    while (count < APP_MAX_STEP_ACTIONS && job->step_pc + count < job->code_len &&
+           RECIPE_OP_IS_ACTION(job->code[job->step_pc + count].op)) {
+        count++;
     }
+    return count;
+}
 
-    job->step_start_time_ms = HAL_GetTick();
-    job->pending_actions_count = current_step->num_actions;
-
-    char info_msg[APP_USB_RESP_MAX_LEN];
-    snprintf(info_msg, sizeof(info_msg), "INFO: Job #%lu: Executing step %u (%u actions).", (unsigned long)job->job_id, job->current_step_index, current_step->num_actions);
-    Dispatcher_SendUsbResponse(info_msg);
-
-    for (int i = 0; i < current_step->num_actions; i++) {
-	    const AtomicAction_t* action = &current_step->atomic_actions[i];
-        
-        bool should_execute = true;
-
-        if (job->initial_recipe_id == RECIPE_INITIALIZE_SYSTEM && action->action == ACTION_HOME_MOTOR)
-        {
-            if (job->initial_cmd.args_type == ARGS_TYPE_BINARY && job->initial_cmd.args.binary.len > 0)
-            {
-                uint8_t modules_mask = job->initial_cmd.args.binary.raw[0];
-                uint8_t motor_id_in_recipe = action->params.home_motor.motor_id;
-                if (motor_id_in_recipe > 0)
-                {
-                    uint8_t motor_bit = 1 << (motor_id_in_recipe - 1);
-                    if (!(modules_mask & motor_bit)) {
-                        should_execute = false;
+/**
+ * @brief Выключен ли насос действия start_index (START_PUMP) выполненным STOP_PUMP того же шага.
+ *        unfinished - маска невыполненных действий шага.
+ */
+static bool JobManager_PumpStoppedInStep(const JobContext_t* job, uint8_t start_index, uint8_t unfinished)
+{
+    AtomicAction_t start;
+    JobManager_DecodeAction(job, &job->code[job->step_pc + start_index], &start);
+    const uint8_t num_actions = JobManager_StepActionCount(job);
+    for (uint8_t i = 0; i < num_actions; i++) {
+        if ((unfinished & (1u << i)) || job->code[job->step_pc + i].op != RECIPE_OP_STOP_PUMP) {
+            continue;
+        }
+        AtomicAction_t stop;
+        JobManager_DecodeAction(job, &job->code[job->step_pc + i], &stop);
+        if (stop.params.pump.pump_id == start.params.pump.pump_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Предшественники действия index в шаге: маска действий, которые должны завершиться до его запуска.
+ */
+static uint8_t JobManager_ActionDeps(const JobContext_t* job, uint8_t index)
+{
+    if (job->step_pc == 0 || job->code[job->step_pc - 1].op != RECIPE_OP_PAR_BEGIN) {
+        return 0; // Шаг из одного действия
+    }
+    return RECIPE_DEPS_OF(job->code[job->step_pc - 1].value, index);
+}
+
+/**
+ * @brief Выполняет управляющую инструкцию и сдвигает job->pc.
+ * @return false, если инструкция недопустима в этом месте программы.
+ */
+static bool JobManager_ExecuteControl(JobContext_t* job, const RecipeInstr_t* instr)
+{
+    switch (instr->op) {
+        case RECIPE_OP_LOOP: {
+            const int32_t count = JobManager_InstrValue(job, instr);
+            if (job->loop_depth >= RECIPE_MAX_LOOP_DEPTH) {
+                return false;
+            }
+            if (count <= 0) {
+                // Тело не выполняется: переход за парный END_LOOP
+                uint8_t depth = 0;
+                for (uint8_t pc = (uint8_t)(job->pc + 1); pc < job->code_len; pc++) {
+                    if (job->code[pc].op == RECIPE_OP_LOOP) {
+                        depth++;
+                    } else if (job->code[pc].op == RECIPE_OP_END_LOOP && depth-- == 0) {
+                        job->pc = (uint8_t)(pc + 1);
+                        return true;
                     }
                 }
+                return false;
             }
+            job->loop_start[job->loop_depth] = (uint8_t)(job->pc + 1);
+            job->loop_left[job->loop_depth] = (uint16_t)((count > 0xFFFF) ? 0xFFFF : count);
+            job->loop_depth++;
+            job->pc++;
+            return true;
         }
-        // --- [ADD_NEW_COMMAND] ---
-        // 5. Если ваша новая команда параметризованная, добавьте ее логику фильтрации здесь
-        // else if (job->initial_recipe_id == RECIPE_WASH_CUVETTE && action->action == ACTION_WASH)
-        // {
-        //     // ... ваша логика фильтрации ...
-        // }
-        // --- КОНЕЦ ФИЛЬТРУЮЩЕЙ ЛОГИКИ ---
-        
-        if (!should_execute) {
-            job->pending_actions_count--;
-            char filter_msg[APP_USB_RESP_MAX_LEN];
-            snprintf(filter_msg, sizeof(filter_msg), "DEBUG: Job #%lu: Action for motor_id=%u filtered out by mask.", (unsigned long)job->job_id, action->params.home_motor.motor_id);
-            Dispatcher_SendUsbResponse(filter_msg);
+        case RECIPE_OP_END_LOOP:
+            if (job->loop_depth == 0) {
+                return false;
+            }
+            if (--job->loop_left[job->loop_depth - 1] > 0) {
+                job->pc = job->loop_start[job->loop_depth - 1];
+            } else {
+                job->loop_depth--;
+                job->pc++;
+            }
+            return true;
+        case RECIPE_OP_JUMP:
+            job->pc = (uint8_t)instr->value;
+            return true;
+        case RECIPE_OP_JUMP_UNLESS_ARG:
+            if (instr->val_bind == 0 || instr->val_bind > RECIPE_MAX_ARGS) {
+                return false;
+            }
+            if (job->args[instr->val_bind - 1] & instr->device) {
+                job->pc++;
+            } else {
+                JobManager_Report("DEBUG: Job #%lu: Argument %u has no bits 0x%02X, jump to pc %ld.", (unsigned long)job->job_id, instr->val_bind - 1, instr->device, (long)instr->value);
+                job->pc = (uint8_t)instr->value;
+            }
+            return true;
+        case RECIPE_OP_BRANCH_IF_FAIL:
+            job->fail_pc = (uint8_t)instr->value;
+            job->pc++;
+            return true;
+        default:
+            return false; // PAR_END без PAR_BEGIN или неизвестный код
+    }
+}
+
+/**
+ * @brief Значение инструкции: value как есть или аргумент задания, масштабированный value.
+ */
+static int32_t JobManager_InstrValue(const JobContext_t* job, const RecipeInstr_t* instr)
+{
+    if (instr->val_bind == 0 || instr->val_bind > RECIPE_MAX_ARGS) {
+        return instr->value;
+    }
+    return (int32_t)((int64_t)job->args[instr->val_bind - 1] * instr->value / RECIPE_VALUE_SCALE);
+}
+
+/**
+ * @brief Декодирует инструкцию-действие в AtomicAction_t с подстановкой аргументов задания.
+ */
+static void JobManager_DecodeAction(const JobContext_t* job, const RecipeInstr_t* instr, AtomicAction_t* out_action)
+{
+    uint8_t device = instr->device;
+    const uint8_t dev_arg = RECIPE_BIND_ARG(instr->dev_bind);
+    if (dev_arg != 0 && dev_arg <= RECIPE_MAX_ARGS) {
+        // Устройство N-го экземпляра модуля: номер из рецепта (для первого) + (N-1) * шаг
+        device = (uint8_t)(device + (job->args[dev_arg - 1] - 1) * RECIPE_BIND_STRIDE(instr->dev_bind));
+    }
+    const int32_t value = JobManager_InstrValue(job, instr);
+
+    memset(out_action, 0, sizeof(*out_action));
+    out_action->action = (ActionType_t)instr->op;
+    out_action->timeout_ms = instr->timeout_ms;
+    switch (instr->op) {
+        case RECIPE_OP_ROTATE_MOTOR:
+            out_action->params.rotate_motor.motor_id = device;
+            out_action->params.rotate_motor.steps = value;
+            out_action->params.rotate_motor.speed = MotionProfile_Speed(instr->speed);
+            break;
+        case RECIPE_OP_HOME_MOTOR:
+            out_action->params.home_motor.motor_id = device;
+            out_action->params.home_motor.speed = MotionProfile_Speed(instr->speed);
+            break;
+        case RECIPE_OP_START_PUMP:
+        case RECIPE_OP_STOP_PUMP:
+            out_action->params.pump.pump_id = device;
+            break;
+        case RECIPE_OP_WAIT_MS:
+            out_action->params.wait.delay_ms = (value > 0) ? (uint32_t)value : 0;
+            break;
+        default:
+            out_action->action = ACTION_NONE;
+            break;
+    }
+}
+
+/**
+ * @brief Собирает моторы и насосы, которыми задание может управлять после подстановки
+ *        аргументов. Переходы не учитываются: захватываются устройства всех ветвей.
+ */
+static ResourceMask_t JobManager_CollectDevices(const JobContext_t* job)
+{
+    ResourceMask_t devices = 0;
+    for (uint8_t pc = 0; pc < job->code_len; pc++) {
+        if (!RECIPE_OP_IS_ACTION(job->code[pc].op)) {
             continue;
         }
+        AtomicAction_t action;
+        JobManager_DecodeAction(job, &job->code[pc], &action);
+        uint8_t executor_id = 0, device_id = 0;
+        if (JobManager_GetActionTarget(&action, &executor_id, &device_id) && device_id != 0) {
+            devices |= (executor_id == CAN_EXECUTOR_MOTORS) ? RES_MOTOR(device_id) : RES_PUMP(device_id);
+        }
+    }
+    return devices;
+}
 
-        CAN_Message_t can_msg;
-        switch (action->action) {
-            case ACTION_ROTATE_MOTOR:
-                snprintf(info_msg, sizeof(info_msg), "DEBUG: Job #%lu: Sent ROTATE_MOTOR (ID:%u, Steps:%ld, Speed:%u) to Exec.",
-                    (unsigned long)job->job_id, action->params.rotate_motor.motor_id, (long)action->params.rotate_motor.steps, action->params.rotate_motor.speed);
-                Dispatcher_SendUsbResponse(info_msg);
-                Packer_CreateRotateMotorMsg(action->params.rotate_motor.motor_id, action->params.rotate_motor.steps, action->params.rotate_motor.speed, job->job_id, &can_msg);
-                xQueueSend(can_tx_queue_handle, &can_msg, 0);
-                job->pending_actions_count--; // Simulate response
-                break;
-            case ACTION_START_PUMP:
-                snprintf(info_msg, sizeof(info_msg), "DEBUG: Job #%lu: Sent START_PUMP (ID:%u) to Exec.", (unsigned long)job->job_id, action->params.pump.pump_id);
-                Dispatcher_SendUsbResponse(info_msg);
-                Packer_CreateStartPumpMsg(action->params.pump.pump_id, job->job_id, &can_msg);
-                xQueueSend(can_tx_queue_handle, &can_msg, 0);
-                job->pending_actions_count--; // Simulate response
-                break;
-            case ACTION_STOP_PUMP:
-                snprintf(info_msg, sizeof(info_msg), "DEBUG: Job #%lu: Sent STOP_PUMP (ID:%u) to Exec.", (unsigned long)job->job_id, action->params.pump.pump_id);
-                Dispatcher_SendUsbResponse(info_msg);
-                Packer_CreateStopPumpMsg(action->params.pump.pump_id, job->job_id, &can_msg);
-                xQueueSend(can_tx_queue_handle, &can_msg, 0);
-                job->pending_actions_count--; // Simulate response
-                break;
-            case ACTION_HOME_MOTOR:
-                snprintf(info_msg, sizeof(info_msg), "DEBUG: Job #%lu: Sent HOME_MOTOR (ID:%u, Speed:%u) to Exec.",
-                    (unsigned long)job->job_id, action->params.home_motor.motor_id, action->params.home_motor.speed);
-                Dispatcher_SendUsbResponse(info_msg);
-                Packer_CreateHomeMotorMsg(action->params.home_motor.motor_id, action->params.home_motor.speed, job->job_id, &can_msg);
-                xQueueSend(can_tx_queue_handle, &can_msg, 0);
-                job->pending_actions_count--; // Simulate response
-                break;
-            case ACTION_WAIT_MS:
-                snprintf(info_msg, sizeof(info_msg), "DEBUG: Job #%lu: Started WAIT_MS for %lu ms.", (unsigned long)job->job_id, (unsigned long)action->params.wait.delay_ms);
-                Dispatcher_SendUsbResponse(info_msg);
-                job->pending_actions_count--;
-                break;
-            default:
-                snprintf(info_msg, sizeof(info_msg), "ERROR: Job #%lu: Unknown action %d in step %u.", (unsigned long)job->job_id, action->action, job->current_step_index);
-                Dispatcher_SendUsbResponse(info_msg);
-                JobManager_CompleteJob(job, JOB_STATUS_ERROR);
-                return;
+/**
+ * @brief Ошибка или таймаут действия текущего шага. Если шагу предшествовал
+ *        RECIPE_OP_BRANCH_IF_FAIL, программа продолжается с его адреса, иначе задание аварийно завершается.
+ */
+static void JobManager_FailStep(JobContext_t* job, uint8_t action_index, JobStatus_t status, const char* reason_fmt, ...)
+{
+    JobManager_ForgetMotion(job, action_index);
+    va_list reason_args;
+    va_start(reason_args, reason_fmt);
+    JobManager_ReportFailure(job, reason_fmt, reason_args);
+    va_end(reason_args);
+
+    // Остальные действия шага (соседи по блоку PAR) не должны продолжать работу
+    // ни после аварийного завершения, ни при переходе на обработчик ошибки.
+    // Завершаемое задание останавливает все свои моторы и насосы.
+    JobManager_StopStep(job, action_index, job->fail_pc == RECIPE_PC_NONE);
+    if (job->fail_pc == RECIPE_PC_NONE) {
+        JobManager_CompleteJob(job, status);
+        return;
+    }
+
+    job->pc = job->fail_pc;
+    job->fail_pc = RECIPE_PC_NONE;
+    JobManager_MakeReady(job);
+}
+
+/**
+ * @brief Останавливает исполнителей текущего шага (CMD_STOP моторам, выключение насосам)
+ *        и снимает его таймеры. Останавливаются устройства всех запущенных действий шага,
+ *        в том числе завершенных: насос, включенный в блоке PAR, работает до конца блока.
+ *
+ * @param failed_action Действие, из-за которого шаг прерван (для истории шагов),
+ *                      или APP_MAX_STEP_ACTIONS - шаг остановлен по команде ПК.
+ * @param all_devices   Задание завершается: останавливаются и остальные моторы и насосы
+ *                      его ресурсов (насос, включенный прежним шагом, еще работает).
+ */
+static void JobManager_StopStep(JobContext_t* job, uint8_t failed_action, bool all_devices)
+{
+    const bool par_step = job->step_pc > 0 && job->code[job->step_pc - 1].op == RECIPE_OP_PAR_BEGIN;
+    const uint8_t num_actions = par_step ? APP_MAX_STEP_ACTIONS : 1;
+    ResourceMask_t devices = all_devices ? job->resources : 0;
+    for (uint8_t i = 0; i < num_actions && job->step_pc + i < job->code_len; i++) {
+        const RecipeInstr_t* instr = &job->code[job->step_pc + i];
+        if (!RECIPE_OP_IS_ACTION(instr->op)) {
+            break; // PAR_END: конец блока
+        }
+        if (job->waiting_mask & (1u << i)) {
+            continue; // Действие еще не запускалось
+        }
+        AtomicAction_t action;
+        JobManager_DecodeAction(job, instr, &action);
+        uint8_t executor_id = 0, device_id = 0;
+        if (JobManager_GetActionTarget(&action, &executor_id, &device_id) && device_id != 0) {
+            devices |= (executor_id == CAN_EXECUTOR_MOTORS) ? RES_MOTOR(device_id) : RES_PUMP(device_id);
         }
     }
+    JobManager_StopDevices(job, devices);
 
-    if (job->pending_actions_count == 0) {
-        job->current_step_index++;
-        JobManager_ExecuteStep(job);
+    // Ответы на прерванные действия отсечет статус задания и новый step_seq
+    JobManager_RecordStep(job, failed_action);
+    JobManager_CancelTimers(job);
+    job->pending_mask = 0;
+    job->waiting_mask = 0;
+    job->homing_mask = 0;
+}
+
+/**
+ * @brief Отправляет CMD_STOP моторам и выключение насосам из маски devices.
+ *        Остальные ресурсы (клапаны, игла) команды остановки не имеют.
+ */
+static void JobManager_StopDevices(const JobContext_t* job, ResourceMask_t devices)
+{
+    ResourceMask_t stopped = 0;
+    CAN_Message_t can_msg;
+    for (uint8_t id = 1; id <= RES_MOTOR_COUNT; id++) {
+        if (devices & RES_MOTOR(id)) {
+            Packer_CreateStopMotorMsg(id, &can_msg);
+            JobManager_SendCan(&can_msg);
+            stopped |= RES_MOTOR(id);
+        }
     }
+    for (uint8_t id = 1; id <= RES_PUMP_COUNT; id++) {
+        if (devices & RES_PUMP(id)) {
+            Packer_CreateStopPumpMsg(id, CAN_JOB_TAG_NONE, 0, &can_msg);
+            JobManager_SendCan(&can_msg);
+            stopped |= RES_PUMP(id);
+        }
+    }
+    JobManager_Report("DEBUG: Job #%lu: Stop sent to devices 0x%08lX.", (unsigned long)job->job_id, (unsigned long)stopped);
+}
+
+/**
+ * @brief Аварийно завершает задание с ошибкой программы. Моторы и насосы его ресурсов
+ *        останавливаются: насос, включенный прежним шагом, мог остаться включенным.
+ */
+static void JobManager_AbortJob(JobContext_t* job)
+{
+    JobManager_StopDevices(job, job->resources);
+    JobManager_CompleteJob(job, JOB_STATUS_ERROR);
 }
 
 static void JobManager_CompleteJob(JobContext_t* job, JobStatus_t final_status)
 {
+	JobManager_CancelTimers(job);
+	if (job->status == JOB_STATUS_QUEUED) {
+		JobManager_Dequeue(job);
+	} else {
+		g_locked_resources &= ~job->resources;
+	}
 	job->status = final_status;
-    char final_msg[APP_USB_RESP_MAX_LEN];
-    snprintf(final_msg, sizeof(final_msg), "INFO: Job #%lu finished with status %d.", (unsigned long)job->job_id, final_status);
-    Dispatcher_SendUsbResponse(final_msg);
+	JobHistory_Close((uint8_t)(job - g_active_jobs), job->job_id, job->initial_recipe_id, (uint8_t)final_status, HAL_GetTick());
+    JobManager_Report("INFO: Job #%lu finished with status %d.", (unsigned long)job->job_id, final_status);
 
-    // Отправляем бинарный DONE-ответ
-    // 0x0000 - успешное завершение, другие коды - для ошибок/статусов
-    uint16_t done_status_code = (final_status == JOB_STATUS_COMPLETED) ? 0x0000 : 0x0001;
-    Dispatcher_SendDone(job->initial_cmd.command_code, done_status_code);
+    if (job->on_done != NULL) {
+        job->on_done(job->owner_tag, final_status); // Задание планировщика: итог учитывает владелец
+    } else {
+        // Отправляем бинарный DONE-ответ: 0x0000 - успешное завершение, иначе код ошибки (errors.md)
+        uint16_t done_status_code;
+        switch (final_status) {
+            case JOB_STATUS_COMPLETED: done_status_code = 0x0000; break; // ERR_OK
+            case JOB_STATUS_TIMEOUT:   done_status_code = 0x0006; break; // ERR_TIMEOUT
+            case JOB_STATUS_CANCELLED: done_status_code = 0x0010; break; // ERR_CANCELLED
+            default:                   done_status_code = 0x0001; break; // ERR_GENERAL
+        }
+        JobManager_SendDone(job, done_status_code);
+    }
 
 
     if (job->initial_recipe_id == RECIPE_INITIALIZE_SYSTEM && final_status == JOB_STATUS_COMPLETED) {
          JobManager_SignalSystemReady();
     }
 
-    job->status = JOB_STATUS_IDLE;
-    job->job_id = 0;
+    JobManager_FreeSlot(job);
+
+    // Освободились ресурсы: возможно, можно запустить задания из очереди
+    JobManager_Schedule();
+}
+
+/**
+ * @brief Ответ DONE команде ПК, запустившей задание. Задание может завершиться внутри
+ *        обработки другой команды (отмена, ошибка запуска) - ее номер восстанавливается.
+ */
+static void JobManager_SendDone(const JobContext_t* job, uint16_t status)
+{
+    uint16_t outer_seq;
+    const bool outer_sequenced = HostSeq_Current(&outer_seq);
+    if (job->host_sequenced) {
+        HostSeq_Resume(job->host_seq);
+    } else {
+        HostSeq_End();
+    }
+    Dispatcher_SendDone(job->command_code, status);
+    if (outer_sequenced) {
+        HostSeq_Resume(outer_seq);
+    } else {
+        HostSeq_End();
+    }
 }
 
 static void JobManager_SignalSystemReady(void) {
     Dispatcher_SendUsbResponse("DEBUG: Signaling system READY.");
 	SetSystemReady();
 }
+
+/**
+ * @brief Засчитывает выполненное действие текущего шага; после последнего - переход к следующему шагу.
+ */
+static void JobManager_ActionDone(JobContext_t* job, uint8_t action_index)
+{
+	job->pending_mask &= (uint8_t)~(1u << action_index);
+	if (job->homing_mask & (1u << action_index)) {
+		// Мотор в HOME: прерванное паузой перемещение повторяется целиком
+		job->homing_mask &= (uint8_t)~(1u << action_index);
+		job->waiting_mask |= (uint8_t)(1u << action_index);
+	}
+	if (job->waiting_mask != 0 && !JobManager_StartReadyActions(job)) {
+		return;
+	}
+	if (job->pending_mask == 0) {
+		JobManager_RecordStep(job, action_index);
+		job->fail_pc = RECIPE_PC_NONE;
+		JobManager_MakeReady(job);
+	}
+}
+
+/**
+ * @brief Учитывает в истории проход текущего шага. Проход закрыт действием action_index:
+ *        последним ответившим, ошибкой или тайм-аутом; APP_MAX_STEP_ACTIONS - остановкой шага.
+ */
+static void JobManager_RecordStep(JobContext_t* job, uint8_t action_index)
+{
+	uint8_t executor_id = JOB_HISTORY_EXEC_NONE, device_id = 0;
+	if (action_index < APP_MAX_STEP_ACTIONS) {
+		AtomicAction_t action;
+		JobManager_DecodeAction(job, &job->code[job->step_pc + action_index], &action);
+		if (!JobManager_GetActionTarget(&action, &executor_id, &device_id)) {
+			executor_id = JOB_HISTORY_EXEC_NONE; // WAIT_MS выполняет сам Дирижер
+		}
+	}
+	JobHistory_Step((uint8_t)(job - g_active_jobs), job->step_pc, HAL_GetTick() - job->step_start_time_ms, executor_id);
+}
+
+/**
+ * @brief Ставит таймер действия текущего шага: окончание ACTION_WAIT_MS или срок ответа исполнителя.
+ */
+static void JobManager_ArmActionTimer(JobContext_t* job, uint8_t action_index, uint32_t deadline_ms)
+{
+	// Если срок стал ближайшим, монитор нужно взвести на него заново
+	if (DeadlineQueue_Set(JOB_ACTION_TIMER(job, action_index), deadline_ms)) {
+		JobInbox_PostTimer();
+	}
+}
+
+static void JobManager_CancelTimers(JobContext_t* job)
+{
+	for (uint8_t i = 0; i < APP_MAX_STEP_ACTIONS; i++) {
+		DeadlineQueue_Cancel(JOB_ACTION_TIMER(job, i));
+	}
+}
+
+/**
+ * @brief Определяет исполнителя и устройство, которым адресовано действие.
+ * @return false для действий, выполняемых самим Дирижером (ACTION_WAIT_MS).
+ */
+static bool JobManager_GetActionTarget(const AtomicAction_t* action, uint8_t* executor_id, uint8_t* device_id)
+{
+	switch (action->action) {
+		case ACTION_ROTATE_MOTOR:
+			*executor_id = CAN_EXECUTOR_MOTORS;
+			*device_id = action->params.rotate_motor.motor_id;
+			return true;
+		case ACTION_HOME_MOTOR:
+			*executor_id = CAN_EXECUTOR_MOTORS;
+			*device_id = action->params.home_motor.motor_id;
+			return true;
+		case ACTION_START_PUMP:
+		case ACTION_STOP_PUMP:
+			*executor_id = CAN_EXECUTOR_PUMPS;
+			*device_id = action->params.pump.pump_id;
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * @brief Мотор, не выполнивший действие, мог сбросить параметры (перезапуск исполнителя, авария
+ *        драйвера): следующее движение отправит ему профиль целиком.
+ */
+static void JobManager_ForgetMotion(const JobContext_t* job, uint8_t action_index)
+{
+	if (job->step_pc + action_index >= job->code_len) {
+		return;
+	}
+	AtomicAction_t action;
+	JobManager_DecodeAction(job, &job->code[job->step_pc + action_index], &action);
+	uint8_t executor_id = 0, device_id = 0;
+	if (JobManager_GetActionTarget(&action, &executor_id, &device_id) && executor_id == CAN_EXECUTOR_MOTORS) {
+		MotionProfile_Forget(device_id);
+	}
+}
+
+static const char* JobManager_ActionName(ActionType_t action)
+{
+	switch (action) {
+		case ACTION_ROTATE_MOTOR: return "ROTATE_MOTOR";
+		case ACTION_START_PUMP:   return "START_PUMP";
+		case ACTION_STOP_PUMP:    return "STOP_PUMP";
+		case ACTION_WAIT_MS:      return "WAIT_MS";
+		case ACTION_HOME_MOTOR:   return "HOME_MOTOR";
+		default:                  return "UNKNOWN";
+	}
+}
+
+/**
+ * @brief Имя действия шага для сообщений: перемещение, перед повтором которого мотор
+ *        выводится в HOME (JobManager_StartHoming), ждет ответа на HOME_MOTOR.
+ */
+static const char* JobManager_StepActionName(const JobContext_t* job, uint8_t action_index, const AtomicAction_t* action)
+{
+	return (job->homing_mask & (1u << action_index)) ? "HOME_MOTOR" : JobManager_ActionName(action->action);
+}
+
+/**
+ * @brief Отправляет на ПК текстовую строку о ходе задания. Буфер строки занимает
+ *        стек только на время отправки, а не в каждом кадре цепочки выполнения шага.
+ */
+static void JobManager_Report(const char* fmt, ...)
+{
+	char msg[APP_USB_RESP_MAX_LEN];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(msg, sizeof(msg), fmt, args);
+	va_end(args);
+	Dispatcher_SendUsbResponse(msg);
+}
+
+/**
+ * @brief Ставит кадр в очередь CAN TX; кадр учитывается в CRC выходов трассы (job_trace.h).
+ */
+static bool JobManager_SendCan(const CAN_Message_t* msg)
+{
+	JobTrace_OutputCan(msg);
+	return xQueueSend(can_tx_queue_handle, msg, 0) == pdPASS;
+}
+
+/**
+ * @brief Строка об ошибке шага: ERROR, если задание завершается, или WARNING
+ *        с адресом перехода RECIPE_OP_BRANCH_IF_FAIL.
+ */
+static void JobManager_ReportFailure(const JobContext_t* job, const char* reason_fmt, va_list reason_args)
+{
+	char msg[APP_USB_RESP_MAX_LEN];
+	const bool branch = (job->fail_pc != RECIPE_PC_NONE);
+	int len = snprintf(msg, sizeof(msg), "%s: Job #%lu: ", branch ? "WARNING" : "ERROR", (unsigned long)job->job_id);
+	if (len >= 0 && len < (int)sizeof(msg)) {
+		const int reason_len = vsnprintf(&msg[len], sizeof(msg) - (size_t)len, reason_fmt, reason_args);
+		len = (reason_len < 0) ? (int)sizeof(msg) : len + reason_len;
+	}
+	if (len >= 0 && len < (int)sizeof(msg)) {
+		if (branch) {
+			snprintf(&msg[len], sizeof(msg) - (size_t)len, ", branching to pc %u.", job->fail_pc);
+		} else {
+			snprintf(&msg[len], sizeof(msg) - (size_t)len, ".");
+		}
+	}
+	Dispatcher_SendUsbResponse(msg);
+}
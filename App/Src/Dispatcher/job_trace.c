@@ -0,0 +1,285 @@
+/*
+ * job_trace.c
+ *
+ *  Created on: Mar 9, 2026
+ *      Author: andrey
+ */
+
+#include "Dispatcher/job_trace.h"
+#include "Dispatcher/recipe_flash.h"
+#include <string.h>
+#include "main.h" // Для HAL_GetTick()
+
+// Худший размер заголовка записи: тип, время (LEB128 до 5 байт), CRC выходов
+#define JOB_TRACE_RECORD_HEAD_MAX   8
+#define JOB_TRACE_RESPONSE_SIZE     5
+
+typedef enum {
+	JOB_TRACE_OFF,
+	JOB_TRACE_RECORDING,
+	JOB_TRACE_REPLAYING
+} JobTraceState_t;
+
+// --- Внутренние переменные ---
+#if APP_JOB_TRACE_BYTES > 0
+static uint8_t g_buffer[APP_JOB_TRACE_BYTES] __attribute__((aligned(4)));
+#endif
+static uint8_t g_state = JOB_TRACE_OFF;
+static uint32_t g_pos = 0;          // Конец записей в g_buffer
+static uint32_t g_last_tick = 0;    // Время предыдущей записи
+static uint32_t g_events = 0;
+static uint32_t g_output_crc = 0;
+static JobTraceHeader_t g_header;   // Копируется в начало буфера при остановке
+
+// --- Внутренние функции ---
+
+static uint8_t* JobTrace_PutVarint(uint8_t* p, uint32_t value)
+{
+	while (value >= 0x80) {
+		*p++ = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	*p++ = (uint8_t)value;
+	return p;
+}
+
+static bool JobTrace_GetVarint(const uint8_t** pos, const uint8_t* end, uint32_t* out_value)
+{
+	uint32_t value = 0;
+	for (uint8_t shift = 0; shift < 35; shift += 7) {
+		if (*pos >= end) {
+			return false;
+		}
+		const uint8_t byte = *(*pos)++;
+		value |= (uint32_t)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) {
+			*out_value = value;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Начинает запись типа type с payload_len байт данных.
+ * @return Адрес данных записи или NULL: запись не идет или буфер заполнен
+ *         (тогда трасса останавливается с флагом TRUNCATED).
+ */
+static uint8_t* JobTrace_BeginRecord(JobTraceType_t type, uint32_t payload_len)
+{
+#if APP_JOB_TRACE_BYTES > 0
+	if (g_state != JOB_TRACE_RECORDING) {
+		return NULL;
+	}
+	// За командой может последовать TICK: для него место оставляется заранее, иначе
+	// трасса остановилась бы посреди обработки команды и выходы разошлись бы с воспроизведением
+	const uint32_t reserve = (type == JOB_TRACE_TICK) ? 0 : JOB_TRACE_RECORD_HEAD_MAX;
+	if (g_pos + JOB_TRACE_RECORD_HEAD_MAX + payload_len + reserve > sizeof(g_buffer)) {
+		g_header.flags |= JOB_TRACE_FLAG_TRUNCATED;
+		JobTrace_Stop();
+		return NULL;
+	}
+
+	const uint32_t now = HAL_GetTick();
+	uint8_t* p = &g_buffer[g_pos];
+	*p++ = (uint8_t)type;
+	p = JobTrace_PutVarint(p, now - g_last_tick);
+	*p++ = (uint8_t)(g_output_crc & 0xFF);
+	*p++ = (uint8_t)(g_output_crc >> 8);
+	g_pos = (uint32_t)(p - g_buffer) + payload_len;
+	g_last_tick = now;
+	g_events++;
+	return p;
+#else
+	(void)type;
+	(void)payload_len;
+	return NULL;
+#endif
+}
+
+// --- API функции ---
+
+void JobTrace_Init(void)
+{
+	memset(&g_header, 0, sizeof(g_header));
+	g_header.config_crc = JobTrace_ConfigCrc();
+	g_header.flash_crc = JobTrace_FlashCrc();
+	g_header.start_tick = HAL_GetTick();
+	g_pos = sizeof(JobTraceHeader_t);
+	g_last_tick = g_header.start_tick;
+	g_events = 0;
+	g_output_crc = 0;
+	g_state = (APP_JOB_TRACE_BYTES > 0) ? JOB_TRACE_RECORDING : JOB_TRACE_OFF;
+}
+
+void JobTrace_StartReplay(void)
+{
+	g_state = JOB_TRACE_REPLAYING;
+	g_output_crc = 0;
+}
+
+void JobTrace_Command(const uint8_t* packet, uint16_t len)
+{
+	uint8_t len_field[5];
+	const uint32_t len_size = (uint32_t)(JobTrace_PutVarint(len_field, len) - len_field);
+	uint8_t* p = JobTrace_BeginRecord(JOB_TRACE_COMMAND, len_size + len);
+	if (p != NULL) {
+		memcpy(p, len_field, len_size);
+		memcpy(p + len_size, packet, len);
+	}
+}
+
+void JobTrace_Response(const CAN_Response_t* response)
+{
+	uint8_t* p = JobTrace_BeginRecord(JOB_TRACE_RESPONSE, JOB_TRACE_RESPONSE_SIZE);
+	if (p != NULL) {
+		p[0] = (uint8_t)(response->job_id & 0xFF);
+		p[1] = (uint8_t)(response->job_id >> 8);
+		p[2] = response->executor_id;
+		p[3] = response->action_tag;
+		p[4] = response->status_ok ? 1 : 0;
+	}
+}
+
+void JobTrace_Timer(void)
+{
+	JobTrace_BeginRecord(JOB_TRACE_TIMER, 0);
+}
+
+void JobTrace_Tick(void)
+{
+	if (g_state == JOB_TRACE_RECORDING && HAL_GetTick() != g_last_tick) {
+		JobTrace_BeginRecord(JOB_TRACE_TICK, 0);
+	}
+}
+
+void JobTrace_Output(const void* data, uint16_t len)
+{
+	if (g_state != JOB_TRACE_OFF) {
+		g_output_crc = RecipeFlash_Crc32(g_output_crc, data, len);
+	}
+}
+
+void JobTrace_OutputCan(const CAN_Message_t* msg)
+{
+	if (g_state != JOB_TRACE_OFF) {
+		// Поля по отдельности: выравнивание структуры в CRC не попадает
+		const uint8_t id[4] = { (uint8_t)msg->id, (uint8_t)(msg->id >> 8), (uint8_t)(msg->id >> 16), (uint8_t)(msg->id >> 24) };
+		const uint8_t dlc = (msg->dlc <= sizeof(msg->data)) ? msg->dlc : (uint8_t)sizeof(msg->data);
+		g_output_crc = RecipeFlash_Crc32(g_output_crc, id, sizeof(id));
+		g_output_crc = RecipeFlash_Crc32(g_output_crc, &dlc, 1);
+		g_output_crc = RecipeFlash_Crc32(g_output_crc, msg->data, dlc);
+	}
+}
+
+void JobTrace_Stop(void)
+{
+#if APP_JOB_TRACE_BYTES > 0
+	if (g_state == JOB_TRACE_RECORDING) {
+		g_header.magic = JOB_TRACE_MAGIC;
+		g_header.version = JOB_TRACE_VERSION;
+		g_header.length = g_pos - sizeof(JobTraceHeader_t);
+		g_header.events = g_events;
+		g_header.output_crc = g_output_crc;
+		g_header.crc = RecipeFlash_Crc32(0, &g_buffer[sizeof(JobTraceHeader_t)], g_header.length);
+		memcpy(g_buffer, &g_header, sizeof(g_header));
+	}
+#endif
+	g_state = JOB_TRACE_OFF;
+}
+
+const uint8_t* JobTrace_GetData(uint32_t* out_len)
+{
+#if APP_JOB_TRACE_BYTES > 0
+	if (g_header.magic == JOB_TRACE_MAGIC) {
+		*out_len = g_pos;
+		return g_buffer;
+	}
+#endif
+	*out_len = 0;
+	return NULL;
+}
+
+uint32_t JobTrace_GetOutputCrc(void)
+{
+	return g_output_crc;
+}
+
+bool JobTrace_ReadEvent(const uint8_t** pos, const uint8_t* end, JobTraceEvent_t* out_event)
+{
+	const uint8_t* p = *pos;
+	memset(out_event, 0, sizeof(*out_event));
+	if (p >= end) {
+		return false;
+	}
+	out_event->type = *p++;
+	if (!JobTrace_GetVarint(&p, end, &out_event->dt_ms) || end - p < 2) {
+		return false;
+	}
+	out_event->checkpoint = (uint16_t)(p[0] | (p[1] << 8));
+	p += 2;
+
+	switch (out_event->type) {
+		case JOB_TRACE_COMMAND: {
+			uint32_t len;
+			if (!JobTrace_GetVarint(&p, end, &len) || len > (uint32_t)(end - p) || len > 0xFFFF) {
+				return false;
+			}
+			out_event->packet_len = (uint16_t)len;
+			out_event->packet = p;
+			p += len;
+			break;
+		}
+		case JOB_TRACE_RESPONSE:
+			if (end - p < JOB_TRACE_RESPONSE_SIZE) {
+				return false;
+			}
+			out_event->response.job_id = (uint32_t)(p[0] | (p[1] << 8));
+			out_event->response.executor_id = p[2];
+			out_event->response.action_tag = p[3];
+			out_event->response.status_ok = (p[4] != 0);
+			p += JOB_TRACE_RESPONSE_SIZE;
+			break;
+		case JOB_TRACE_TIMER:
+		case JOB_TRACE_TICK:
+			break;
+		default:
+			return false;
+	}
+	*pos = p;
+	return true;
+}
+
+uint32_t JobTrace_ConfigCrc(void)
+{
+	static const uint32_t config[] = {
+		JOB_TRACE_VERSION,
+		APP_MAX_ACTIVE_JOBS,
+		APP_JOB_TIMEOUT_MS,
+		APP_MAX_STEP_ACTIONS,
+		APP_JOB_AGING_MS,
+		APP_DISPENSER_COUNT,
+		APP_CYCLE_MS,
+		APP_JOB_HISTORY_DEPTH,
+		APP_JOB_HISTORY_MAX_STEPS,
+		APP_SIMULATE_EXECUTOR_RESPONSES,
+		APP_USB_RESP_MAX_LEN,
+		MAX_BINARY_ARGS_SIZE,
+		APP_HOST_SEQ_CACHE,
+	};
+	return RecipeFlash_Crc32(0, config, sizeof(config));
+}
+
+uint32_t JobTrace_FlashCrc(void)
+{
+	uint32_t crc = 0;
+	for (uint16_t id = 0; id <= 0xFF; id++) {
+		const RecipeFlashRecord_t* record = RecipeFlash_Find((uint8_t)id);
+		if (record != NULL) {
+			const uint8_t id_byte = (uint8_t)id;
+			crc = RecipeFlash_Crc32(crc, &id_byte, 1);
+			crc = RecipeFlash_Crc32(crc, &record->crc, sizeof(record->crc));
+		}
+	}
+	return crc;
+}
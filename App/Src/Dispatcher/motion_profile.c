@@ -0,0 +1,91 @@
+/*
+ * motion_profile.c
+ *
+ *  Created on: Mar 9, 2026
+ *      Author: andrey
+ */
+
+#include "Dispatcher/motion_profile.h"
+#include <stddef.h>
+#include <string.h>
+
+#define MOTION_MOTOR_SLOTS      16  // Номер устройства в ID кадра - 4 бита
+
+/**
+ * @brief Параметры, примененные мотором последними. 0 - неизвестны (отправляются всегда).
+ */
+typedef struct {
+	uint16_t speed;
+	uint16_t acceleration;
+	uint16_t current_ma;
+} MotionShadow_t;
+
+// --- Таблица профилей ---
+// Профили одного механизма (дозатор, игла) различаются в основном скоростью: смена
+// профиля между движениями обычно стоит одного кадра CMD_SET_SPEED.
+static const MotionProfile_t g_profiles[MOTION_PROFILE_COUNT] = {
+	[MOTION_PROFILE_CREEP]      = { .speed = 100,  .acceleration = 1000, .current_ma = 800 },
+	[MOTION_PROFILE_HOME_FINE]  = { .speed = 150,  .acceleration = 2000, .current_ma = 800 },
+	[MOTION_PROFILE_INDEX_STEP] = { .speed = 200,  .acceleration = 1000, .current_ma = 600 },
+	[MOTION_PROFILE_NORMAL]     = { .speed = 400,  .acceleration = 2000, .current_ma = 800 },
+	[MOTION_PROFILE_TRAVEL]     = { .speed = 500,  .acceleration = 2000, .current_ma = 800 },
+	[MOTION_PROFILE_FAST]       = { .speed = 800,  .acceleration = 2000, .current_ma = 800 },
+	[MOTION_PROFILE_MIXER]      = { .speed = 1000, .acceleration = 5000, .current_ma = 400 },
+};
+
+// --- Внутренние переменные ---
+static MotionShadow_t g_shadow[MOTION_MOTOR_SLOTS];
+
+// --- API функции ---
+
+void MotionProfile_Init(void)
+{
+	memset(g_shadow, 0, sizeof(g_shadow));
+}
+
+const MotionProfile_t* MotionProfile_Get(uint16_t index)
+{
+	return (index < MOTION_PROFILE_COUNT) ? &g_profiles[index] : NULL;
+}
+
+uint16_t MotionProfile_Speed(uint16_t speed)
+{
+	if (!MOTION_PROFILE_IS_REF(speed)) {
+		return speed;
+	}
+	const MotionProfile_t* profile = MotionProfile_Get(MOTION_PROFILE_INDEX(speed));
+	return (profile != NULL) ? profile->speed : 0;
+}
+
+uint8_t MotionProfile_PrepareFrames(uint8_t motor_id, uint16_t speed, CAN_Message_t out_frames[MOTION_SETUP_FRAMES_MAX])
+{
+	MotionShadow_t* shadow = &g_shadow[motor_id % MOTION_MOTOR_SLOTS];
+	MotionShadow_t wanted = *shadow;
+	const MotionProfile_t* profile = MOTION_PROFILE_IS_REF(speed) ? MotionProfile_Get(MOTION_PROFILE_INDEX(speed)) : NULL;
+	if (profile != NULL) {
+		wanted.speed = profile->speed;
+		wanted.acceleration = profile->acceleration;
+		wanted.current_ma = profile->current_ma;
+	} else {
+		// Скорость без профиля (или неизвестный профиль - его отсекает Recipe_Validate)
+		wanted.speed = MotionProfile_Speed(speed);
+	}
+
+	uint8_t count = 0;
+	if (wanted.speed != shadow->speed || wanted.speed == 0) {
+		Packer_CreateSetSpeedMsg(motor_id, wanted.speed, &out_frames[count++]);
+	}
+	if (wanted.acceleration != shadow->acceleration) {
+		Packer_CreateSetAccelerationMsg(motor_id, wanted.acceleration, &out_frames[count++]);
+	}
+	if (wanted.current_ma != shadow->current_ma) {
+		Packer_CreateSetCurrentMsg(motor_id, wanted.current_ma, &out_frames[count++]);
+	}
+	*shadow = wanted;
+	return count;
+}
+
+void MotionProfile_Forget(uint8_t motor_id)
+{
+	memset(&g_shadow[motor_id % MOTION_MOTOR_SLOTS], 0, sizeof(MotionShadow_t));
+}
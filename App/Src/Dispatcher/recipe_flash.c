@@ -0,0 +1,271 @@
+/*
+ * recipe_flash.c
+ *
+ *  Created on: Feb 9, 2026
+ *      Author: andrey
+ */
+
+#include "Dispatcher/recipe_flash.h"
+#include "Dispatcher/action_frames.h"
+#include "flash_storage.h"
+#include <string.h>
+#include <stddef.h>
+
+/*
+ * Хранилище - журнал записей в одном из двух банков (секторов Flash):
+ *
+ *   [заголовок банка][запись][запись]...[0xFF...]
+ *
+ * Новая версия рецепта или удаление дописываются в конец, стирать сектор при
+ * каждой загрузке не нужно. Каталог (последняя запись по каждому ID) строится
+ * в RAM при старте. Когда банк заполнен, живые записи копируются во второй банк,
+ * и его заголовок с большим номером пишется последним: при сбое питания во время
+ * уплотнения остается действующим прежний банк.
+ */
+
+#define RECIPE_FLASH_BANK_MAGIC     0x42504352u  // "RCPB"
+#define RECIPE_FLASH_RECORD_MAGIC   0x52504352u  // "RCPR"
+#define RECIPE_FLASH_ERASED         0xFFFFFFFFu
+
+#define RECIPE_FLASH_ALIGN(size)    (((size) + FLASH_STORAGE_WORD_SIZE - 1) & ~(FLASH_STORAGE_WORD_SIZE - 1))
+
+typedef struct {
+	uint32_t magic;              // RECIPE_FLASH_BANK_MAGIC
+	uint32_t sequence;           // Растет при каждом уплотнении: действует банк с большим номером
+	uint32_t reserved[6];
+} RecipeFlashBankHeader_t;
+
+_Static_assert(sizeof(RecipeFlashBankHeader_t) == FLASH_STORAGE_WORD_SIZE, "Заголовок банка - одно Flash-слово");
+
+static const RecipeFlashRecord_t* g_directory[RECIPE_STORE_MAX_ID];
+static uint8_t g_active_bank = 0;
+static uint32_t g_sequence = 0;
+static uint32_t g_write_offset = FLASH_STORAGE_BANK_SIZE; // Первое свободное слово; до Init - "заполнено"
+
+// --- Прототипы внутренних функций ---
+static uint32_t RecipeFlash_RecordSize(uint8_t length);
+static bool RecipeFlash_Program(uint8_t bank, uint32_t offset, const void* data, uint32_t len);
+static bool RecipeFlash_Format(uint8_t bank, uint32_t sequence);
+static void RecipeFlash_Scan(void);
+static bool RecipeFlash_Compact(void);
+static RecipeFlashStatus_t RecipeFlash_Append(const RecipeFlashRecord_t* header, const RecipeInstr_t* code, bool allow_compaction);
+
+// --- API функции ---
+
+void RecipeFlash_Init(void)
+{
+	int8_t best = -1;
+	for (uint8_t bank = 0; bank < FLASH_STORAGE_BANK_COUNT; bank++) {
+		const RecipeFlashBankHeader_t* header = (const RecipeFlashBankHeader_t*)FlashStorage_GetBank(bank);
+		if (header->magic == RECIPE_FLASH_BANK_MAGIC &&
+		    (best < 0 || (int32_t)(header->sequence - g_sequence) > 0)) {
+			best = (int8_t)bank;
+			g_sequence = header->sequence;
+		}
+	}
+
+	if (best < 0) {
+		// Первый запуск: хранилище пустое
+		g_sequence = 1;
+		best = 0;
+		if (!RecipeFlash_Format(0, g_sequence)) {
+			memset(g_directory, 0, sizeof(g_directory));
+			g_write_offset = FLASH_STORAGE_BANK_SIZE; // Без записи: остаются встроенные рецепты
+			return;
+		}
+	}
+	g_active_bank = (uint8_t)best;
+	RecipeFlash_Scan();
+}
+
+const RecipeFlashRecord_t* RecipeFlash_Find(uint8_t recipe_id)
+{
+	return (recipe_id < RECIPE_STORE_MAX_ID) ? g_directory[recipe_id] : NULL;
+}
+
+RecipeFlashStatus_t RecipeFlash_Store(uint8_t recipe_id, const RecipeInstr_t* code, uint8_t length,
+                                      ResourceMask_t resources, const RecipeArgLayout_t* args, bool allow_compaction)
+{
+	if (recipe_id == RECIPE_NONE || recipe_id >= RECIPE_STORE_MAX_ID) {
+		return RECIPE_FLASH_NOT_FOUND;
+	}
+
+	RecipeFlashRecord_t header;
+	memset(&header, 0, sizeof(header));
+	header.magic = RECIPE_FLASH_RECORD_MAGIC;
+	header.recipe_id = recipe_id;
+	header.length = length;
+	header.resources = resources;
+	if (args != NULL) {
+		header.args = *args;
+	}
+	header.crc = RecipeFlash_Crc32(0, &header.args, sizeof(header.args));
+	header.crc = RecipeFlash_Crc32(header.crc, code, (uint32_t)length * sizeof(RecipeInstr_t));
+	const RecipeFlashStatus_t status = RecipeFlash_Append(&header, code, allow_compaction);
+	ActionFrames_Invalidate(); // Уплотнение перемещает программы, адреса шаблонов устаревают
+	return status;
+}
+
+RecipeFlashStatus_t RecipeFlash_Delete(uint8_t recipe_id, bool allow_compaction)
+{
+	if (RecipeFlash_Find(recipe_id) == NULL) {
+		return RECIPE_FLASH_NOT_FOUND;
+	}
+	return RecipeFlash_Store(recipe_id, NULL, 0, 0, NULL, allow_compaction);
+}
+
+uint32_t RecipeFlash_GetFreeBytes(void)
+{
+	return FLASH_STORAGE_BANK_SIZE - g_write_offset;
+}
+
+uint32_t RecipeFlash_Crc32(uint32_t crc, const void* data, uint32_t len)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	crc = ~crc;
+	while (len--) {
+		crc ^= *p++;
+		for (uint8_t bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+		}
+	}
+	return ~crc;
+}
+
+// --- Внутренние функции ---
+
+static uint32_t RecipeFlash_RecordSize(uint8_t length)
+{
+	return RECIPE_FLASH_ALIGN(sizeof(RecipeFlashRecord_t) + (uint32_t)length * sizeof(RecipeInstr_t));
+}
+
+/**
+ * @brief Пишет данные с границы Flash-слова. Данные копируются пословно через RAM,
+ *        поэтому источником может быть и другой банк Flash (уплотнение).
+ */
+static bool RecipeFlash_Program(uint8_t bank, uint32_t offset, const void* data, uint32_t len)
+{
+	const uint8_t* src = (const uint8_t*)data;
+	for (uint32_t pos = 0; pos < len; pos += FLASH_STORAGE_WORD_SIZE) {
+		uint32_t word[FLASH_STORAGE_WORD_SIZE / sizeof(uint32_t)];
+		const uint32_t chunk = (len - pos < FLASH_STORAGE_WORD_SIZE) ? (len - pos) : FLASH_STORAGE_WORD_SIZE;
+		memset(word, 0xFF, sizeof(word));
+		memcpy(word, src + pos, chunk);
+		if (!FlashStorage_ProgramWord(bank, offset + pos, word)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool RecipeFlash_Format(uint8_t bank, uint32_t sequence)
+{
+	RecipeFlashBankHeader_t header;
+	memset(&header, 0xFF, sizeof(header));
+	header.magic = RECIPE_FLASH_BANK_MAGIC;
+	header.sequence = sequence;
+	return FlashStorage_EraseBank(bank) && RecipeFlash_Program(bank, 0, &header, sizeof(header));
+}
+
+/**
+ * @brief Проходит журнал активного банка: строит каталог и находит место для записи.
+ *        Записи с неверной CRC (прерванная запись) пропускаются.
+ */
+static void RecipeFlash_Scan(void)
+{
+	const uint8_t* base = FlashStorage_GetBank(g_active_bank);
+	uint32_t offset = sizeof(RecipeFlashBankHeader_t);
+
+	memset(g_directory, 0, sizeof(g_directory));
+	while (offset + sizeof(RecipeFlashRecord_t) <= FLASH_STORAGE_BANK_SIZE) {
+		const RecipeFlashRecord_t* record = (const RecipeFlashRecord_t*)(base + offset);
+		if (record->magic == RECIPE_FLASH_ERASED) {
+			break;
+		}
+		const uint32_t size = RecipeFlash_RecordSize(record->length);
+		if (record->magic != RECIPE_FLASH_RECORD_MAGIC || offset + size > FLASH_STORAGE_BANK_SIZE) {
+			offset = FLASH_STORAGE_BANK_SIZE; // Журнал поврежден: дописывать только после уплотнения
+			break;
+		}
+		uint32_t crc = RecipeFlash_Crc32(0, &record->args, sizeof(record->args));
+		crc = RecipeFlash_Crc32(crc, RecipeFlash_GetCode(record), (uint32_t)record->length * sizeof(RecipeInstr_t));
+		if (crc == record->crc && record->recipe_id < RECIPE_STORE_MAX_ID) {
+			g_directory[record->recipe_id] = (record->length != 0) ? record : NULL;
+		}
+		offset += size;
+	}
+	g_write_offset = offset;
+}
+
+/**
+ * @brief Переносит действующие записи во второй банк и делает его активным.
+ */
+static bool RecipeFlash_Compact(void)
+{
+	const uint8_t target = (uint8_t)((g_active_bank + 1) % FLASH_STORAGE_BANK_COUNT);
+	const uint8_t* target_base = FlashStorage_GetBank(target);
+	const RecipeFlashRecord_t* directory[RECIPE_STORE_MAX_ID] = { NULL };
+	uint32_t offset = sizeof(RecipeFlashBankHeader_t);
+
+	if (!FlashStorage_EraseBank(target)) {
+		return false;
+	}
+	for (uint8_t id = 0; id < RECIPE_STORE_MAX_ID; id++) {
+		if (g_directory[id] == NULL) {
+			continue;
+		}
+		const uint32_t size = RecipeFlash_RecordSize(g_directory[id]->length);
+		if (!RecipeFlash_Program(target, offset, g_directory[id], size)) {
+			return false;
+		}
+		directory[id] = (const RecipeFlashRecord_t*)(target_base + offset);
+		offset += size;
+	}
+
+	// Заголовок - последним: до этого момента действует прежний банк
+	RecipeFlashBankHeader_t header;
+	memset(&header, 0xFF, sizeof(header));
+	header.magic = RECIPE_FLASH_BANK_MAGIC;
+	header.sequence = g_sequence + 1;
+	if (!RecipeFlash_Program(target, 0, &header, sizeof(header))) {
+		return false;
+	}
+
+	g_sequence++;
+	g_active_bank = target;
+	g_write_offset = offset;
+	memcpy(g_directory, directory, sizeof(g_directory));
+	return true;
+}
+
+static RecipeFlashStatus_t RecipeFlash_Append(const RecipeFlashRecord_t* header, const RecipeInstr_t* code, bool allow_compaction)
+{
+	const uint32_t size = RecipeFlash_RecordSize(header->length);
+	if (g_write_offset + size > FLASH_STORAGE_BANK_SIZE) {
+		if (!allow_compaction) {
+			return RECIPE_FLASH_FULL;
+		}
+		if (!RecipeFlash_Compact()) {
+			return RECIPE_FLASH_WRITE_ERROR;
+		}
+		if (g_write_offset + size > FLASH_STORAGE_BANK_SIZE) {
+			return RECIPE_FLASH_FULL;
+		}
+	}
+
+	// Заголовок пишется первым: по его длине Scan перешагнет запись, даже если
+	// программа не дописана (такую запись отсечет CRC)
+	const uint32_t offset = g_write_offset;
+	g_write_offset += size; // Даже неудачная запись занимает место: слова Flash пишутся один раз
+	if (!RecipeFlash_Program(g_active_bank, offset, header, sizeof(RecipeFlashRecord_t))) {
+		return RECIPE_FLASH_WRITE_ERROR;
+	}
+	if (header->length != 0 &&
+	    !RecipeFlash_Program(g_active_bank, offset + sizeof(RecipeFlashRecord_t), code, (uint32_t)header->length * sizeof(RecipeInstr_t))) {
+		return RECIPE_FLASH_WRITE_ERROR;
+	}
+
+	const RecipeFlashRecord_t* record = (const RecipeFlashRecord_t*)(FlashStorage_GetBank(g_active_bank) + offset);
+	g_directory[header->recipe_id] = (header->length != 0) ? record : NULL;
+	return RECIPE_FLASH_OK;
+}
@@ -6,7 +6,10 @@
  */
 
 #include "recipe_store.h"
+#include "recipe_flash.h"
 #include <stddef.h> // Для NULL
+#include <stdbool.h>
+#include <string.h> // Для memset
 
  // ============================================================================
  // ---                  ХРАНИЛИЩЕ РЕЦЕПТОВ (во Flash-памяти)                ---
@@ -16,154 +19,137 @@
   * @brief Рецепт: Инициализация всей системы (Homing).
   *
   * Выполняется один раз при старте для приведения механизмов в известное положение.
+  * Аргумент 0 - маска модулей INIT (бит 0: дозаторы), см. g_args_initialize_system.
   */
- const ProcessStep_t g_recipe_initialize_system[] = {
-     // Шаг 1: Поиск "дома" для иглы (мотор 2). Группа из ОДНОГО действия.
-     {
-         .atomic_actions = (const AtomicAction_t[]){ // Составной литерал для группы из одного действия
-             { .action = ACTION_HOME_MOTOR, .params.home_motor = { .motor_id=2, .speed=150 } }
-         },
-         .num_actions = 1
-     },
-
-     // Шаг 2: Поиск "дома" для дозатора (мотор 1). Группа из ОДНОГО действия.
-     {
-         .atomic_actions = (const AtomicAction_t[]){ // Составной литерал для группы из одного действия
-             { .action = ACTION_HOME_MOTOR, .params.home_motor = { .motor_id=1, .speed=400 } }
-         },
-         .num_actions = 1
-     },
-
-     // Маркер конца рецепта. Группа из НУЛЯ действий.
-     { .atomic_actions = NULL, .num_actions = 0 }
+ const RecipeInstr_t g_recipe_initialize_system[] = {
+     /* 0 */ { R_JUMP_UNLESS_ARG(0, 0x01, 3) },   // Дозаторы не выбраны - пропуск
+     /* 1 */ { R_HOME_P(2, HOME_FINE, 4000) },    // Поиск "дома" для иглы (мотор 2)
+     /* 2 */ { R_HOME_P(1, NORMAL, 2000) },       // Поиск "дома" для дозатора (мотор 1)
+     /* 3 */ { R_END() }
  };
 
  /**
-  * @brief Рецепт: Взять реагент (Aspirate Reagent). Пример смешанного рецепта.
+  * @brief Рецепт: Взять реагент (Aspirate Reagent). Пример рецепта с графом зависимостей.
+  *
+  * Один блок вместо шести шагов: каждое действие стартует, как только завершились
+  * его предшественники, без ожидания всех действий предыдущего шага.
+  * Аргумент 0 - dispenser_id (g_args_aspirate_reagent): моторы и насос выбираются по номеру дозатора.
   */
- const ProcessStep_t g_recipe_aspirate_reagent[] = {
-     // Шаг 1: Поворот дозатора (мотор 1) к пробирке. Группа из ОДНОГО действия.
-     {
-         .atomic_actions = (const AtomicAction_t[]){
-             { .action = ACTION_ROTATE_MOTOR, .params.rotate_motor = { .motor_id=1, .steps=1000, .speed=500 } }
-         },
-         .num_actions = 1
-     },
-
-     // Шаг 2: Опускание иглы (мотор 2). Группа из ОДНОГО действия.
-     {
-         .atomic_actions = (const AtomicAction_t[]){
-             { .action = ACTION_ROTATE_MOTOR, .params.rotate_motor = { .motor_id=2, .steps=200, .speed=100 } }
-         },
-         .num_actions = 1
-     },
-
-     // Шаг 3: Включение насоса и небольшая пауза. Группа из ДВУХ действий (параллельно).
-     {
-         .atomic_actions = (const AtomicAction_t[]){
-             { .action = ACTION_START_PUMP,   .params.pump = { .pump_id=1 } },
-             { .action = ACTION_WAIT_MS,      .params.wait = { .delay_ms=500 } }
-         },
-         .num_actions = 2
-     },
-
-     // Шаг 4: Выключение насоса. Группа из ОДНОГО действия.
-     {
-         .atomic_actions = (const AtomicAction_t[]){
-             { .action = ACTION_STOP_PUMP,    .params.pump = { .pump_id=1 } }
-         },
-         .num_actions = 1
-     },
-
-     // Шаг 5: Поднятие иглы (мотор 2 в обратную сторону). Группа из ОДНОГО действия.
-     {
-         .atomic_actions = (const AtomicAction_t[]){
-             { .action = ACTION_ROTATE_MOTOR, .params.rotate_motor = { .motor_id=2, .steps=-200, .speed=100 } }
-         },
-         .num_actions = 1
-     },
-
-     // Шаг 6: Возврат дозатора (мотор 1 в обратную сторону). Группа из ОДНОГО действия.
-     {
-         .atomic_actions = (const AtomicAction_t[]){
-             { .action = ACTION_ROTATE_MOTOR, .params.rotate_motor = { .motor_id=1, .steps=-1000, .speed=500 } }
-         },
-         .num_actions = 1
-     },
-
-     // Маркер конца рецепта. Группа из НУЛЯ действий.
-     { .atomic_actions = NULL, .num_actions = 0 }
+#define ASPIRATE_MOTOR         RECIPE_BIND_DEVICE(0, 2)   // Моторы 2N-1 (поворот) и 2N (игла)
+#define ASPIRATE_PUMP          RECIPE_BIND_DEVICE(0, 1)   // Насос N
+
+ const RecipeInstr_t g_recipe_aspirate_reagent[] = {
+     /* 0 */ { R_DAG_BEGIN(RECIPE_AFTER(1, 0) |                                   // Игла опускается у пробирки,
+                           RECIPE_AFTER(2, 1) | RECIPE_AFTER(3, 1) |              // насос и отсчет забора - в нижней точке,
+                           RECIPE_AFTER(4, 2) | RECIPE_AFTER(4, 3) |              // насос выключается по окончании забора,
+                           RECIPE_AFTER(5, 4) | RECIPE_AFTER(6, 5)) },            // затем подъем иглы и возврат дозатора
+     /* 1 */ { R_ROTATE_P(1, 1000, TRAVEL, 3000), .dev_bind = ASPIRATE_MOTOR },   // 0: поворот дозатора к пробирке
+     /* 2 */ { R_ROTATE_P(2, 200, CREEP, 3000), .dev_bind = ASPIRATE_MOTOR },     // 1: опускание иглы
+     /* 3 */ { R_PUMP_ON(1, 200), .dev_bind = ASPIRATE_PUMP },                    // 2: включение насоса
+     /* 4 */ { R_WAIT(500) },                                                     // 3: забор реагента
+     /* 5 */ { R_PUMP_OFF(1, 200), .dev_bind = ASPIRATE_PUMP },                   // 4: выключение насоса
+     /* 6 */ { R_ROTATE_P(2, -200, CREEP, 3000), .dev_bind = ASPIRATE_MOTOR },    // 5: поднятие иглы
+     /* 7 */ { R_ROTATE_P(1, -1000, TRAVEL, 3000), .dev_bind = ASPIRATE_MOTOR },  // 6: возврат дозатора
+     /* 8 */ { R_PAR_END() },
+     /* 9 */ { R_END() }
  };
 
  /**
-  * @brief Шаблон рецепта: Промывка дозатора (DISPENSER_WASH).
+  * @brief Рецепт: Промывка дозатора (DISPENSER_WASH).
   *
-  * @note Это шаблон для ОДНОГО цикла промывки. JobManager будет использовать
-  *       параметры из команды (dispenser_id, volume, cycles), чтобы адаптировать
-  *       этот шаблон при выполнении.
+  * Аргументы (g_args_dispenser_wash): 0 - dispenser_id, 1 - volume [мкл], 2 - cycles.
+  * Моторы и насос выбираются по номеру дозатора (см. APP_DISPENSER_COUNT),
+  * время подачи жидкости - по объему, цикл промывки повторяется cycles раз.
   */
-const ProcessStep_t g_recipe_dispenser_wash[] = {
-
-		// Шаг 1: Поворот дозатора (Мотор 1) к промывочной станции.
-		{
-				.atomic_actions = (const AtomicAction_t[]){
-					{ .action = ACTION_ROTATE_MOTOR, .params.rotate_motor = { .motor_id = 1, .steps = 2000, .speed = 800 } }
-					},
-					.num_actions = 1
-					},
-
-		// Шаг 2: Опускание иглы (Мотор 2) в промывочную станцию.
-		{
-				.atomic_actions = (const AtomicAction_t[]){
-					{ .action = ACTION_ROTATE_MOTOR, .params.rotate_motor = { .motor_id = 2, .steps = 500, .speed = 400 } }
-					},
-					.num_actions = 1
-					},
-
-		// Шаг 3: Включение насоса и короткая пауза для заполнения.
-		// JobManager будет адаптировать время паузы под параметр 'volume'.
-		{
-				.atomic_actions = (const AtomicAction_t[]){
-					{ .action = ACTION_START_PUMP, .params.pump = { .pump_id = 1 } },
-					{ .action = ACTION_WAIT_MS,    .params.wait = { .delay_ms = 500 } }
-					},
-					.num_actions = 2 // Два действия выполняются одновременно
-					},
-
-		// Шаг 4: Выключение насоса.
-		{
-				.atomic_actions = (const AtomicAction_t[]){
-					{ .action = ACTION_STOP_PUMP, .params.pump = { .pump_id = 1 } }
-					},
-					.num_actions = 1
-					},
-
-		// Шаг 5: Поднятие иглы (Мотор 2).
-		{
-				.atomic_actions = (const AtomicAction_t[]){
-					{ .action = ACTION_ROTATE_MOTOR, .params.rotate_motor = { .motor_id = 2, .steps = -500, .speed = 400 } }
-					},
-					.num_actions = 1
-					},
-
-		// Шаг 6: Возврат дозатора (Мотор 1) в исходное положение.
-		{
-				.atomic_actions = (const AtomicAction_t[]){
-					{ .action = ACTION_ROTATE_MOTOR, .params.rotate_motor = { .motor_id = 1, .steps = -2000, .speed = 800 } }
-					},
-		.num_actions = 1
-		},
-
-		// Маркер конца рецепта.
-		{ .atomic_actions = NULL, .num_actions = 0 }
-		};
+#define WASH_DISPENSER_MOTOR   RECIPE_BIND_DEVICE(0, 2)   // Моторы 2N-1 (поворот) и 2N (игла)
+#define WASH_DISPENSER_PUMP    RECIPE_BIND_DEVICE(0, 1)   // Насос N
+#define WASH_PUMP_MS_PER_UL    (RECIPE_VALUE_SCALE / 2)   // Производительность насоса 2 мкл/мс
+
+ const RecipeInstr_t g_recipe_dispenser_wash[] = {
+     /*  0 */ { R_ROTATE_P(1, 2000, FAST, 4000), .dev_bind = WASH_DISPENSER_MOTOR },    // Поворот к промывочной станции
+     /*  1 */ { R_LOOP_ARG(2) },                                                        // cycles раз:
+     /*  2 */ { R_ROTATE_P(2, 500, NORMAL, 2500), .dev_bind = WASH_DISPENSER_MOTOR },   //   опускание иглы
+     /*  3 */ { R_PAR_BEGIN() },                                                        //   подача 'volume' мкл
+     /*  4 */ { R_PUMP_ON(1, 200), .dev_bind = WASH_DISPENSER_PUMP },
+     /*  5 */ { R_WAIT_ARG(1, WASH_PUMP_MS_PER_UL) },
+     /*  6 */ { R_PAR_END() },
+     /*  7 */ { R_PUMP_OFF(1, 200), .dev_bind = WASH_DISPENSER_PUMP },                  //   выключение насоса
+     /*  8 */ { R_ROTATE_P(2, -500, NORMAL, 2500), .dev_bind = WASH_DISPENSER_MOTOR },  //   поднятие иглы
+     /*  9 */ { R_END_LOOP() },
+     /* 10 */ { R_ROTATE_P(1, -2000, FAST, 4000), .dev_bind = WASH_DISPENSER_MOTOR },   // Возврат в исходное положение
+     /* 11 */ { R_END() }
+ };
 
 
+ /**
+  * @brief Рецепты слотов машинного цикла (cycle_scheduler.c): по одному действию
+  *        модуля над кюветой, стоящей у него после поворота реакционного диска.
+  */
+ const RecipeInstr_t g_recipe_mixer_mix[] = {
+     /* 0 */ { R_ROTATE_P(9, RECIPE_VALUE_SCALE, MIXER, 5000), .val_bind = RECIPE_ARG(0) },  // duration мс при 1000 шаг/с
+     /* 1 */ { R_END() }
+ };
+
+ const RecipeInstr_t g_recipe_reaction_step[] = {
+     /* 0 */ { R_ROTATE_P(10, 50, INDEX_STEP, 1000) },  // Реакционный диск на одну кювету
+     /* 1 */ { R_END() }
+ };
+
+ const RecipeInstr_t g_recipe_cuvette_wash[] = {
+     /* 0 */ { R_PAR_BEGIN() },                      // Промывка кюветы на моющей станции
+     /* 1 */ { R_PUMP_ON(3, 200) },
+     /* 2 */ { R_WAIT(1500) },
+     /* 3 */ { R_PAR_END() },
+     /* 4 */ { R_PUMP_OFF(3, 200) },
+     /* 5 */ { R_END() }
+ };
+
+
+ // ============================================================================
+ // ---                  РАСКЛАДКИ АРГУМЕНТОВ РЕЦЕПТОВ                       ---
+ // ============================================================================
+
+ // INIT (0x1002): modules (UINT8). Без параметров - все модули.
+ static const RecipeArgLayout_t g_args_initialize_system = {
+     .count = 1,
+     .fields = {
+         { .offset = 0, .size = 1, .min_value = 0, .max_value = 0xFF, .default_value = 0xFF },
+     }
+ };
+
+ // ASPIRATE: dispenser_id (UINT8). Без параметров - дозатор 1.
+ static const RecipeArgLayout_t g_args_aspirate_reagent = {
+     .count = 1,
+     .fields = {
+         { .offset = 0, .size = 1, .min_value = 1, .max_value = APP_DISPENSER_COUNT, .default_value = 1 },
+     }
+ };
+
+ // MIXER_MIX: duration [мс] (UINT16)
+ static const RecipeArgLayout_t g_args_mixer_mix = {
+     .count = 1,
+     .fields = {
+         { .offset = 0, .size = 2, .min_value = 100, .max_value = 4000, .default_value = 2000 },
+     }
+ };
+
+ // DISPENSER_WASH (0x2000): dispenser_id (UINT8), volume (UINT16), cycles (UINT8)
+ static const RecipeArgLayout_t g_args_dispenser_wash = {
+     .count = 3,
+     .fields = {
+         { .offset = 0, .size = 1, .min_value = 1,  .max_value = APP_DISPENSER_COUNT, .default_value = 1 },
+         { .offset = 1, .size = 2, .min_value = 10, .max_value = 5000, .default_value = 1000 },
+         { .offset = 3, .size = 1, .min_value = 1,  .max_value = 10,   .default_value = 1 },
+     }
+ };
+
 
 
 // --- [ADD_NEW_COMMAND] ---
 // 3. Скопируйте существующий рецепт как шаблон и создайте здесь свой,
-//    например, g_recipe_wash_cuvette.
+//    например, g_recipe_wash_cuvette. Параметры команды описываются раскладкой
+//    аргументов (RecipeArgLayout_t) и подставляются в инструкции через
+//    .dev_bind / .val_bind. Последняя инструкция - R_END().
 
 
 
@@ -173,28 +159,332 @@ const ProcessStep_t g_recipe_dispenser_wash[] = {
  // ---                 API "Recipe store" (Оглавление)                   ---
  // ============================================================================
 
+ /*
+  * Оглавление встроенных рецептов - по строке на каждый RecipeID_t:
+  *   RECIPE(ID, программа, ресурсы, раскладка аргументов или NULL)
+  *   NO_PROGRAM(ID) - встроенной программы нет (ID может занять загруженный рецепт).
+  * Ресурсы - помимо моторов и насосов действий рецепта (их JobManager добавляет сам).
+  */
+ #define RECIPE_BUILTINS(RECIPE, NO_PROGRAM) \
+     NO_PROGRAM(RECIPE_START_MOTOR) \
+     RECIPE(RECIPE_ASPIRATE,          g_recipe_aspirate_reagent,  0,        &g_args_aspirate_reagent)   /* Моторы и насос - по dispenser_id: дозаторы работают параллельно */ \
+     RECIPE(RECIPE_INITIALIZE_SYSTEM, g_recipe_initialize_system, RES_ALL,  &g_args_initialize_system)  /* Приведение механизмов в исходное положение - монопольно */ \
+     RECIPE(RECIPE_DISPENSER_WASH,    g_recipe_dispenser_wash,    RES_PROBE | RES_MODULE_WASH_STATION, &g_args_dispenser_wash) \
+     RECIPE(RECIPE_MIXER_MIX,         g_recipe_mixer_mix,         RES_MODULE_MIXER,                    &g_args_mixer_mix) \
+     RECIPE(RECIPE_REACTION_STEP,     g_recipe_reaction_step,     RES_MODULE_REACTION_DISK,            NULL) \
+     RECIPE(RECIPE_CUVETTE_WASH,      g_recipe_cuvette_wash,      RES_MODULE_WASH_STATION,             NULL) \
+     /* --- [ADD_NEW_COMMAND] --- */ \
+     /* 4. Добавьте строку вашего нового рецепта здесь: */ \
+     /* RECIPE(RECIPE_WASH_CUVETTE, g_recipe_wash_cuvette, RES_MODULE_WASH_STATION, NULL) */
+
+ #define RECIPE_COUNT_OF(code)   (sizeof(code) / sizeof((code)[0]))
+
+ typedef struct {
+     const RecipeInstr_t* code;       // NULL - встроенной программы нет
+     const RecipeArgLayout_t* args;
+     ResourceMask_t resources;
+     uint8_t length;
+ } RecipeBuiltin_t;
+
+ #define RECIPE_ROW(id, code, resources, args)   [id] = { (code), (args), (resources), (uint8_t)RECIPE_COUNT_OF(code) },
+ #define RECIPE_ROW_NONE(id)                     [id] = { NULL, NULL, RES_ALL, 0 },
+
+ static const RecipeBuiltin_t g_builtins[RECIPE_MAX_ID] = {
+     RECIPE_BUILTINS(RECIPE_ROW, RECIPE_ROW_NONE)
+ };
+
+ // --- Проверки оглавления при сборке ---
+
+ // Строка на каждый ID, и только одна: повтор ID - повтор имени поля, пропуск - не сходится размер
+ #define RECIPE_COVER(id, ...)   char id;
+ #define RECIPE_COVER_NONE(id)   char id;
+ struct RecipeBuiltinsCoverage { RECIPE_BUILTINS(RECIPE_COVER, RECIPE_COVER_NONE) };
+ _Static_assert(sizeof(struct RecipeBuiltinsCoverage) == RECIPE_MAX_ID - 1, "RECIPE_BUILTINS: every RecipeID_t needs exactly one row");
+ _Static_assert(RECIPE_MAX_ID <= RECIPE_STORE_MAX_ID, "RecipeID_t does not fit RECIPE_STORE_MAX_ID");
+
+ // Длина программы известна по размеру массива: ни терминатор, ни switch длину не задают
+ #define RECIPE_CHECK_LENGTH(id, code, resources, args) \
+     _Static_assert(RECIPE_COUNT_OF(code) >= 1 && RECIPE_COUNT_OF(code) <= RECIPE_MAX_LENGTH, #code ": length must be 1..RECIPE_MAX_LENGTH");
+ #define RECIPE_CHECK_NONE(id)
+ RECIPE_BUILTINS(RECIPE_CHECK_LENGTH, RECIPE_CHECK_NONE)
+
+ /**
+  * @brief Строка оглавления с встроенной программой или NULL.
+  */
+ static const RecipeBuiltin_t* Recipe_FindBuiltin(RecipeID_t id)
+ {
+     if ((unsigned)id >= RECIPE_MAX_ID || g_builtins[id].code == NULL) {
+         return NULL;
+     }
+     return &g_builtins[id];
+ }
+
  /**
   * @brief Находит и возвращает указатель на запрошенный рецепт.
-    98  */
- const ProcessStep_t* Recipe_Get(RecipeID_t id)
+  */
+ const RecipeInstr_t* Recipe_Get(RecipeID_t id, uint8_t* out_length)
  {
-     switch (id)
-     {
-        case RECIPE_INITIALIZE_SYSTEM:
-        	return g_recipe_initialize_system;
+     const RecipeFlashRecord_t* uploaded = RecipeFlash_Find((uint8_t)id);
+     if (uploaded != NULL) {
+         *out_length = uploaded->length;
+         return RecipeFlash_GetCode(uploaded);
+     }
 
-        case RECIPE_ASPIRATE:
-        	return g_recipe_aspirate_reagent;
+     const RecipeBuiltin_t* builtin = Recipe_FindBuiltin(id);
+     *out_length = (builtin != NULL) ? builtin->length : 0;
+     return (builtin != NULL) ? builtin->code : NULL;
+ }
 
-        case RECIPE_DISPENSER_WASH:
-        	return g_recipe_dispenser_wash;
+ /**
+  * @brief Находит набор ресурсов рецепта. Должен покрывать все устройства,
+  *        к которым обращаются действия рецепта.
+  */
+ ResourceMask_t Recipe_GetResources(RecipeID_t id)
+ {
+     const RecipeFlashRecord_t* uploaded = RecipeFlash_Find((uint8_t)id);
+     if (uploaded != NULL) {
+         return uploaded->resources;
+     }
+
+     const RecipeBuiltin_t* builtin = Recipe_FindBuiltin(id);
+     return (builtin != NULL) ? builtin->resources : RES_ALL;
+ }
+
+ static const RecipeArgLayout_t* Recipe_GetArgLayout(RecipeID_t id)
+ {
+     const RecipeFlashRecord_t* uploaded = RecipeFlash_Find((uint8_t)id);
+     if (uploaded != NULL) {
+         return &uploaded->args;
+     }
+
+     const RecipeBuiltin_t* builtin = Recipe_FindBuiltin(id);
+     return (builtin != NULL) ? builtin->args : NULL;
+ }
+
+ int Recipe_DecodeArgs(RecipeID_t id, const UniversalCommand_t* cmd, int32_t out_args[RECIPE_MAX_ARGS])
+ {
+     memset(out_args, 0, RECIPE_MAX_ARGS * sizeof(int32_t));
+     const RecipeArgLayout_t* layout = Recipe_GetArgLayout(id);
+     if (layout == NULL) {
+         return -1;
+     }
+
+     const bool has_binary = (cmd->args_type == ARGS_TYPE_BINARY);
+     for (uint8_t i = 0; i < layout->count && i < RECIPE_MAX_ARGS; i++) {
+         const RecipeArgField_t* field = &layout->fields[i];
+         if (!has_binary || field->offset + field->size > cmd->args.binary.len) {
+             out_args[i] = field->default_value;
+             continue;
+         }
+         // Big-endian, как и весь протокол
+         uint32_t value = 0;
+         for (uint8_t b = 0; b < field->size; b++) {
+             value = (value << 8) | cmd->args.binary.raw[field->offset + b];
+         }
+         if ((int32_t)value < field->min_value || (int32_t)value > field->max_value) {
+             return i;
+         }
+         out_args[i] = (int32_t)value;
+     }
+     return -1;
+ }
+
+ /**
+  * @brief Проверяет, что устройство действия существует при любом допустимом
+  *        значении аргумента привязки. Моторы и насосы в ресурсах заявлять не нужно:
+  *        задание захватывает их по самим действиям (как у встроенных рецептов).
+  */
+ static bool Recipe_ValidateDevice(const RecipeInstr_t* instr, const RecipeArgLayout_t* args, const char** out_reason)
+ {
+     int32_t first = 1, last = 1; // Экземпляр модуля: без привязки - только первый
+     if (RECIPE_BIND_ARG(instr->dev_bind) != 0) {
+         const RecipeArgField_t* field = &args->fields[RECIPE_BIND_ARG(instr->dev_bind) - 1];
+         first = field->min_value;
+         last = field->max_value;
+         if (first < 1 || last > RES_MOTOR_COUNT) {
+             *out_reason = "device argument range";
+             return false;
+         }
+     }
+
+     const bool is_motor = (instr->op == RECIPE_OP_ROTATE_MOTOR || instr->op == RECIPE_OP_HOME_MOTOR);
+     const int32_t device_count = is_motor ? RES_MOTOR_COUNT : RES_PUMP_COUNT;
+     const int32_t stride = RECIPE_BIND_STRIDE(instr->dev_bind);
+     if (instr->device + (first - 1) * stride < 1 || instr->device + (last - 1) * stride > device_count) {
+         *out_reason = "device out of range";
+         return false;
+     }
+     return true;
+ }
+
+ /**
+  * @brief Область инструкции pc: адрес LOOP самого вложенного цикла, в теле которого
+  *        она стоит (RECIPE_PC_NONE - вне циклов). LOOP относится к внешней области,
+  *        END_LOOP - к телу своего цикла. *out_in_par - инструкция внутри блока PAR
+  *        (после PAR_BEGIN, включая PAR_END).
+  */
+ static uint8_t Recipe_Scope(const RecipeInstr_t* code, uint8_t pc, bool* out_in_par)
+ {
+     uint8_t loops[RECIPE_MAX_LOOP_DEPTH + 1];
+     uint8_t depth = 0;
+     bool in_par = false;
+     for (uint8_t i = 0; i < pc; i++) {
+         switch (code[i].op) {
+             case RECIPE_OP_LOOP:
+                 if (depth <= RECIPE_MAX_LOOP_DEPTH) { // Глубже - отказ по самому LOOP
+                     loops[depth++] = i;
+                 }
+                 break;
+             case RECIPE_OP_END_LOOP:
+                 if (depth > 0) {
+                     depth--;
+                 }
+                 break;
+             case RECIPE_OP_PAR_BEGIN:
+                 in_par = true;
+                 break;
+             case RECIPE_OP_PAR_END:
+                 in_par = false;
+                 break;
+             default:
+                 break;
+         }
+     }
+     *out_in_par = in_par;
+     return (depth == 0) ? RECIPE_PC_NONE : loops[depth - 1];
+ }
+
+ int Recipe_Validate(const RecipeInstr_t* code, uint8_t length, const RecipeArgLayout_t* args, const char** out_reason)
+ {
+     if (length == 0 || (code[length - 1].op != RECIPE_OP_END && code[length - 1].op != RECIPE_OP_JUMP)) {
+         *out_reason = "program must end with END or JUMP";
+         return length;
+     }
+     if (args->count > RECIPE_MAX_ARGS) {
+         *out_reason = "too many arguments";
+         return length;
+     }
+     for (uint8_t i = 0; i < args->count; i++) {
+         const RecipeArgField_t* field = &args->fields[i];
+         if ((field->size != 1 && field->size != 2 && field->size != 4) ||
+             field->offset + field->size > MAX_BINARY_ARGS_SIZE ||
+             field->min_value > field->default_value || field->default_value > field->max_value) {
+             *out_reason = "bad argument layout";
+             return length;
+         }
+     }
 
-        // --- [ADD_NEW_COMMAND] ---
-        // 4. Добавьте `case` для вашего нового рецепта здесь
-        // case RECIPE_WASH_CUVETTE:
-        //     return g_recipe_wash_cuvette;
+     uint8_t loop_depth = 0;
+     for (uint8_t pc = 0; pc < length; pc++) {
+         const RecipeInstr_t* instr = &code[pc];
+         if (RECIPE_BIND_ARG(instr->dev_bind) > args->count || instr->val_bind > args->count) {
+             *out_reason = "binding to undeclared argument";
+             return pc;
+         }
+
+         switch (instr->op) {
+             case RECIPE_OP_ROTATE_MOTOR:
+             case RECIPE_OP_HOME_MOTOR:
+                 if (MOTION_PROFILE_IS_REF(instr->speed) && MotionProfile_Get(MOTION_PROFILE_INDEX(instr->speed)) == NULL) {
+                     *out_reason = "unknown motion profile";
+                     return pc;
+                 }
+                 // fall through
+             case RECIPE_OP_START_PUMP:
+             case RECIPE_OP_STOP_PUMP:
+                 if (!Recipe_ValidateDevice(instr, args, out_reason)) {
+                     return pc;
+                 }
+                 break;
+             case RECIPE_OP_WAIT_MS:
+             case RECIPE_OP_END:
+                 break;
+             case RECIPE_OP_PAR_BEGIN: {
+                 uint8_t num_actions = 0;
+                 while (pc + 1 + num_actions < length && RECIPE_OP_IS_ACTION(code[pc + 1 + num_actions].op)) {
+                     num_actions++;
+                 }
+                 if (num_actions == 0 || num_actions > APP_MAX_STEP_ACTIONS ||
+                     pc + 1 + num_actions >= length || code[pc + 1 + num_actions].op != RECIPE_OP_PAR_END) {
+                     *out_reason = "bad parallel block";
+                     return pc;
+                 }
+                 if (((uint32_t)instr->value >> RECIPE_DEPS_BITS(num_actions)) != 0) {
+                     *out_reason = "dependency on action outside block";
+                     return pc;
+                 }
+                 break; // Действия блока проверяются следующими итерациями
+             }
+             case RECIPE_OP_PAR_END:
+                 if (pc == 0 || !(RECIPE_OP_IS_ACTION(code[pc - 1].op))) {
+                     *out_reason = "PAR_END without PAR_BEGIN";
+                     return pc;
+                 }
+                 break;
+             case RECIPE_OP_LOOP:
+                 if (++loop_depth > RECIPE_MAX_LOOP_DEPTH) {
+                     *out_reason = "loops nested too deep";
+                     return pc;
+                 }
+                 break;
+             case RECIPE_OP_END_LOOP:
+                 if (loop_depth-- == 0) {
+                     *out_reason = "END_LOOP without LOOP";
+                     return pc;
+                 }
+                 break;
+             case RECIPE_OP_JUMP_UNLESS_ARG:
+                 if (instr->val_bind == 0) {
+                     *out_reason = "condition without argument";
+                     return pc;
+                 }
+                 // fall through
+             case RECIPE_OP_JUMP:
+             case RECIPE_OP_BRANCH_IF_FAIL: {
+                 if (instr->value < 0 || instr->value >= length) {
+                     *out_reason = "jump target out of program";
+                     return pc;
+                 }
+                 // Интерпретатор не входит в блок PAR с середины, а счетчики циклов (loop_depth)
+                 // меняют только LOOP и END_LOOP: переход должен остаться в теле того же цикла
+                 bool source_in_par = false, target_in_par = false;
+                 const uint8_t source_loop = Recipe_Scope(code, pc, &source_in_par);
+                 const uint8_t target_loop = Recipe_Scope(code, (uint8_t)instr->value, &target_in_par);
+                 if (target_in_par) {
+                     *out_reason = "jump into parallel block";
+                     return pc;
+                 }
+                 if (target_loop != source_loop) {
+                     *out_reason = "jump into or out of loop body";
+                     return pc;
+                 }
+                 break;
+             }
+             default:
+                 *out_reason = "unknown opcode";
+                 return pc;
+         }
+     }
+     if (loop_depth != 0) {
+         *out_reason = "LOOP without END_LOOP";
+         return length;
+     }
+     return -1;
+ }
 
-        default:
-             return NULL;
+ RecipeID_t Recipe_ValidateBuiltins(int* out_pc, const char** out_reason)
+ {
+     static const RecipeArgLayout_t no_args = { .count = 0 };
+     for (uint8_t id = RECIPE_NONE + 1; id < RECIPE_MAX_ID; id++) {
+         const RecipeBuiltin_t* builtin = Recipe_FindBuiltin((RecipeID_t)id);
+         if (builtin == NULL) {
+             continue;
+         }
+         *out_pc = Recipe_Validate(builtin->code, builtin->length,
+                                   (builtin->args != NULL) ? builtin->args : &no_args, out_reason);
+         if (*out_pc >= 0) {
+             return (RecipeID_t)id;
+         }
      }
+     return RECIPE_NONE;
  }
@@ -11,6 +11,8 @@
 #include "shared_resources.h"   // Для extern объявлений очередей
 #include "can_message.h"        // Для нашей структуры CanMessage_t
 #include "command_protocol.h"   // Для перечисления CommandID_t
+#include "can_packer.h"         // Для CAN_Message_t и упаковщиков
+#include <string.h>             // Для memcpy
 
 // --- Внешние переменные ---
 // Объявлены в main.c, здесь мы сообщаем компилятору, что будем их использовать.
@@ -38,21 +40,11 @@ void app_start_task_can_handler(void *argument)
 	{
 		osDelay(1000);
 
-		CanMessage_t test_msg;
+		CAN_Message_t test_msg;
 
-		// --- Заполняем заголовок (Header) ---
-		test_msg.Header.IdType = FDCAN_STANDARD_ID;
-		// Формируем ID: 0x100 | ID исполнителя=2 | ID датчика=0
-		test_msg.Header.Identifier = 0x100 | (2 << 4) | 0;
-		test_msg.Header.TxFrameType = FDCAN_DATA_FRAME;
-		test_msg.Header.DataLength = FDCAN_DLC_BYTES_5; // 1 байт команда + 4 байта payload (индекс датчика)
-		// --- Заполняем данные (Data) ---
-		test_msg.Data[0] = CMD_GET_TEMPERATURE;
-		// В payload передаем индекс датчика, который нас интересует (в данном случае, датчик 0)
-		test_msg.Data[1] = 0; // Индекс 0
-		test_msg.Data[2] = 0;
-		test_msg.Data[3] = 0;
-		test_msg.Data[4] = 0;
+		// ID: 0x100 | ID исполнителя=2 | 0, Data[0] = CMD_GET_TEMPERATURE,
+		// в payload передаем индекс датчика, который нас интересует (в данном случае, датчик 0)
+		Packer_CreateGetTemperatureMsg(0, CAN_JOB_TAG_NONE, 0, &test_msg);
 		// --- Отправляем сообщение в очередь ---
 		if (can_tx_queue_handle != NULL)
 			{
@@ -163,14 +155,29 @@ void app_start_task_can_handler(void *argument)
 	// --- 3. Основной цикл задачи ---
 	// Этот цикл будет вечно работать, обрабатывая исходящие CAN-сообщения.
 
-	CanMessage_t tx_msg; // Переменная для хранения сообщения, извлеченного из очереди.
+	CAN_Message_t queued_msg; // Сообщение, извлеченное из очереди (формат can_packer.h)
+	CanMessage_t tx_msg;      // То же сообщение с заголовком HAL
+
+	// Неизменяемые поля заголовка Classic CAN
+	tx_msg.Header.IdType = FDCAN_STANDARD_ID;
+	tx_msg.Header.TxFrameType = FDCAN_DATA_FRAME;
+	tx_msg.Header.ErrorStateIndicator = FDCAN_ESI_ACTIVE;
+	tx_msg.Header.BitRateSwitch = FDCAN_BRS_OFF;
+	tx_msg.Header.FDFormat = FDCAN_CLASSIC_CAN;
+	tx_msg.Header.TxEventFifoControl = FDCAN_NO_TX_EVENTS;
+	tx_msg.Header.MessageMarker = 0;
 
 	for(;;)
 		{
 		// Ждем, пока в очереди can_tx_queue_handle не появится сообщение.
 		// portMAX_DELAY заставляет задачу "спать", пока очередь пуста, не тратя ресурсы процессора.
-		if(xQueueReceive(can_tx_queue_handle, &tx_msg, portMAX_DELAY) == pdPASS)
+		if(xQueueReceive(can_tx_queue_handle, &queued_msg, portMAX_DELAY) == pdPASS)
 			{
+			tx_msg.Header.Identifier = queued_msg.id;
+			// Для Classic CAN значения FDCAN_DLC_BYTES_0..8 совпадают с количеством байт
+			tx_msg.Header.DataLength = (queued_msg.dlc <= 8) ? queued_msg.dlc : FDCAN_DLC_BYTES_8;
+			memcpy(tx_msg.Data, queued_msg.data, sizeof(tx_msg.Data));
+
 			// Как только мы получили сообщение из очереди, отправляем его в шину.
 			// HAL_FDCAN_AddMessageToTxFifoQ - стандартная функция HAL для постановки кадра в очередь на отправку.
 			if (HAL_FDCAN_AddMessageToTxFifoQ(&hfdcan1, &tx_msg.Header, tx_msg.Data) != HAL_OK)
@@ -7,12 +7,19 @@
 
 #include"task_dispatcher.h"
 #include "cmsis_os.h"
+#include "task.h"
+#include "semphr.h"
 #include "shared_resources.h"
 #include "app_config.h"
 #include "app_init_checker.h"
 #include "Dispatcher/command_parser.h"
 #include "Dispatcher/dispatcher_io.h"
 #include "Dispatcher/job_manager.h"
+#include "Dispatcher/job_inbox.h"
+#include "Dispatcher/recipe_flash.h"
+#include "Dispatcher/recipe_store.h"
+#include "Dispatcher/cycle_scheduler.h"
+#include <stdio.h>
 
 /**
  * @brief GLOBAL SYSTEM STATE */
@@ -21,6 +28,12 @@
 
 static SystemState_t g_system_state = SYS_STATE_POWER_ON;
 
+// Пробуждение задачи: байты USB и входящие события заданий (Dispatcher_Wakeup).
+// Не уведомление задачи: xStreamBufferReceive с ожиданием сбрасывает уведомления
+// перед блокировкой, и событие, пришедшее после JobInbox_Process, терялось бы.
+static StaticSemaphore_t g_wakeup_buffer;
+static SemaphoreHandle_t g_wakeup = NULL;
+
 void app_start_task_dispatcher(void *argument)
 {
 	// Буфер для сборки одного полного пакета команды
@@ -40,35 +53,64 @@ void app_start_task_dispatcher(void *argument)
 
 		ParserState_t parser_state = PARSER_STATE_WAIT_HEADER_1;
 
+		g_wakeup = xSemaphoreCreateBinaryStatic(&g_wakeup_buffer);
+
 		// --- Логика инициализации системы остается без изменений ---
 		if (g_system_state == SYS_STATE_POWER_ON)
 			{
 			g_system_state = SYS_STATE_INITIALIZING;
 			Dispatcher_SendUsbResponse("INFO: System starting. Initializing hardware...");
-			// Создаем универсальную команду для инициализации
-			UniversalCommand_t init_cmd;
-			init_cmd.recipe_id = RECIPE_INITIALIZE_SYSTEM;
-			init_cmd.args_type = ARGS_TYPE_NONE; // Инициализация не требует аргументов
-
-			uint32_t init_job_id = JobManager_StartNewJob(&init_cmd);
-
-			if (init_job_id == 0) {
-				Dispatcher_SendUsbResponse("CRITICAL ERROR: Failed to start system initialization job!");
+			RecipeFlash_Init(); // Каталог загруженных рецептов - до первого задания
+			JobManager_Init();
+			CycleScheduler_Init();
+
+			// Программы встроенных рецептов - до первого задания: ошибка в них - ошибка прошивки
+			int bad_pc = -1;
+			const char* reason = "";
+			const RecipeID_t bad_recipe = Recipe_ValidateBuiltins(&bad_pc, &reason);
+			if (bad_recipe != RECIPE_NONE) {
+				char msg[APP_USB_RESP_MAX_LEN];
+				snprintf(msg, sizeof(msg), "CRITICAL ERROR: Built-in recipe %d: %s at pc %d!", (int)bad_recipe, reason, bad_pc);
+				Dispatcher_SendUsbResponse(msg);
 				g_system_state = SYS_STATE_ERROR;
 				}
+			else {
+				// Создаем универсальную команду для инициализации
+				UniversalCommand_t init_cmd;
+				init_cmd.command_code = 0x1002; // DONE уходит как ответ на INIT
+				init_cmd.recipe_id = RECIPE_INITIALIZE_SYSTEM;
+				init_cmd.priority = JOB_PRIORITY_STAT;
+				init_cmd.args_type = ARGS_TYPE_NONE; // Инициализация не требует аргументов
+
+				uint32_t init_job_id = JobManager_StartNewJob(&init_cmd);
+
+				if (init_job_id == 0) {
+					Dispatcher_SendUsbResponse("CRITICAL ERROR: Failed to start system initialization job!");
+					g_system_state = SYS_STATE_ERROR;
+					}
+				}
 			osDelay(100);
 			}
 
 	// --- НОВЫЙ ГЛАВНЫЙ ЦИКЛ ЗАДАЧИ ---
 	for(;;)
 		{
-		// Пытаемся прочитать 1 байт из буфера потока.
-		// Блокируемся на время portMAX_DELAY, если данных нет.
+		// Задача - единственный владелец состояния заданий: ответы исполнителей
+		// и сроки таймеров из других задач обрабатываются здесь (см. job_inbox.h)
+		JobInbox_Process();
+
+		// Читаем 1 байт из буфера потока без ожидания. Если данных нет - спим на
+		// семафоре пробуждения: его отдают и прием USB, и события заданий. Семафор
+		// запоминает пробуждение, пришедшее между проверкой и блокировкой.
 		uint8_t current_byte;
 		size_t bytes_read = xStreamBufferReceive(usb_rx_stream_buffer_handle,
-				(void*)&current_byte, 1, portMAX_DELAY);
+				(void*)&current_byte, 1, 0);
 
-		if (bytes_read > 0)
+		if (bytes_read == 0)
+			{
+				xSemaphoreTake(g_wakeup, portMAX_DELAY);
+			}
+		else
 			{
 				switch (parser_state)
 				{
@@ -80,7 +122,7 @@ void app_start_task_dispatcher(void *argument)
 						break;
 
 					case PARSER_STATE_WAIT_HEADER_2:
-						if (current_byte == 0x4D) { // 'M'
+						if (current_byte == 0x4D || current_byte == 0x53) { // 'M' или 'S' - команда с номером (host_seq.h)
 							packet_buffer[1] = current_byte;
 							parser_state = PARSER_STATE_WAIT_HEADER_3;
 							}
@@ -144,6 +186,22 @@ void app_start_task_dispatcher(void *argument)
 }
 
 
+void Dispatcher_Wakeup(void)
+{
+	if (g_wakeup == NULL) {
+		return; // События дождутся первого прохода главного цикла
+		}
+	if (xPortIsInsideInterrupt()) {
+		BaseType_t higher_priority_task_woken = pdFALSE;
+		xSemaphoreGiveFromISR(g_wakeup, &higher_priority_task_woken);
+		portYIELD_FROM_ISR(higher_priority_task_woken);
+		}
+	else {
+		xSemaphoreGive(g_wakeup);
+		}
+}
+
+
 // Эта функция будет вызываться из JobManager'а, когда инициализация завершена.
 // Для этого нам понадобится механизм межзадачного взаимодействия (например, Event Group).
 void SetSystemReady(void)
@@ -7,26 +7,51 @@
 
 #include "task_jobs_monitor.h"
 #include "cmsis_os.h"
+#include "FreeRTOS.h"
+#include "task.h"
 #include "Dispatcher/job_manager.h"
+#include "Dispatcher/job_inbox.h"
 
-#define JOBS_MONITOR_PERIOD_MS 100
-
+// Хэндл задачи монитора для уведомлений (xTaskNotifyGive)
+static TaskHandle_t g_jobs_monitor_task = NULL;
+// Ближайший срок, заданный владельцем заданий (JobsMonitor_Arm)
+static volatile uint32_t g_next_deadline_ms = JOB_MANAGER_NO_DEADLINE;
 
 /**
 * @brief Основная логика задачи монитора заданий.
-*        Эта задача периодически просыпается и вызывает JobManager_Run()
-*        для проверки таймаутов и обработки внутренних шагов рецептов.
+*        Задача спит до ближайшего срока таймеров JobManager'а (окончание
+*        ACTION_WAIT_MS, тайм-аут шага, слот машинного цикла) и сообщает
+*        задаче диспетчера, что срок наступил. Сами таймеры обрабатывает
+*        диспетчер - владелец состояния заданий (см. job_inbox.h) - и после
+*        этого взводит монитор на следующий срок.
+*        Когда активных заданий нет, задача не просыпается совсем.
 */
 
 void app_start_task_jobs_monitor(void *argument)
 {
+  g_jobs_monitor_task = xTaskGetCurrentTaskHandle();
+  TickType_t wait_ticks = portMAX_DELAY;
+  xTaskNotifyGive(g_jobs_monitor_task); // Срок мог быть задан до старта задачи
 
   for(;;)
   {
-	  JobManager_Run();
-	  // "Засыпаем" на заданный период
-	  osDelay(JOBS_MONITOR_PERIOD_MS);
+	  if (ulTaskNotifyTake(pdTRUE, wait_ticks) == 0) {
+		  // Срок наступил: ждем, пока диспетчер обработает таймеры и взведет монитор снова
+		  JobInbox_PostTimer();
+		  wait_ticks = portMAX_DELAY;
+	  }
+	  else {
+		  uint32_t next_deadline_ms = g_next_deadline_ms;
+		  wait_ticks = (next_deadline_ms == JOB_MANAGER_NO_DEADLINE) ? portMAX_DELAY : pdMS_TO_TICKS(next_deadline_ms);
+	  }
   }
 
 }
 
+void JobsMonitor_Arm(uint32_t next_deadline_ms)
+{
+	g_next_deadline_ms = next_deadline_ms;
+	if (g_jobs_monitor_task != NULL) {
+		xTaskNotifyGive(g_jobs_monitor_task);
+	}
+}
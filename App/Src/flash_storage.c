@@ -0,0 +1,51 @@
+/*
+ * flash_storage.c
+ *
+ *  Created on: Feb 9, 2026
+ *      Author: andrey
+ */
+
+#include "flash_storage.h"
+#include "app_config.h"
+#include "main.h" // HAL Flash
+
+// Секторы STM32H723 (один банк Flash, 8 секторов по 128 КБ с адреса 0x08000000)
+#define FLASH_STORAGE_SECTOR(bank)   (APP_RECIPE_FLASH_FIRST_SECTOR + (bank))
+#define FLASH_STORAGE_ADDR(bank)     (FLASH_BASE + FLASH_STORAGE_SECTOR(bank) * FLASH_STORAGE_BANK_SIZE)
+
+#if APP_RECIPE_FLASH_FIRST_SECTOR + FLASH_STORAGE_BANK_COUNT > 8
+#error "Хранилище рецептов выходит за пределы Flash STM32H723"
+#endif
+
+_Static_assert(FLASH_STORAGE_BANK_SIZE == FLASH_SECTOR_SIZE, "Банк хранилища - ровно один сектор Flash");
+_Static_assert(FLASH_STORAGE_WORD_SIZE == FLASH_NB_32BITWORD_IN_FLASHWORD * 4, "Размер Flash-слова STM32H7");
+
+const uint8_t* FlashStorage_GetBank(uint8_t bank)
+{
+	return (const uint8_t*)FLASH_STORAGE_ADDR(bank);
+}
+
+bool FlashStorage_EraseBank(uint8_t bank)
+{
+	FLASH_EraseInitTypeDef erase = {
+		.TypeErase = FLASH_TYPEERASE_SECTORS,
+		.Banks = FLASH_BANK_1,
+		.Sector = FLASH_STORAGE_SECTOR(bank),
+		.NbSectors = 1,
+		.VoltageRange = FLASH_VOLTAGE_RANGE_3,
+	};
+	uint32_t sector_error = 0;
+
+	HAL_FLASH_Unlock();
+	HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &sector_error);
+	HAL_FLASH_Lock();
+	return status == HAL_OK;
+}
+
+bool FlashStorage_ProgramWord(uint8_t bank, uint32_t offset, const uint32_t* data)
+{
+	HAL_FLASH_Unlock();
+	HAL_StatusTypeDef status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, FLASH_STORAGE_ADDR(bank) + offset, (uint32_t)data);
+	HAL_FLASH_Lock();
+	return status == HAL_OK;
+}
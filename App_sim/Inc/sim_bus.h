@@ -0,0 +1,54 @@
+/*
+ * sim_bus.h
+ *
+ * Симулятор шины CAN: кадры передаются по одному, при одновременной
+ * готовности нескольких кадров шину выигрывает кадр с меньшим ID
+ * (арбитраж Classic CAN).
+ */
+
+#ifndef SIM_BUS_H_
+#define SIM_BUS_H_
+
+#include <stdint.h>
+#include "can_packer.h"
+
+#define SIM_BUS_MAX_PENDING     256
+
+typedef struct {
+	uint32_t frames_sent;       // Всего переданных кадров
+	uint32_t frames_dropped;    // Кадры, не поместившиеся в буфер ожидания
+	uint32_t arbitration_lost;  // Сколько раз готовый кадр проиграл арбитраж
+	uint64_t busy_us;           // Суммарное время занятости шины
+} SimBusStats_t;
+
+/**
+ * @brief Получатель кадров, переданных по шине.
+ */
+typedef void (*SimBusReceiver_t)(const CAN_Message_t* msg);
+
+/**
+ * @brief Инициализирует шину.
+ * @param bitrate Скорость шины, бит/с.
+ * @param on_command Получатель кадров команд (исполнители).
+ * @param on_response Получатель кадров ответов (Дирижер).
+ */
+void SimBus_Init(uint32_t bitrate, SimBusReceiver_t on_command, SimBusReceiver_t on_response);
+
+/**
+ * @brief Ставит кадр на передачу, начиная с момента ready_us.
+ */
+void SimBus_Submit(const CAN_Message_t* msg, uint64_t ready_us);
+
+/**
+ * @brief Время следующего события шины (конец передачи или начало новой).
+ */
+uint64_t SimBus_NextEventUs(void);
+
+/**
+ * @brief Обрабатывает события шины, наступившие к текущему моменту.
+ */
+void SimBus_Process(void);
+
+const SimBusStats_t* SimBus_GetStats(void);
+
+#endif /* SIM_BUS_H_ */
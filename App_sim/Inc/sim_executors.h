@@ -0,0 +1,86 @@
+/*
+ * sim_executors.h
+ *
+ * Модели исполнителей (моторы, насосы, термостаты) для хост-симулятора.
+ */
+
+#ifndef SIM_EXECUTORS_H_
+#define SIM_EXECUTORS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "can_packer.h"
+
+#define SIM_EXECUTOR_COUNT      3   // CAN_EXECUTOR_MOTORS, CAN_EXECUTOR_PUMPS, CAN_EXECUTOR_THERMO
+#define SIM_DEVICES_PER_EXEC    16  // device_id занимает 4 бита CAN ID
+#define SIM_COMMAND_CODES       0x20 // Коды CommandID_t, которые учитывает счетчик команд
+
+/**
+ * @brief Параметры модели одного исполнителя.
+ */
+typedef struct {
+	uint32_t base_latency_us;   // Время обработки команды исполнителем
+	uint32_t home_travel_steps; // Длина пути поиска "дома" (моторы)
+	uint32_t default_speed;     // Скорость по умолчанию, шагов/с (моторы)
+	double   fail_rate;         // Вероятность ответа с ошибкой
+	double   drop_rate;         // Вероятность потери ответа (проверка тайм-аутов)
+	double   dup_rate;          // Вероятность повторной отправки ответа
+} SimExecutorModel_t;
+
+typedef struct {
+	uint32_t commands;          // Принятые команды
+	uint32_t responses;         // Отправленные ответы
+	uint32_t injected_failures; // Ответы с ошибкой
+	uint32_t dropped_responses; // Потерянные ответы
+	uint32_t dup_responses;     // Повторно отправленные ответы
+} SimExecutorStats_t;
+
+/**
+ * @brief Инициализирует модели значениями по умолчанию.
+ */
+void SimExec_Init(uint32_t seed);
+
+/**
+ * @brief Доступ к модели исполнителя для настройки.
+ */
+SimExecutorModel_t* SimExec_GetModel(uint8_t executor_id);
+
+/**
+ * @brief Масштабирует задержки всех исполнителей (1.0 = модель по умолчанию).
+ */
+void SimExec_ScaleLatency(double scale);
+
+/**
+ * @brief Принимает кадр команды с шины.
+ */
+void SimExec_OnCommand(const CAN_Message_t* msg);
+
+/**
+ * @brief Время ближайшего завершения действия у исполнителей.
+ */
+uint64_t SimExec_NextEventUs(void);
+
+/**
+ * @brief Отправляет на шину ответы для завершившихся к текущему моменту действий.
+ */
+void SimExec_Process(void);
+
+const SimExecutorStats_t* SimExec_GetStats(uint8_t executor_id);
+
+/**
+ * @brief Сколько команд с кодом command (CommandID_t) принял исполнитель.
+ */
+uint32_t SimExec_GetCommandCount(uint8_t executor_id, uint8_t command);
+
+/**
+ * @brief Положение мотора в шагах на текущий момент: относительные перемещения
+ *        складываются, HOME возвращает в 0, остановка фиксирует пройденную часть.
+ */
+int32_t SimExec_GetMotorPosition(uint8_t motor_id);
+
+/**
+ * @brief Включен ли насос (последняя команда CMD_SET_PUMP_STATE).
+ */
+bool SimExec_IsPumpOn(uint8_t pump_id);
+
+#endif /* SIM_EXECUTORS_H_ */
@@ -0,0 +1,47 @@
+/*
+ * sim_rtos.h
+ *
+ * Виртуальное время и "очереди" FreeRTOS хост-симулятора.
+ */
+
+#ifndef SIM_RTOS_H_
+#define SIM_RTOS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIM_TIME_NEVER  UINT64_MAX
+
+/**
+ * @brief Текущее виртуальное время в микросекундах.
+ */
+uint64_t Sim_NowUs(void);
+
+/**
+ * @brief Переводит виртуальные часы вперед (назад время не идет).
+ */
+void Sim_AdvanceTo(uint64_t time_us);
+
+/**
+ * @brief Обработчик пакетов, которые диспетчер отправляет на USB.
+ */
+typedef void (*SimUsbSink_t)(const uint8_t* data, uint16_t length);
+
+/**
+ * @brief Подключает очереди диспетчера к симулятору: can_tx -> шина, usb_tx -> sink.
+ */
+void Sim_RtosInit(SimUsbSink_t usb_sink);
+
+/**
+ * @brief Вызывается из osDelay: на плате за паузу проходит время, в симуляторе - нет.
+ *        NULL (по умолчанию) - пауза ничего не делает.
+ */
+typedef void (*SimDelayHook_t)(uint32_t ticks);
+void Sim_SetDelayHook(SimDelayHook_t hook);
+
+/**
+ * @brief Состояние системы, которое на плате хранит task_dispatcher.
+ */
+bool Sim_IsSystemReady(void);
+
+#endif /* SIM_RTOS_H_ */
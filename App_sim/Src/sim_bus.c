@@ -0,0 +1,139 @@
+/*
+ * sim_bus.c
+ *
+ * Дискретно-событийная модель шины Classic CAN.
+ */
+
+#include "sim_bus.h"
+#include "sim_rtos.h"
+#include <string.h>
+
+typedef struct {
+	CAN_Message_t msg;
+	uint64_t ready_us;  // С какого момента кадр участвует в арбитраже
+	uint32_t seq;       // Порядок постановки (для кадров с одинаковым ID)
+} SimFrame_t;
+
+static SimFrame_t g_pending[SIM_BUS_MAX_PENDING];
+static uint16_t g_pending_count = 0;
+static uint32_t g_seq = 0;
+
+static bool g_in_flight = false;
+static SimFrame_t g_current;
+static uint64_t g_current_end_us = 0;
+
+static uint32_t g_bitrate = 1000000;
+static SimBusReceiver_t g_on_command = NULL;
+static SimBusReceiver_t g_on_response = NULL;
+static SimBusStats_t g_stats;
+
+// Длительность кадра Classic CAN с 11-битным ID: 47 служебных бит + данные,
+// плюс оценка bit stuffing (~20%).
+static uint64_t frame_duration_us(uint8_t dlc)
+{
+	uint32_t bits = 47 + 8u * dlc;
+	bits += bits / 5;
+	return ((uint64_t)bits * 1000000ull + g_bitrate - 1) / g_bitrate;
+}
+
+void SimBus_Init(uint32_t bitrate, SimBusReceiver_t on_command, SimBusReceiver_t on_response)
+{
+	g_bitrate = (bitrate > 0) ? bitrate : 1000000;
+	g_on_command = on_command;
+	g_on_response = on_response;
+	g_pending_count = 0;
+	g_seq = 0;
+	g_in_flight = false;
+	memset(&g_stats, 0, sizeof(g_stats));
+}
+
+void SimBus_Submit(const CAN_Message_t* msg, uint64_t ready_us)
+{
+	if (g_pending_count >= SIM_BUS_MAX_PENDING) {
+		g_stats.frames_dropped++;
+		return;
+		}
+	SimFrame_t* frame = &g_pending[g_pending_count++];
+	frame->msg = *msg;
+	frame->ready_us = ready_us;
+	frame->seq = g_seq++;
+}
+
+uint64_t SimBus_NextEventUs(void)
+{
+	if (g_in_flight) {
+		return g_current_end_us;
+		}
+	uint64_t next = SIM_TIME_NEVER;
+	for (uint16_t i = 0; i < g_pending_count; i++) {
+		if (g_pending[i].ready_us < next) {
+			next = g_pending[i].ready_us;
+			}
+		}
+	if (next != SIM_TIME_NEVER && next < Sim_NowUs()) {
+		next = Sim_NowUs();
+		}
+	return next;
+}
+
+// Выбирает победителя арбитража среди готовых кадров: меньший ID, затем порядок постановки
+static int arbitrate(uint64_t now)
+{
+	int winner = -1;
+	uint16_t ready = 0;
+	for (uint16_t i = 0; i < g_pending_count; i++) {
+		const SimFrame_t* frame = &g_pending[i];
+		if (frame->ready_us > now) {
+			continue;
+			}
+		ready++;
+		if (winner < 0 ||
+			frame->msg.id < g_pending[winner].msg.id ||
+			(frame->msg.id == g_pending[winner].msg.id && frame->seq < g_pending[winner].seq)) {
+			winner = i;
+			}
+		}
+	if (ready > 1) {
+		g_stats.arbitration_lost += ready - 1;
+		}
+	return winner;
+}
+
+void SimBus_Process(void)
+{
+	const uint64_t now = Sim_NowUs();
+
+	for (;;) {
+		if (g_in_flight) {
+			if (g_current_end_us > now) {
+				return;
+				}
+			// Передача завершена: доставляем кадр получателю
+			g_in_flight = false;
+			g_stats.frames_sent++;
+			if ((g_current.msg.id & CAN_ID_TYPE_MASK) == CAN_ID_RESPONSE_BASE) {
+				if (g_on_response != NULL) g_on_response(&g_current.msg);
+				}
+			else if (g_on_command != NULL) {
+				g_on_command(&g_current.msg);
+				}
+			continue;
+			}
+
+		int winner = arbitrate(now);
+		if (winner < 0) {
+			return;
+			}
+		g_current = g_pending[winner];
+		g_pending[winner] = g_pending[--g_pending_count];
+		uint64_t duration = frame_duration_us(g_current.msg.dlc);
+		g_current_end_us = now + duration;
+		g_stats.busy_us += duration;
+		g_in_flight = true;
+		}
+}
+
+const SimBusStats_t* SimBus_GetStats(void)
+{
+	return &g_stats;
+}
@@ -0,0 +1,283 @@
+/*
+ * sim_executors.c
+ *
+ * Модели исполнителей: время выполнения команд, занятость устройств,
+ * внесение ошибок и потерь ответов.
+ */
+
+#include "sim_executors.h"
+#include "sim_bus.h"
+#include "sim_rtos.h"
+#include "command_protocol.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define SIM_MAX_PENDING_ACTIONS     128
+#define SIM_THERMO_VALUE            370 // 37.0 °C в десятых долях градуса
+#define SIM_DUPLICATE_DELAY_US      3000 // Повтор ответа приходит позже оригинала
+
+typedef struct {
+	uint64_t done_us;       // Момент завершения действия
+	CAN_Message_t response; // Готовый кадр ответа
+} SimPendingAction_t;
+
+static SimExecutorModel_t g_models[SIM_EXECUTOR_COUNT];
+static SimExecutorStats_t g_stats[SIM_EXECUTOR_COUNT];
+
+// Состояние устройств: до какого момента занято, текущая скорость (моторы)
+static uint64_t g_device_busy_until[SIM_EXECUTOR_COUNT][SIM_DEVICES_PER_EXEC];
+static uint32_t g_device_speed[SIM_EXECUTOR_COUNT][SIM_DEVICES_PER_EXEC];
+
+// Перемещение мотора: положение меняется равномерно от from (start_us) до to (done_us).
+// Модель помнит только последнее движение мотора - задания двигают мотор по одному шагу.
+typedef struct {
+	uint64_t start_us;
+	uint64_t done_us;
+	int32_t from;
+	int32_t to;
+} SimMotion_t;
+
+static SimMotion_t g_motion[SIM_DEVICES_PER_EXEC];
+static bool g_pump_on[SIM_DEVICES_PER_EXEC];
+static uint32_t g_command_counts[SIM_EXECUTOR_COUNT][SIM_COMMAND_CODES];
+
+static SimPendingAction_t g_pending[SIM_MAX_PENDING_ACTIONS];
+static uint16_t g_pending_count = 0;
+
+static uint32_t g_rng_state = 1;
+
+// xorshift32: воспроизводимая последовательность для заданного seed
+static double rng_uniform(void)
+{
+	uint32_t x = g_rng_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	g_rng_state = x;
+	return (double)x / 4294967296.0;
+}
+
+void SimExec_Init(uint32_t seed)
+{
+	memset(g_models, 0, sizeof(g_models));
+	memset(g_stats, 0, sizeof(g_stats));
+	memset(g_device_busy_until, 0, sizeof(g_device_busy_until));
+	memset(g_motion, 0, sizeof(g_motion));
+	memset(g_pump_on, 0, sizeof(g_pump_on));
+	memset(g_command_counts, 0, sizeof(g_command_counts));
+	g_pending_count = 0;
+	g_rng_state = (seed != 0) ? seed : 1;
+
+	g_models[CAN_EXECUTOR_MOTORS].base_latency_us = 2000;
+	g_models[CAN_EXECUTOR_MOTORS].home_travel_steps = 400;
+	g_models[CAN_EXECUTOR_MOTORS].default_speed = 1000;
+
+	g_models[CAN_EXECUTOR_PUMPS].base_latency_us = 5000;
+
+	g_models[CAN_EXECUTOR_THERMO].base_latency_us = 10000;
+
+	for (int e = 0; e < SIM_EXECUTOR_COUNT; e++) {
+		for (int d = 0; d < SIM_DEVICES_PER_EXEC; d++) {
+			g_device_speed[e][d] = g_models[CAN_EXECUTOR_MOTORS].default_speed;
+			}
+		}
+}
+
+SimExecutorModel_t* SimExec_GetModel(uint8_t executor_id)
+{
+	return (executor_id < SIM_EXECUTOR_COUNT) ? &g_models[executor_id] : NULL;
+}
+
+void SimExec_ScaleLatency(double scale)
+{
+	for (int e = 0; e < SIM_EXECUTOR_COUNT; e++) {
+		g_models[e].base_latency_us = (uint32_t)(g_models[e].base_latency_us * scale);
+		}
+	// Время движения масштабируется через длину пути поиска "дома" и скорость
+	g_models[CAN_EXECUTOR_MOTORS].home_travel_steps =
+		(uint32_t)(g_models[CAN_EXECUTOR_MOTORS].home_travel_steps * scale);
+}
+
+// Время выполнения команды устройством (без учета очереди к устройству)
+static uint64_t action_duration_us(uint8_t executor_id, uint8_t device_id, uint8_t command, int32_t payload)
+{
+	const SimExecutorModel_t* model = &g_models[executor_id];
+	uint64_t duration = model->base_latency_us;
+
+	if (executor_id == CAN_EXECUTOR_MOTORS) {
+		uint32_t speed = g_device_speed[executor_id][device_id];
+		if (speed == 0) speed = 1;
+		if (command == CMD_MOVE_RELATIVE) {
+			uint64_t steps = (payload < 0) ? (uint64_t)(-(int64_t)payload) : (uint64_t)payload;
+			duration += steps * 1000000ull / speed;
+			}
+		else if (command == CMD_HOME) {
+			duration += (uint64_t)model->home_travel_steps * 1000000ull / speed;
+			}
+		}
+	return duration;
+}
+
+static int32_t motor_position(uint8_t device_id, uint64_t now)
+{
+	const SimMotion_t* motion = &g_motion[device_id];
+	if (now >= motion->done_us) {
+		return motion->to;
+		}
+	if (now <= motion->start_us) {
+		return motion->from;
+		}
+	return motion->from + (int32_t)((int64_t)(motion->to - motion->from) * (int64_t)(now - motion->start_us) /
+	                                (int64_t)(motion->done_us - motion->start_us));
+}
+
+void SimExec_OnCommand(const CAN_Message_t* msg)
+{
+	uint8_t executor_id = (uint8_t)((msg->id >> 4) & 0x0F);
+	uint8_t device_id = (uint8_t)(msg->id & 0x0F);
+	if (executor_id >= SIM_EXECUTOR_COUNT) {
+		return; // На шине нет такого исполнителя
+		}
+
+	const SimExecutorModel_t* model = &g_models[executor_id];
+	uint8_t command = msg->data[0];
+	int32_t payload = (int32_t)((uint32_t)msg->data[1] | ((uint32_t)msg->data[2] << 8) |
+	                            ((uint32_t)msg->data[3] << 16) | ((uint32_t)msg->data[4] << 24));
+	uint16_t job_tag = (uint16_t)(msg->data[5] | (msg->data[6] << 8));
+
+	g_stats[executor_id].commands++;
+	if (command < SIM_COMMAND_CODES) {
+		g_command_counts[executor_id][command]++;
+		}
+
+	// Команды настройки применяются сразу и не требуют ответа
+	if (command == CMD_SET_SPEED) {
+		g_device_speed[executor_id][device_id] = (uint32_t)payload;
+		return;
+		}
+	if (command == CMD_SET_ACCELERATION || command == CMD_SET_CURRENT) {
+		return; // Время движения модель считает по скорости
+		}
+
+	// Остановка прерывает движение: ответа на прерванную команду не будет
+	if (command == CMD_STOP) {
+		g_device_busy_until[executor_id][device_id] = Sim_NowUs();
+		if (executor_id == CAN_EXECUTOR_MOTORS) {
+			const int32_t position = motor_position(device_id, Sim_NowUs());
+			g_motion[device_id] = (SimMotion_t){ Sim_NowUs(), Sim_NowUs(), position, position };
+			}
+		const uint32_t device_response_id = CAN_ID_RESPONSE_BASE | ((uint32_t)executor_id << 4) | device_id;
+		uint16_t i = 0;
+		while (i < g_pending_count) {
+			if (g_pending[i].response.id == device_response_id) {
+				g_pending[i] = g_pending[--g_pending_count];
+				}
+			else {
+				i++;
+				}
+			}
+		return;
+		}
+
+	// Устройство выполняет команды по очереди
+	uint64_t start = Sim_NowUs();
+	if (g_device_busy_until[executor_id][device_id] > start) {
+		start = g_device_busy_until[executor_id][device_id];
+		}
+	uint64_t done = start + action_duration_us(executor_id, device_id, command, payload);
+	g_device_busy_until[executor_id][device_id] = done;
+
+	if (executor_id == CAN_EXECUTOR_MOTORS && (command == CMD_MOVE_RELATIVE || command == CMD_MOVE_ABSOLUTE || command == CMD_HOME)) {
+		const int32_t from = g_motion[device_id].to;
+		const int32_t to = (command == CMD_MOVE_RELATIVE) ? from + payload : (command == CMD_MOVE_ABSOLUTE) ? payload : 0;
+		g_motion[device_id] = (SimMotion_t){ start, done, from, to };
+		}
+	else if (executor_id == CAN_EXECUTOR_PUMPS && command == CMD_SET_PUMP_STATE) {
+		g_pump_on[device_id] = (payload != 0);
+		}
+
+	if (job_tag == CAN_JOB_TAG_NONE) {
+		return;
+		}
+	if (model->drop_rate > 0.0 && rng_uniform() < model->drop_rate) {
+		g_stats[executor_id].dropped_responses++;
+		return;
+		}
+	if (g_pending_count >= SIM_MAX_PENDING_ACTIONS) {
+		g_stats[executor_id].dropped_responses++;
+		return;
+		}
+
+	SimPendingAction_t* action = &g_pending[g_pending_count++];
+	action->done_us = done;
+	memset(&action->response, 0, sizeof(action->response));
+	action->response.id = CAN_ID_RESPONSE_BASE | ((uint32_t)executor_id << 4) | device_id;
+	action->response.dlc = 8;
+	action->response.data[0] = command;
+	if (model->fail_rate > 0.0 && rng_uniform() < model->fail_rate) {
+		action->response.data[1] = 0x01; // Ошибка исполнителя
+		g_stats[executor_id].injected_failures++;
+		}
+	else if (command == CMD_GET_TEMPERATURE) {
+		action->response.data[2] = (uint8_t)(SIM_THERMO_VALUE & 0xFF);
+		action->response.data[3] = (uint8_t)(SIM_THERMO_VALUE >> 8);
+		}
+	action->response.data[5] = msg->data[5];
+	action->response.data[6] = msg->data[6];
+	action->response.data[7] = msg->data[7];
+
+	if (model->dup_rate > 0.0 && rng_uniform() < model->dup_rate && g_pending_count < SIM_MAX_PENDING_ACTIONS) {
+		SimPendingAction_t* dup = &g_pending[g_pending_count++];
+		*dup = *action;
+		dup->done_us += SIM_DUPLICATE_DELAY_US;
+		g_stats[executor_id].dup_responses++;
+		}
+}
+
+uint64_t SimExec_NextEventUs(void)
+{
+	uint64_t next = SIM_TIME_NEVER;
+	for (uint16_t i = 0; i < g_pending_count; i++) {
+		if (g_pending[i].done_us < next) {
+			next = g_pending[i].done_us;
+			}
+		}
+	return next;
+}
+
+void SimExec_Process(void)
+{
+	const uint64_t now = Sim_NowUs();
+	uint16_t i = 0;
+	while (i < g_pending_count) {
+		if (g_pending[i].done_us <= now) {
+			uint8_t executor_id = (uint8_t)((g_pending[i].response.id >> 4) & 0x0F);
+			g_stats[executor_id].responses++;
+			SimBus_Submit(&g_pending[i].response, now);
+			g_pending[i] = g_pending[--g_pending_count];
+			}
+		else {
+			i++;
+			}
+		}
+}
+
+const SimExecutorStats_t* SimExec_GetStats(uint8_t executor_id)
+{
+	return (executor_id < SIM_EXECUTOR_COUNT) ? &g_stats[executor_id] : NULL;
+}
+
+uint32_t SimExec_GetCommandCount(uint8_t executor_id, uint8_t command)
+{
+	return (executor_id < SIM_EXECUTOR_COUNT && command < SIM_COMMAND_CODES) ? g_command_counts[executor_id][command] : 0;
+}
+
+int32_t SimExec_GetMotorPosition(uint8_t motor_id)
+{
+	return (motor_id < SIM_DEVICES_PER_EXEC) ? motor_position(motor_id, Sim_NowUs()) : 0;
+}
+
+bool SimExec_IsPumpOn(uint8_t pump_id)
+{
+	return (pump_id < SIM_DEVICES_PER_EXEC) && g_pump_on[pump_id];
+}
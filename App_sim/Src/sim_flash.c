@@ -0,0 +1,56 @@
+/*
+ * sim_flash.c
+ *
+ * Модель секторов Flash под хранилище рецептов (flash_storage.h): массив в RAM
+ * с правилами STM32H7 - стирание сектора целиком и однократная запись Flash-слова.
+ */
+
+#include "flash_storage.h"
+#include <stdio.h>
+#include <string.h>
+
+static uint8_t g_banks[FLASH_STORAGE_BANK_COUNT][FLASH_STORAGE_BANK_SIZE] __attribute__((aligned(FLASH_STORAGE_WORD_SIZE)));
+static bool g_initialized = false;
+
+static void sim_flash_init(void)
+{
+	if (!g_initialized) {
+		memset(g_banks, 0xFF, sizeof(g_banks)); // Новый кристалл: сектора стерты
+		g_initialized = true;
+		}
+}
+
+const uint8_t* FlashStorage_GetBank(uint8_t bank)
+{
+	sim_flash_init();
+	return g_banks[bank];
+}
+
+bool FlashStorage_EraseBank(uint8_t bank)
+{
+	sim_flash_init();
+	if (bank >= FLASH_STORAGE_BANK_COUNT) {
+		return false;
+		}
+	memset(g_banks[bank], 0xFF, FLASH_STORAGE_BANK_SIZE);
+	return true;
+}
+
+bool FlashStorage_ProgramWord(uint8_t bank, uint32_t offset, const uint32_t* data)
+{
+	sim_flash_init();
+	if (bank >= FLASH_STORAGE_BANK_COUNT || offset % FLASH_STORAGE_WORD_SIZE != 0 ||
+	    offset + FLASH_STORAGE_WORD_SIZE > FLASH_STORAGE_BANK_SIZE) {
+		return false;
+		}
+	uint8_t* word = &g_banks[bank][offset];
+	for (uint32_t i = 0; i < FLASH_STORAGE_WORD_SIZE; i++) {
+		if (word[i] != 0xFF) {
+			// На кристалле повторная запись слова дает ошибку ECC - ловим ее в симуляции
+			fprintf(stderr, "SIM: flash word %u:0x%05X programmed twice\n", bank, (unsigned)offset);
+			return false;
+			}
+		}
+	memcpy(word, data, FLASH_STORAGE_WORD_SIZE);
+	return true;
+}
@@ -0,0 +1,1491 @@
+/*
+ * sim_main.c
+ *
+ * Хост-симулятор Дирижера: прогоняет рецепты JobManager'а через модель
+ * CAN-шины и исполнителей в виртуальном времени и выводит статистику
+ * пропускной способности.
+ *
+ * Пример: ./build/dispatcher_sim --workload wash --jobs 1000 --parallel 2
+ *         ./build/dispatcher_sim --workload cycle --jobs 1000 --parallel 16 --cycle-ms 10000
+ *
+ * Трасса заданий (job_trace.h): --trace FILE выгружает трассу прогона командой
+ * JOB_TRACE, --replay FILE воспроизводит трассу (в том числе снятую с платы)
+ * и сверяет выходы диспетчера с записанными.
+ *
+ * Потери на линии USB (--usb-loss P): команды нагрузки отправляются с номерами
+ * (шапка "CS>", host_seq.h), часть пакетов команд портится, часть ACK теряется,
+ * и ПК повторяет команду с тем же номером, пока не получит ответ.
+ *
+ * Проверки протокола (--check): короткие сценарии с подсчетом ответов на каждую
+ * команду - например, что команда получает ровно один итог DONE/ERROR.
+ */
+
+#include "sim_rtos.h"
+#include "sim_bus.h"
+#include "sim_executors.h"
+#include "Dispatcher/job_manager.h"
+#include "Dispatcher/command_parser.h"
+#include "Dispatcher/can_packer.h"
+#include "Dispatcher/command_protocol.h"
+#include "Dispatcher/recipe_store.h"
+#include "Dispatcher/recipe_flash.h"
+#include "Dispatcher/cycle_scheduler.h"
+#include "Dispatcher/job_inbox.h"
+#include "Dispatcher/job_trace.h"
+#include "task_jobs_monitor.h"
+#include "task_dispatcher.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+// Предел виртуального времени на задание инициализации системы
+#define SIM_INIT_TIME_LIMIT_US  (60ull * 1000000ull)
+
+#define CMD_CODE_INIT           0x1002
+#define CMD_CODE_DISPENSER_WASH 0x2000
+#define CMD_CODE_RECIPE_UPLOAD  0x1007
+#define CMD_CODE_RECIPE_DELETE  0x1009
+#define CMD_CODE_RECIPE_RUN     0x100A
+#define CMD_CODE_CYCLE          0x100B
+#define CMD_CODE_JOB_CONTROL    0x100C
+#define CMD_CODE_JOB_TRACE      0x100F
+
+// --cancel-every: задание отменяется через столько после запуска
+#define SIM_CANCEL_DELAY_US     1000000ull
+#define SIM_MAX_PENDING_CANCELS 16
+
+// Рецепт нагрузки upload: копия промывки, загружаемая под свободным ID
+#define SIM_UPLOAD_RECIPE_ID    20
+
+// --usb-loss: попыток отправки одной команды (T_RETRY протокола и запас)
+#define SIM_HOST_MAX_ATTEMPTS   8
+
+// --check: ответов, запоминаемых за один сценарий, и предел ожидания завершения заданий
+#define SIM_CHECK_MAX_REPLIES   128
+#define SIM_CHECK_SETTLE_US     (120ull * 1000000ull)
+
+typedef enum {
+	WORKLOAD_WASH,
+	WORKLOAD_INIT,
+	WORKLOAD_MIXED,
+	WORKLOAD_UPLOAD,
+	WORKLOAD_ASPIRATE,
+	WORKLOAD_CYCLE
+} SimWorkload_t;
+
+typedef struct {
+	SimWorkload_t workload;
+	uint32_t jobs;
+	uint32_t parallel;
+	uint32_t bitrate;
+	uint32_t cycle_ms;
+	uint32_t cancel_every;
+	uint32_t seed;
+	double   latency_scale;
+	double   fail_rate;
+	double   drop_rate;
+	double   dup_rate;
+	double   usb_loss;          // --usb-loss: доля испорченных пакетов команд и потерянных ACK
+	double   max_time_s;
+	int      verbose;
+	int      check;             // --check: сценарии проверки протокола вместо нагрузки
+	const char* trace_path;     // --trace: куда выгрузить трассу прогона
+	const char* replay_path;    // --replay: трасса для воспроизведения
+} SimConfig_t;
+
+typedef struct {
+	uint32_t submitted;
+	uint32_t completed;
+	uint32_t failed;        // DONE с ненулевым статусом
+	uint32_t rejected;      // ERROR/NACK на команду
+	uint32_t cancelled;     // DONE со статусом ERR_CANCELLED (--cancel-every)
+	uint32_t started;       // Строки "INFO: Job #N started"
+	uint32_t in_flight;
+	uint32_t text_errors;   // Текстовые строки "ERROR:" от диспетчера
+	uint32_t text_warnings; // Текстовые строки "WARNING:" от диспетчера
+	uint32_t uploads;       // Рецептов, загруженных через RECIPE_UPLOAD
+	uint32_t upload_errors; // ERROR/NACK на фазы RECIPE_UPLOAD
+	double   in_flight_integral_us; // ∫ in_flight dt для расчета средней задержки
+} SimWorkloadStats_t;
+
+static SimConfig_t g_cfg = {
+	.workload = WORKLOAD_WASH,
+	.jobs = 100,
+	.parallel = 1,
+	.bitrate = 1000000,
+	.cycle_ms = APP_CYCLE_MS,
+	.cancel_every = 0,
+	.seed = 1,
+	.latency_scale = 1.0,
+	.fail_rate = 0.0,
+	.drop_rate = 0.0,
+	.dup_rate = 0.0,
+	.usb_loss = 0.0,
+	.max_time_s = 1.0e7,
+	.verbose = 0,
+	.check = 0,
+	.trace_path = NULL,
+	.replay_path = NULL,
+};
+
+static SimWorkloadStats_t g_wl;
+
+// Отмены, запланированные --cancel-every: отправляются из главного цикла, не из приемника USB
+static struct {
+	uint64_t at_us;
+	uint16_t job_id;
+} g_cancels[SIM_MAX_PENDING_CANCELS];
+static uint8_t g_cancel_count = 0;
+
+// ПК с повтором команд (--usb-loss)
+static struct {
+	bool enabled;           // Только рабочая нагрузка: инициализация и выгрузка трассы без потерь
+	uint16_t seq;           // Номер последней команды
+	bool answered;          // На команду seq пришел ACK, NACK или итог
+	uint32_t rng_state;
+	uint32_t corrupted;     // Испорчено пакетов команд (NACK 0x0002)
+	uint32_t lost_acks;
+	uint32_t retransmits;
+	uint32_t dup_replies;   // Повторные итоги (DONE/ERROR/NACK) номера, отброшенные ПК
+	uint32_t gave_up;       // Команд без ответа после SIM_HOST_MAX_ATTEMPTS попыток
+	uint8_t finished[65536 / 8]; // Бит номера: итог уже получен
+} g_host;
+
+// Выгрузка трассы (--trace): DATA команды JOB_TRACE, собранные по смещениям
+static struct {
+	uint8_t* data;
+	uint32_t length;
+	bool done;
+	bool failed;
+} g_dump;
+
+// Воспроизведение трассы (--replay)
+static struct {
+	const uint8_t* pos;     // Следующая запись
+	const uint8_t* end;
+	uint32_t index;         // Номер следующей записи
+	uint32_t now_ms;        // Время последней записи (HAL_GetTick)
+	uint8_t last_type;      // Последняя поданная запись - для отчета о расхождении
+	bool diverged;
+} g_replay;
+
+// Проверки протокола (--check): ответы текущего сценария
+typedef struct {
+	uint16_t command_code;
+	uint16_t seq;
+	bool sequenced;
+	uint8_t type;
+	uint16_t status;
+} SimReply_t;
+
+static struct {
+	bool enabled;
+	uint8_t count;
+	SimReply_t replies[SIM_CHECK_MAX_REPLIES];
+	const char* name;       // Текущий сценарий
+	uint16_t last_job_id;   // ID последнего запущенного задания ("INFO: Job #N started")
+	char last_upload_error[APP_USB_RESP_MAX_LEN]; // Последняя строка "ERROR: Recipe upload: ..."
+	bool scenario_failed;
+	uint32_t passed;
+	uint32_t failed;
+} g_check;
+
+// Модель задачи task_jobs_monitor: когда наступит взведенный срок
+static uint64_t g_monitor_wakeup_us = SIM_TIME_NEVER;
+static uint32_t g_monitor_runs = 0;
+// Модель задачи task_dispatcher: есть необработанные события JobInbox
+static bool g_dispatcher_woken = false;
+
+void JobsMonitor_Arm(uint32_t next_deadline_ms)
+{
+	g_monitor_wakeup_us = (next_deadline_ms == JOB_MANAGER_NO_DEADLINE) ? SIM_TIME_NEVER
+	                                                                     : Sim_NowUs() + next_deadline_ms * 1000ull;
+}
+
+void Dispatcher_Wakeup(void)
+{
+	g_dispatcher_woken = true;
+}
+
+// --- Приемник USB: ответы протокола и отладочный текст ---
+
+static bool is_workload_command(uint16_t command_code)
+{
+	return command_code == CMD_CODE_INIT || command_code == CMD_CODE_DISPENSER_WASH ||
+	       command_code == CMD_CODE_RECIPE_RUN;
+}
+
+/**
+ * @brief Собирает трассу из ответов JOB_TRACE: DATA - смещение (4 байта BE) и байты трассы.
+ */
+static void dump_on_packet(uint8_t type, const uint8_t* payload, uint16_t payload_len)
+{
+	if (type == 0x02) { // DONE
+		g_dump.done = true;
+		return;
+		}
+	if (type == 0x00 || type == 0x04) { // NACK / ERROR
+		g_dump.failed = true;
+		return;
+		}
+	if (type != 0x03 || payload_len < 4) {
+		return;
+		}
+	const uint32_t offset = ((uint32_t)payload[0] << 24) | ((uint32_t)payload[1] << 16) |
+	                        ((uint32_t)payload[2] << 8) | payload[3];
+	const uint32_t end = offset + (uint32_t)(payload_len - 4);
+	if (end > g_dump.length) {
+		uint8_t* grown = realloc(g_dump.data, end);
+		if (grown == NULL) {
+			g_dump.failed = true;
+			return;
+			}
+		memset(&grown[g_dump.length], 0, end - g_dump.length);
+		g_dump.data = grown;
+		g_dump.length = end;
+		}
+	memcpy(&g_dump.data[offset], &payload[4], payload_len - 4u);
+}
+
+static double host_rng_uniform(void)
+{
+	uint32_t x = g_host.rng_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	g_host.rng_state = x;
+	return (double)x / 4294967296.0;
+}
+
+/**
+ * @brief ПК принимает ответ команде с номером seq.
+ * @return false - ответ потерян или это повтор уже полученного итога.
+ */
+static bool host_on_reply(uint16_t seq, uint8_t type)
+{
+	if (type == 0x03) { // DATA
+		return true;
+		}
+	if (type == 0x01 && host_rng_uniform() < g_cfg.usb_loss) {
+		g_host.lost_acks++;
+		return false;
+		}
+	if (seq == g_host.seq) {
+		g_host.answered = true;
+		}
+	if (type == 0x01) {
+		return true;
+		}
+	uint8_t* bit = &g_host.finished[seq / 8];
+	if (*bit & (1u << (seq % 8))) {
+		g_host.dup_replies++;
+		return false;
+		}
+	*bit |= (uint8_t)(1u << (seq % 8));
+	return true;
+}
+
+static void usb_sink(const uint8_t* data, uint16_t length)
+{
+	const bool sequenced = (length >= 13 && data[1] == 'S');
+	if (length >= 11 && data[0] == 'C' && (data[1] == 'M' || sequenced) && data[2] == '>') {
+		// Ответ команде с номером: номер перед кодом команды, остальные поля сдвинуты на 2 байта
+		const uint16_t seq = (uint16_t)((data[5] << 8) | data[6]);
+		const uint8_t* reply = sequenced ? &data[2] : data;
+		length = sequenced ? (uint16_t)(length - 2) : length;
+		uint16_t command_code = (uint16_t)((reply[5] << 8) | reply[6]);
+		uint8_t type = reply[7];
+		uint16_t status = (uint16_t)((reply[8] << 8) | reply[9]);
+
+		if (g_cfg.verbose) {
+			printf("[%10.3f] USB: cmd=0x%04X type=0x%02X status=0x%04X",
+			       Sim_NowUs() / 1000.0, command_code, type, status);
+			if (sequenced) {
+				printf(" seq=%u", seq);
+				}
+			printf("\n");
+			}
+		if (g_check.enabled && g_check.count < SIM_CHECK_MAX_REPLIES) {
+			g_check.replies[g_check.count++] = (SimReply_t){ command_code, seq, sequenced, type, status };
+			}
+		if (sequenced && !host_on_reply(seq, type)) {
+			return;
+			}
+		if (!sequenced && g_host.enabled && type == 0x00 && status == 0x0002) {
+			return; // Испорченный пакет: ПК повторит команду с тем же номером
+			}
+		if (command_code == CMD_CODE_JOB_TRACE) {
+			dump_on_packet(type, &reply[10], (uint16_t)(length - 11));
+			return;
+			}
+		if (command_code == CMD_CODE_RECIPE_UPLOAD && (type == 0x00 || type == 0x04)) {
+			g_wl.upload_errors++;
+			return;
+			}
+		if (command_code == CMD_CODE_CYCLE && (type == 0x00 || type == 0x04)) {
+			g_wl.rejected++; // Тесты цикла завершаются без DONE: отказ - только на START/ORDER
+			return;
+			}
+		if (!is_workload_command(command_code) || g_wl.in_flight == 0) {
+			return;
+			}
+		if (type == 0x02) { // DONE
+			g_wl.in_flight--;
+			if (status == 0x0000) g_wl.completed++;
+			else if (status == 0x0010) g_wl.cancelled++; // ERR_CANCELLED
+			else g_wl.failed++;
+			}
+		else if (type == 0x00 || type == 0x04) { // NACK / ERROR
+			g_wl.in_flight--;
+			g_wl.rejected++;
+			}
+		return;
+		}
+
+	if (g_cfg.cancel_every > 0 && g_wl.submitted > 0) { // Задание инициализации не отменяется
+		char line[APP_USB_RESP_MAX_LEN];
+		unsigned long job_id = 0;
+		int matched = 0;
+		snprintf(line, sizeof(line), "%.*s", (int)length, (const char*)data);
+		sscanf(line, "INFO: Job #%lu started%n", &job_id, &matched);
+		if (matched > 0 && ++g_wl.started % g_cfg.cancel_every == 0 && g_cancel_count < SIM_MAX_PENDING_CANCELS) {
+			g_cancels[g_cancel_count].at_us = Sim_NowUs() + SIM_CANCEL_DELAY_US;
+			g_cancels[g_cancel_count].job_id = (uint16_t)job_id;
+			g_cancel_count++;
+			}
+		}
+	if (g_check.enabled) {
+		char line[APP_USB_RESP_MAX_LEN];
+		unsigned long job_id = 0;
+		int matched = 0;
+		snprintf(line, sizeof(line), "%.*s", (int)length, (const char*)data);
+		sscanf(line, "INFO: Job #%lu started%n", &job_id, &matched);
+		if (matched > 0) {
+			g_check.last_job_id = (uint16_t)job_id;
+			}
+		if (strncmp(line, "ERROR: Recipe upload:", 21) == 0) {
+			memcpy(g_check.last_upload_error, line, sizeof(line));
+			}
+		}
+	if (strncmp((const char*)data, "ERROR", 5) == 0) g_wl.text_errors++;
+	if (strncmp((const char*)data, "WARNING", 7) == 0) g_wl.text_warnings++;
+	if (g_cfg.verbose) {
+		printf("[%10.3f] %.*s\n", Sim_NowUs() / 1000.0, (int)length, (const char*)data);
+		}
+}
+
+// --- Дирижер: прием ответов исполнителей (как прием CAN на плате - через JobInbox) ---
+
+static void conductor_on_response(const CAN_Message_t* msg)
+{
+	CAN_Response_t response;
+	if (Packer_ParseCanResponse(msg, &response)) {
+		JobInbox_PostResponse(&response);
+		}
+}
+
+// --- Формирование команд протокола (как App_user/test_suite.py) ---
+
+/**
+ * @brief Отправляет пакет команды: "CM>" или, если seq != NULL, "CS>" с номером перед кодом.
+ */
+static void send_packet(const uint16_t* seq, uint16_t command_code, const uint8_t* params, uint16_t params_len, bool corrupt)
+{
+	uint8_t packet[APP_USB_CMD_MAX_LEN];
+	const uint16_t seq_len = (seq != NULL) ? 2 : 0;
+	uint16_t payload_len = (uint16_t)(seq_len + 2 + params_len + 1);
+	uint16_t total_len = (uint16_t)(5 + payload_len);
+	if (total_len > sizeof(packet)) {
+		return;
+		}
+
+	packet[0] = 'C'; packet[1] = (seq != NULL) ? 'S' : 'M'; packet[2] = '>';
+	packet[3] = (uint8_t)(payload_len >> 8);
+	packet[4] = (uint8_t)(payload_len & 0xFF);
+	uint8_t* p = &packet[5];
+	if (seq != NULL) {
+		*p++ = (uint8_t)(*seq >> 8);
+		*p++ = (uint8_t)(*seq & 0xFF);
+		}
+	*p++ = (uint8_t)(command_code >> 8);
+	*p++ = (uint8_t)(command_code & 0xFF);
+	memcpy(p, params, params_len);
+	p += params_len;
+
+	uint8_t crc = 0;
+	for (const uint8_t* b = &packet[5]; b < p; b++) {
+		crc ^= *b;
+		}
+	*p = corrupt ? (uint8_t)~crc : crc;
+
+	Parser_ProcessBinaryCommand(packet, total_len);
+}
+
+static void send_binary_command(uint16_t command_code, const uint8_t* params, uint16_t params_len)
+{
+	if (!g_host.enabled) {
+		send_packet(NULL, command_code, params, params_len, false);
+		return;
+		}
+
+	// Новый номер на каждую команду; повтор - тот же номер, пока не придет ответ
+	const uint16_t seq = ++g_host.seq;
+	g_host.finished[seq / 8] &= (uint8_t)~(1u << (seq % 8));
+	g_host.answered = false;
+	for (uint8_t attempt = 0; attempt < SIM_HOST_MAX_ATTEMPTS && !g_host.answered; attempt++) {
+		if (attempt > 0) {
+			g_host.retransmits++;
+			}
+		const bool corrupt = host_rng_uniform() < g_cfg.usb_loss;
+		if (corrupt) {
+			g_host.corrupted++;
+			}
+		send_packet(&seq, command_code, params, params_len, corrupt);
+		}
+	if (!g_host.answered) {
+		g_host.gave_up++;
+		}
+}
+
+static void put_be32(uint8_t* p, uint32_t value)
+{
+	p[0] = (uint8_t)(value >> 24);
+	p[1] = (uint8_t)(value >> 16);
+	p[2] = (uint8_t)(value >> 8);
+	p[3] = (uint8_t)value;
+}
+
+/**
+ * @brief Загружает программу через RECIPE_UPLOAD (BEGIN, DATA по 5 инструкций, COMMIT),
+ *        как это делает компилятор рецептов на стороне ПК.
+ */
+static void upload_recipe(uint8_t recipe_id, const RecipeInstr_t* code, uint8_t length,
+                          ResourceMask_t resources, const RecipeArgLayout_t* args)
+{
+	uint8_t params[MAX_BINARY_ARGS_SIZE];
+	params[0] = 0x01; // BEGIN
+	params[1] = recipe_id;
+	params[2] = length;
+	put_be32(&params[3], resources);
+	params[7] = args->count;
+	uint8_t* p = &params[8];
+	for (uint8_t i = 0; i < args->count; i++, p += 14) {
+		p[0] = args->fields[i].offset;
+		p[1] = args->fields[i].size;
+		put_be32(&p[2], (uint32_t)args->fields[i].min_value);
+		put_be32(&p[6], (uint32_t)args->fields[i].max_value);
+		put_be32(&p[10], (uint32_t)args->fields[i].default_value);
+		}
+	send_binary_command(CMD_CODE_RECIPE_UPLOAD, params, (uint16_t)(p - params));
+
+	uint32_t crc = 0;
+	for (uint8_t first = 0; first < length; first += 5) {
+		params[0] = 0x02; // DATA
+		params[1] = first;
+		p = &params[2];
+		for (uint8_t pc = first; pc < length && pc < first + 5; pc++, p += 12) {
+			p[0] = code[pc].op;
+			p[1] = code[pc].device;
+			p[2] = code[pc].dev_bind;
+			p[3] = code[pc].val_bind;
+			put_be32(&p[4], (uint32_t)code[pc].value);
+			p[8] = (uint8_t)(code[pc].speed >> 8);
+			p[9] = (uint8_t)code[pc].speed;
+			p[10] = (uint8_t)(code[pc].timeout_ms >> 8);
+			p[11] = (uint8_t)code[pc].timeout_ms;
+			crc = RecipeFlash_Crc32(crc, p, 12);
+			}
+		send_binary_command(CMD_CODE_RECIPE_UPLOAD, params, (uint16_t)(p - params));
+		}
+
+	params[0] = 0x03; // COMMIT
+	put_be32(&params[1], crc);
+	send_binary_command(CMD_CODE_RECIPE_UPLOAD, params, 5);
+	g_wl.uploads++;
+}
+
+// Раскладка аргументов промывки для ее загружаемой копии
+static const RecipeArgLayout_t k_wash_args = {
+	.count = 3,
+	.fields = {
+		{ .offset = 0, .size = 1, .min_value = 1,  .max_value = APP_DISPENSER_COUNT, .default_value = 1 },
+		{ .offset = 1, .size = 2, .min_value = 10, .max_value = 5000, .default_value = 1000 },
+		{ .offset = 3, .size = 1, .min_value = 1,  .max_value = 10,   .default_value = 1 },
+	},
+};
+
+/**
+ * @brief Нагрузка upload: перед каждым заданием промывка загружается заново
+ *        (нагружает журнал Flash и его уплотнение) и запускается через RECIPE_RUN.
+ */
+static void submit_uploaded_wash(void)
+{
+	uint8_t length = 0;
+	const RecipeInstr_t* code = Recipe_Get(RECIPE_DISPENSER_WASH, &length);
+	upload_recipe(SIM_UPLOAD_RECIPE_ID, code, length, Recipe_GetResources(RECIPE_DISPENSER_WASH), &k_wash_args);
+
+	const uint8_t params[] = { SIM_UPLOAD_RECIPE_ID, JOB_PRIORITY_MAINTENANCE, 0x01, 0x03, 0xE8, 0x02 };
+	send_binary_command(CMD_CODE_RECIPE_RUN, params, sizeof(params));
+}
+
+/**
+ * @brief Нагрузка cycle: первая команда запускает машинные циклы, затем тесты
+ *        заказываются по одному, пока в очереди и на диске меньше --parallel.
+ */
+static void submit_cycle_test(void)
+{
+	if (g_wl.submitted == 1) {
+		const uint8_t start[] = { 0x01, (uint8_t)(g_cfg.cycle_ms >> 8), (uint8_t)(g_cfg.cycle_ms & 0xFF) };
+		send_binary_command(CMD_CODE_CYCLE, start, sizeof(start));
+		}
+	const uint8_t order[] = { 0x03, 0x00, 0x01 };
+	send_binary_command(CMD_CODE_CYCLE, order, sizeof(order));
+}
+
+/**
+ * @brief Итоги тестов машинного цикла: DONE на каждый тест не приходит,
+ *        завершенные тесты берутся из статистики планировщика. Циклы,
+ *        остановленные ошибкой поворота диска, хост запускает снова.
+ */
+static void update_cycle_progress(void)
+{
+	static uint32_t completed_before = 0, failed_before = 0; // Статистика обнуляется при запуске циклов
+	CycleStats_t cs;
+	CycleScheduler_GetStats(&cs);
+	if (g_wl.submitted <= 1) {
+		completed_before = failed_before = 0;
+		}
+	g_wl.completed = completed_before + cs.tests_completed;
+	g_wl.failed = failed_before + cs.tests_failed;
+	if (cs.state == CYCLE_STATE_STOPPED && cs.tests_queued > 0) {
+		completed_before = g_wl.completed;
+		failed_before = g_wl.failed;
+		const uint8_t start[] = { 0x01, (uint8_t)(g_cfg.cycle_ms >> 8), (uint8_t)(g_cfg.cycle_ms & 0xFF) };
+		send_binary_command(CMD_CODE_CYCLE, start, sizeof(start));
+		}
+	const uint32_t finished = g_wl.completed + g_wl.failed + g_wl.rejected;
+	g_wl.in_flight = (g_wl.submitted > finished) ? g_wl.submitted - finished : 0;
+}
+
+static void submit_next_job(void)
+{
+	bool use_init = (g_cfg.workload == WORKLOAD_INIT) ||
+	                (g_cfg.workload == WORKLOAD_MIXED && (g_wl.submitted % 2) == 1);
+
+	g_wl.submitted++;
+	g_wl.in_flight++;
+	if (g_cfg.workload == WORKLOAD_UPLOAD) {
+		submit_uploaded_wash();
+		}
+	else if (g_cfg.workload == WORKLOAD_CYCLE) {
+		submit_cycle_test();
+		}
+	else if (g_cfg.workload == WORKLOAD_ASPIRATE) {
+		// У забора реагента нет своей команды: запуск по ID рецепта (граф зависимостей действий)
+		const uint8_t params[] = { RECIPE_ASPIRATE, JOB_PRIORITY_ROUTINE };
+		send_binary_command(CMD_CODE_RECIPE_RUN, params, sizeof(params));
+		}
+	else if (use_init) {
+		const uint8_t params[] = { 0xFF }; // Все модули
+		send_binary_command(CMD_CODE_INIT, params, sizeof(params));
+		}
+	else {
+		const uint8_t params[] = { 0x01, 0x03, 0xE8, 0x02 }; // Дозатор #1, 1000 мкл, 2 цикла
+		send_binary_command(CMD_CODE_DISPENSER_WASH, params, sizeof(params));
+		}
+}
+
+// --- Главный цикл симуляции ---
+
+static uint64_t min_u64(uint64_t a, uint64_t b)
+{
+	return (a < b) ? a : b;
+}
+
+static void advance_time(uint64_t next_us)
+{
+	uint64_t now = Sim_NowUs();
+	if (next_us > now) {
+		g_wl.in_flight_integral_us += (double)g_wl.in_flight * (double)(next_us - now);
+		Sim_AdvanceTo(next_us);
+		}
+}
+
+static uint64_t next_event_us(void)
+{
+	uint64_t next = min_u64(min_u64(SimBus_NextEventUs(), SimExec_NextEventUs()), g_monitor_wakeup_us);
+	if (g_dispatcher_woken) {
+		next = Sim_NowUs();
+		}
+	for (uint8_t i = 0; i < g_cancel_count; i++) {
+		next = min_u64(next, g_cancels[i].at_us);
+		}
+	return next;
+}
+
+/**
+ * @brief Отправляет JOB_CONTROL CANCEL заданиям, срок отмены которых наступил.
+ *        Задание, успевшее завершиться, получит ERROR - это не считается отказом нагрузки.
+ */
+static void send_due_cancels(void)
+{
+	uint8_t i = 0;
+	while (i < g_cancel_count) {
+		if (g_cancels[i].at_us <= Sim_NowUs()) {
+			const uint8_t params[] = { 0x01, (uint8_t)(g_cancels[i].job_id >> 8), (uint8_t)g_cancels[i].job_id };
+			g_cancels[i] = g_cancels[--g_cancel_count];
+			send_binary_command(CMD_CODE_JOB_CONTROL, params, sizeof(params));
+			}
+		else {
+			i++;
+			}
+		}
+}
+
+static void process_events(void)
+{
+	SimExec_Process();
+	SimBus_Process();
+	send_due_cancels();
+	if (Sim_NowUs() >= g_monitor_wakeup_us) {
+		// Как task_jobs_monitor: срок наступил - сообщить диспетчеру и ждать, пока он взведет монитор снова
+		g_monitor_wakeup_us = SIM_TIME_NEVER;
+		g_monitor_runs++;
+		JobInbox_PostTimer();
+		}
+	// Как task_dispatcher между байтами USB: обработать ответы и таймеры.
+	// Событие, поданное во время обработки (планировщик цикла запускает задания
+	// по таймеру), как и в FreeRTOS, не теряется: задача проснется снова.
+	while (g_dispatcher_woken) {
+		g_dispatcher_woken = false;
+		JobInbox_Process();
+		}
+}
+
+/**
+ * @brief Как task_dispatcher при старте: проверка встроенных рецептов и задание инициализации системы.
+ */
+static bool start_init_job(void)
+{
+	int bad_pc = -1;
+	const char* reason = "";
+	const RecipeID_t bad_recipe = Recipe_ValidateBuiltins(&bad_pc, &reason);
+	if (bad_recipe != RECIPE_NONE) {
+		fprintf(stderr, "SIM: built-in recipe %d: %s at pc %d\n", (int)bad_recipe, reason, bad_pc);
+		return false;
+		}
+
+	UniversalCommand_t init_cmd;
+	memset(&init_cmd, 0, sizeof(init_cmd));
+	init_cmd.command_code = CMD_CODE_INIT;
+	init_cmd.recipe_id = RECIPE_INITIALIZE_SYSTEM;
+	init_cmd.priority = JOB_PRIORITY_STAT;
+	init_cmd.args_type = ARGS_TYPE_NONE;
+	if (JobManager_StartNewJob(&init_cmd) == 0) {
+		fprintf(stderr, "SIM: failed to start system initialization job\n");
+		return false;
+		}
+	return true;
+}
+
+/**
+ * @brief Сброс моделей и инициализация системы (задание RECIPE_INITIALIZE_SYSTEM).
+ * @return 0 или 2, если система не инициализировалась.
+ */
+static int start_system(void)
+{
+	memset(&g_wl, 0, sizeof(g_wl));
+	g_cancel_count = 0;
+	g_monitor_wakeup_us = SIM_TIME_NEVER;
+	g_monitor_runs = 0;
+	g_dispatcher_woken = false;
+	Sim_RtosInit(usb_sink);
+	SimBus_Init(g_cfg.bitrate, SimExec_OnCommand, conductor_on_response);
+	SimExec_Init(g_cfg.seed);
+	memset(&g_host, 0, sizeof(g_host));
+	g_host.rng_state = (g_cfg.seed != 0) ? (g_cfg.seed ^ 0x9E3779B9u) : 1; // Не та же последовательность, что у исполнителей
+	SimExec_ScaleLatency(g_cfg.latency_scale);
+	RecipeFlash_Init();
+	JobManager_Init();
+	CycleScheduler_Init();
+	if (!start_init_job()) {
+		return 2;
+		}
+	while (!Sim_IsSystemReady()) {
+		uint64_t next = next_event_us();
+		if (next > SIM_INIT_TIME_LIMIT_US) {
+			fprintf(stderr, "SIM: system initialization did not complete\n");
+			return 2;
+			}
+		advance_time(next);
+		process_events();
+		}
+	return 0;
+}
+
+static int run_simulation(void)
+{
+	const uint64_t max_time_us = (uint64_t)(g_cfg.max_time_s * 1e6);
+	if (start_system() != 0) {
+		return 2;
+		}
+	const uint64_t start_us = Sim_NowUs();
+
+	// Ошибки вносятся только в рабочую нагрузку, инициализация проходит без них
+	for (uint8_t e = 0; e < SIM_EXECUTOR_COUNT; e++) {
+		SimExec_GetModel(e)->fail_rate = g_cfg.fail_rate;
+		SimExec_GetModel(e)->drop_rate = g_cfg.drop_rate;
+		SimExec_GetModel(e)->dup_rate = g_cfg.dup_rate;
+		}
+	g_host.enabled = (g_cfg.usb_loss > 0.0);
+	uint32_t admitted_before = 0;
+	for (uint8_t c = 0; c < JOB_PRIORITY_COUNT; c++) {
+		JobClassStats_t cs;
+		JobManager_GetClassStats((JobPriority_t)c, &cs);
+		admitted_before += cs.admitted;
+		}
+
+	while (g_wl.completed + g_wl.failed + g_wl.rejected + g_wl.cancelled < g_cfg.jobs) {
+		while (g_wl.submitted < g_cfg.jobs && g_wl.in_flight < g_cfg.parallel) {
+			submit_next_job();
+			}
+		uint64_t next = next_event_us();
+		if (next > max_time_us) {
+			fprintf(stderr, "SIM: virtual time limit reached\n");
+			break;
+			}
+		advance_time(next);
+		process_events();
+		if (g_cfg.workload == WORKLOAD_CYCLE) {
+			update_cycle_progress();
+			}
+		}
+	g_host.enabled = false;
+
+	const double elapsed_s = (Sim_NowUs() - start_us) / 1e6;
+	const uint32_t finished = g_wl.completed + g_wl.failed + g_wl.cancelled;
+	const SimBusStats_t* bus = SimBus_GetStats();
+
+	printf("Jobs:        %u submitted, %u completed, %u failed, %u rejected",
+	       g_wl.submitted, g_wl.completed, g_wl.failed, g_wl.rejected);
+	if (g_cfg.cancel_every > 0) {
+		printf(", %u cancelled", g_wl.cancelled);
+		}
+	printf("\n");
+	printf("Virtual:     %.3f s", elapsed_s);
+	if (elapsed_s > 0.0) {
+		printf(", %.1f jobs/h", g_wl.completed * 3600.0 / elapsed_s);
+		}
+	printf("\n");
+	if (finished > 0) {
+		printf("Job latency: %.1f ms mean (Little's law)\n",
+		       g_wl.in_flight_integral_us / finished / 1000.0);
+		}
+	printf("CAN bus:     %u frames, %u arbitration losses, %u dropped, load %.2f %%\n",
+	       bus->frames_sent, bus->arbitration_lost, bus->frames_dropped,
+	       (Sim_NowUs() > 0) ? 100.0 * bus->busy_us / Sim_NowUs() : 0.0);
+	for (uint8_t e = 0; e < SIM_EXECUTOR_COUNT; e++) {
+		const SimExecutorStats_t* st = SimExec_GetStats(e);
+		printf("Executor %u:  %u commands, %u responses, %u failures, %u dropped, %u duplicated\n",
+		       e, st->commands, st->responses, st->injected_failures, st->dropped_responses, st->dup_responses);
+		}
+	static const JobPriority_t classes[] = { JOB_PRIORITY_STAT, JOB_PRIORITY_ROUTINE, JOB_PRIORITY_MAINTENANCE };
+	static const char* const class_names[] = { "STAT", "routine", "maintenance" };
+	printf("Queue wait: ");
+	for (uint8_t c = 0; c < sizeof(classes) / sizeof(classes[0]); c++) {
+		JobClassStats_t cs;
+		JobManager_GetClassStats(classes[c], &cs);
+		printf(" %s %u jobs %.0f/%u ms mean/max;", class_names[c], cs.admitted,
+		       cs.admitted ? (double)cs.total_wait_ms / cs.admitted : 0.0, cs.max_wait_ms);
+		}
+	printf("\n");
+	printf("Dispatcher:  %u ERROR lines, %u WARNING lines, %u stale responses, %u monitor wakeups, %u inbox drops\n",
+	       g_wl.text_errors, g_wl.text_warnings, JobManager_GetStaleResponseCount(), g_monitor_runs, JobInbox_GetDroppedCount());
+	if (g_cfg.workload == WORKLOAD_CYCLE) {
+		CycleStats_t cs;
+		CycleScheduler_GetStats(&cs);
+		printf("Cycle:       %u cycles of %u ms, %u overruns (max %u ms), %u tests/h achieved of %u rated\n",
+		       cs.cycles, cs.cycle_ms, cs.overruns, cs.max_overrun_ms, cs.tests_per_hour, cs.rated_per_hour);
+		}
+	if (g_wl.uploads > 0) {
+		printf("Recipe flash: %u uploads, %u rejected phases, %u bytes free\n",
+		       g_wl.uploads, g_wl.upload_errors, RecipeFlash_GetFreeBytes());
+		}
+	uint32_t admitted = 0;
+	for (uint8_t c = 0; c < JOB_PRIORITY_COUNT; c++) {
+		JobClassStats_t cs;
+		JobManager_GetClassStats((JobPriority_t)c, &cs);
+		admitted += cs.admitted;
+		}
+	admitted -= admitted_before;
+	// Задания нагрузки (кроме тестов цикла - их задания запускает планировщик) выполняются по разу
+	const bool reexecuted = (g_cfg.workload != WORKLOAD_CYCLE && g_cfg.cancel_every == 0 && admitted > g_wl.submitted);
+	if (g_cfg.usb_loss > 0.0) {
+		printf("USB link:    %u corrupted commands, %u lost ACKs, %u retransmits, %u duplicate replies dropped, %u unanswered\n",
+		       g_host.corrupted, g_host.lost_acks, g_host.retransmits, g_host.dup_replies, g_host.gave_up);
+		printf("             %u jobs admitted for %u submitted%s\n",
+		       admitted, g_wl.submitted, reexecuted ? " - DUPLICATES EXECUTED" : "");
+		}
+	if (reexecuted) {
+		return 1;
+		}
+
+	// Без внесенных ошибок любое неуспешное задание - регрессия
+	bool faults_injected = (g_cfg.fail_rate > 0.0 || g_cfg.drop_rate > 0.0);
+	if (!faults_injected && (g_wl.failed > 0 || g_wl.rejected > 0 || g_wl.upload_errors > 0 ||
+	                         g_wl.completed + g_wl.cancelled < g_cfg.jobs)) {
+		return 1;
+		}
+	return 0;
+}
+
+// --- Трасса заданий: выгрузка (--trace) и воспроизведение (--replay) ---
+
+/**
+ * @brief Выгружает трассу прогона командой JOB_TRACE, как это делает ПК, и пишет ее в файл.
+ */
+static int save_trace(const char* path)
+{
+	memset(&g_dump, 0, sizeof(g_dump));
+	send_binary_command(CMD_CODE_JOB_TRACE, NULL, 0);
+	if (!g_dump.done || g_dump.failed || g_dump.length < sizeof(JobTraceHeader_t)) {
+		fprintf(stderr, "SIM: JOB_TRACE returned no trace (APP_JOB_TRACE_BYTES = %u)\n", (unsigned)APP_JOB_TRACE_BYTES);
+		free(g_dump.data);
+		return 2;
+		}
+
+	JobTraceHeader_t header;
+	memcpy(&header, g_dump.data, sizeof(header));
+	FILE* f = fopen(path, "wb");
+	bool written = (f != NULL && fwrite(g_dump.data, 1, g_dump.length, f) == g_dump.length);
+	if (f != NULL && fclose(f) != 0) {
+		written = false;
+		}
+	if (!written) {
+		fprintf(stderr, "SIM: cannot write %s\n", path);
+		free(g_dump.data);
+		return 2;
+		}
+	printf("Trace:       %u events, %u bytes%s -> %s\n", header.events, g_dump.length,
+	       (header.flags & JOB_TRACE_FLAG_TRUNCATED) ? " (truncated: buffer full)" : "", path);
+	free(g_dump.data);
+	return 0;
+}
+
+static const char* trace_type_name(uint8_t type)
+{
+	switch (type) {
+		case JOB_TRACE_COMMAND:  return "command";
+		case JOB_TRACE_RESPONSE: return "executor response";
+		case JOB_TRACE_TIMER:    return "timers";
+		case JOB_TRACE_TICK:     return "parser delay";
+		default:                 return "start";
+		}
+}
+
+/**
+ * @brief Читает следующую запись, переводит часы на ее время и сверяет CRC выходов до нее.
+ */
+static bool replay_next(JobTraceEvent_t* ev)
+{
+	if (g_replay.diverged || !JobTrace_ReadEvent(&g_replay.pos, g_replay.end, ev)) {
+		return false;
+		}
+	const uint16_t crc = (uint16_t)(JobTrace_GetOutputCrc() & 0xFFFF);
+	if (crc != ev->checkpoint) {
+		printf("Replay:      DIVERGED after event #%u (%s at %u ms): output CRC %04X, trace %04X\n",
+		       g_replay.index, trace_type_name(g_replay.last_type), g_replay.now_ms, crc, ev->checkpoint);
+		g_replay.diverged = true;
+		return false;
+		}
+	g_replay.now_ms += ev->dt_ms;
+	Sim_AdvanceTo(g_replay.now_ms * 1000ull);
+	g_replay.index++;
+	g_replay.last_type = ev->type;
+	return true;
+}
+
+// osDelay в парсере: на плате за паузу прошло время, записанное следующей записью TICK
+static void replay_on_delay(uint32_t ticks)
+{
+	(void)ticks;
+	const uint8_t* pos = g_replay.pos;
+	JobTraceEvent_t ev;
+	if (JobTrace_ReadEvent(&pos, g_replay.end, &ev) && ev.type == JOB_TRACE_TICK) {
+		replay_next(&ev);
+		}
+}
+
+/**
+ * @brief Подает записи трассы диспетчеру в записанные моменты времени и сверяет выходы.
+ *        Исполнители не моделируются: их ответы берутся из трассы.
+ */
+static int run_replay(const char* path)
+{
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) {
+		fprintf(stderr, "SIM: cannot open %s\n", path);
+		return 2;
+		}
+	fseek(f, 0, SEEK_END);
+	const long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t* trace = malloc((size > 0) ? (size_t)size : 1);
+	const bool read_ok = (trace != NULL && size > 0 && fread(trace, 1, (size_t)size, f) == (size_t)size);
+	fclose(f);
+
+	JobTraceHeader_t header;
+	if (!read_ok || (size_t)size < sizeof(header)) {
+		fprintf(stderr, "SIM: cannot read %s\n", path);
+		free(trace);
+		return 2;
+		}
+	memcpy(&header, trace, sizeof(header));
+	if (header.magic != JOB_TRACE_MAGIC || header.version != JOB_TRACE_VERSION) {
+		fprintf(stderr, "SIM: %s is not a job trace of version %u\n", path, JOB_TRACE_VERSION);
+		free(trace);
+		return 2;
+		}
+	if (header.length != (uint32_t)size - sizeof(header) ||
+	    RecipeFlash_Crc32(0, &trace[sizeof(header)], header.length) != header.crc) {
+		fprintf(stderr, "SIM: %s is damaged (length or CRC mismatch)\n", path);
+		free(trace);
+		return 2;
+		}
+	if (header.config_crc != JobTrace_ConfigCrc()) {
+		fprintf(stderr, "SIM: trace was recorded by a build with other parameters (config CRC %08X, this build %08X)\n",
+		        header.config_crc, JobTrace_ConfigCrc());
+		free(trace);
+		return 2;
+		}
+
+	// Как при загрузке платы, с часами на моменте JobManager_Init
+	Sim_RtosInit(usb_sink);
+	Sim_AdvanceTo(header.start_tick * 1000ull);
+	SimBus_Init(g_cfg.bitrate, NULL, NULL); // Кадры CAN только сверяются, до исполнителей не доходят
+	RecipeFlash_Init();
+	if (header.flash_crc != JobTrace_FlashCrc()) {
+		printf("WARNING: recipes in flash differ from the recorded ones (CRC %08X, trace %08X)\n",
+		       JobTrace_FlashCrc(), header.flash_crc);
+		}
+	JobManager_Init();
+	JobTrace_StartReplay();
+	CycleScheduler_Init();
+	if (!start_init_job()) {
+		free(trace);
+		return 2;
+		}
+
+	memset(&g_replay, 0, sizeof(g_replay));
+	g_replay.pos = &trace[sizeof(header)];
+	g_replay.end = &trace[size];
+	g_replay.now_ms = header.start_tick;
+	Sim_SetDelayHook(replay_on_delay);
+
+	JobTraceEvent_t ev;
+	while (replay_next(&ev)) {
+		switch (ev.type) {
+			case JOB_TRACE_COMMAND: {
+				uint8_t packet[APP_USB_CMD_MAX_LEN];
+				const uint16_t len = (ev.packet_len < sizeof(packet)) ? ev.packet_len : (uint16_t)sizeof(packet);
+				memcpy(packet, ev.packet, len);
+				Parser_ProcessBinaryCommand(packet, len);
+				break;
+				}
+			case JOB_TRACE_RESPONSE:
+				JobManager_ProcessExecutorResponse(ev.response.job_id, ev.response.executor_id,
+				                                   ev.response.action_tag, ev.response.status_ok);
+				break;
+			case JOB_TRACE_TIMER:
+				JobInbox_RunTimers();
+				break;
+			default: // TICK вне паузы парсера: только время
+				break;
+			}
+		}
+	Sim_SetDelayHook(NULL);
+
+	int result = 0;
+	if (g_replay.diverged) {
+		result = 1;
+		}
+	else if (g_replay.pos != g_replay.end || g_replay.index != header.events) {
+		fprintf(stderr, "SIM: %s: record #%u is damaged\n", path, g_replay.index);
+		result = 2;
+		}
+	else if (JobTrace_GetOutputCrc() != header.output_crc) {
+		printf("Replay:      DIVERGED after event #%u (%s at %u ms): output CRC %08X, trace %08X\n",
+		       g_replay.index, trace_type_name(g_replay.last_type), g_replay.now_ms,
+		       JobTrace_GetOutputCrc(), header.output_crc);
+		result = 1;
+		}
+	else {
+		printf("Replay:      %u events over %.3f s, outputs match (CRC %08X)%s\n",
+		       header.events, (g_replay.now_ms - header.start_tick) / 1e3, header.output_crc,
+		       (header.flags & JOB_TRACE_FLAG_TRUNCATED) ? ", trace truncated" : "");
+		}
+	free(trace);
+	return result;
+}
+
+// --- Проверки протокола (--check) ---
+
+/**
+ * @brief Обрабатывает события, пока не завершатся все задания (или SIM_CHECK_SETTLE_US).
+ */
+static void check_settle(void)
+{
+	const uint64_t limit_us = Sim_NowUs() + SIM_CHECK_SETTLE_US;
+	while (JobManager_GetActiveJobCount() > 0 || g_dispatcher_woken) {
+		uint64_t next = next_event_us();
+		if (next > limit_us) {
+			break;
+			}
+		advance_time(next);
+		process_events();
+		}
+}
+
+/**
+ * @brief Обрабатывает события в течение duration_us виртуального времени.
+ */
+static void check_run_for(uint64_t duration_us)
+{
+	const uint64_t until_us = Sim_NowUs() + duration_us;
+	for (;;) {
+		uint64_t next = next_event_us();
+		if (next > until_us) {
+			break;
+			}
+		advance_time(next);
+		process_events();
+		}
+	advance_time(until_us);
+}
+
+static void check_begin(const char* name)
+{
+	g_check.name = name;
+	g_check.scenario_failed = false;
+	g_check.count = 0;
+}
+
+/**
+ * @brief Число ответов команде command_code вида type; seq < 0 - команды без номера.
+ *        status < 0 - любой статус.
+ */
+static uint8_t check_count(uint16_t command_code, int32_t seq, uint8_t type, int32_t status)
+{
+	uint8_t count = 0;
+	for (uint8_t i = 0; i < g_check.count; i++) {
+		const SimReply_t* reply = &g_check.replies[i];
+		if (reply->command_code == command_code && reply->type == type &&
+		    (seq < 0 ? !reply->sequenced : (reply->sequenced && reply->seq == (uint16_t)seq)) &&
+		    (status < 0 || reply->status == (uint16_t)status)) {
+			count++;
+			}
+		}
+	return count;
+}
+
+static void check_expect(bool condition, const char* what)
+{
+	if (!condition) {
+		printf("Check %-28s FAIL: %s\n", g_check.name, what);
+		g_check.scenario_failed = true;
+		}
+}
+
+static void check_end(void)
+{
+	if (g_check.scenario_failed) {
+		g_check.failed++;
+		}
+	else {
+		printf("Check %-28s ok\n", g_check.name);
+		g_check.passed++;
+		}
+}
+
+/**
+ * @brief Аргумент вне диапазона: задание завершается сразу, команда получает ровно
+ *        один итог (DONE 0x0001). Повтор команды с номером повторяет тот же итог.
+ */
+static void check_bad_argument(void)
+{
+	const uint8_t params[] = { 0x01, 0x00, 0x05, 0x02 }; // Объем 5 мкл: меньше минимума 10
+	check_begin("bad-argument");
+	send_packet(NULL, CMD_CODE_DISPENSER_WASH, params, sizeof(params), false);
+	check_settle();
+	check_expect(check_count(CMD_CODE_DISPENSER_WASH, -1, 0x01, -1) == 1, "one ACK");
+	check_expect(check_count(CMD_CODE_DISPENSER_WASH, -1, 0x02, 0x0001) == 1, "one DONE 0x0001");
+	check_expect(check_count(CMD_CODE_DISPENSER_WASH, -1, 0x04, -1) == 0, "no ERROR");
+
+	const uint16_t seq = 0x0200;
+	send_packet(&seq, CMD_CODE_DISPENSER_WASH, params, sizeof(params), false);
+	check_settle();
+	send_packet(&seq, CMD_CODE_DISPENSER_WASH, params, sizeof(params), false);
+	check_settle();
+	check_expect(check_count(CMD_CODE_DISPENSER_WASH, seq, 0x02, 0x0001) == 2, "retransmit replays DONE 0x0001");
+	check_expect(check_count(CMD_CODE_DISPENSER_WASH, seq, 0x04, -1) == 0, "no ERROR for the sequenced command");
+	check_end();
+}
+
+/**
+ * @brief RECIPE_RUN с ID, под которым рецепта нет (никогда не загружался или удален):
+ *        ровно один итог ERROR 0x0003, задание не создается.
+ */
+static void check_run_missing_recipe(void)
+{
+	check_begin("run-missing-recipe");
+	const uint8_t never_uploaded[] = { SIM_UPLOAD_RECIPE_ID + 1, JOB_PRIORITY_ROUTINE };
+	send_packet(NULL, CMD_CODE_RECIPE_RUN, never_uploaded, sizeof(never_uploaded), false);
+	check_settle();
+	check_expect(check_count(CMD_CODE_RECIPE_RUN, -1, 0x04, 0x0003) == 1, "never uploaded: one ERROR 0x0003");
+
+	uint8_t length = 0;
+	const RecipeInstr_t* code = Recipe_Get(RECIPE_DISPENSER_WASH, &length);
+	upload_recipe(SIM_UPLOAD_RECIPE_ID, code, length, Recipe_GetResources(RECIPE_DISPENSER_WASH), &k_wash_args);
+	const uint8_t delete_params[] = { SIM_UPLOAD_RECIPE_ID };
+	send_packet(NULL, CMD_CODE_RECIPE_DELETE, delete_params, sizeof(delete_params), false);
+	check_expect(check_count(CMD_CODE_RECIPE_DELETE, -1, 0x02, 0x0000) == 1, "uploaded recipe deleted");
+	const uint8_t deleted[] = { SIM_UPLOAD_RECIPE_ID, JOB_PRIORITY_ROUTINE };
+	send_packet(NULL, CMD_CODE_RECIPE_RUN, deleted, sizeof(deleted), false);
+	check_settle();
+	check_expect(check_count(CMD_CODE_RECIPE_RUN, -1, 0x04, 0x0003) == 2, "deleted: one ERROR 0x0003");
+
+	check_expect(check_count(CMD_CODE_RECIPE_RUN, -1, 0x01, -1) == 2, "one ACK per command");
+	check_expect(check_count(CMD_CODE_RECIPE_RUN, -1, 0x02, -1) == 0, "no DONE");
+	check_expect(check_count(CMD_CODE_RECIPE_RUN, -1, 0x04, -1) == 2, "no other ERROR");
+	check_end();
+}
+
+static void check_job_control(uint8_t op, uint16_t job_id)
+{
+	const uint8_t params[] = { op, (uint8_t)(job_id >> 8), (uint8_t)job_id };
+	send_packet(NULL, CMD_CODE_JOB_CONTROL, params, sizeof(params), false);
+}
+
+/**
+ * @brief Пауза посреди блока PAR забора реагента (моторы 1, 2 и насос 1 дозатора 1).
+ *        Пауза во время поворота дозатора: после RESUME мотор 1 выводится в HOME и поворот
+ *        повторяется целиком, моторы возвращаются в исходную позицию. Пауза во время забора:
+ *        выполненные перемещения не повторяются, выключенный паузой насос включается снова.
+ */
+static void check_pause_resume(void)
+{
+	const uint8_t params[] = { RECIPE_ASPIRATE, JOB_PRIORITY_ROUTINE };
+	check_begin("pause-resume");
+
+	// Поворот на 1000 шагов со скоростью TRAVEL идет ~2 с
+	uint32_t homes = SimExec_GetCommandCount(CAN_EXECUTOR_MOTORS, CMD_HOME);
+	uint32_t moves = SimExec_GetCommandCount(CAN_EXECUTOR_MOTORS, CMD_MOVE_RELATIVE);
+	send_packet(NULL, CMD_CODE_RECIPE_RUN, params, sizeof(params), false);
+	check_run_for(50000);
+	check_job_control(0x02, g_check.last_job_id);
+	check_run_for(100000);
+	check_expect(SimExec_GetMotorPosition(1) > 0 && SimExec_GetMotorPosition(1) < 1000, "paused in the middle of the move");
+	check_job_control(0x03, g_check.last_job_id);
+	check_settle();
+	check_expect(SimExec_GetCommandCount(CAN_EXECUTOR_MOTORS, CMD_HOME) == homes + 1, "motor of the interrupted move homed");
+	check_expect(SimExec_GetCommandCount(CAN_EXECUTOR_MOTORS, CMD_MOVE_RELATIVE) == moves + 5, "interrupted move repeated once");
+	check_expect(SimExec_GetMotorPosition(1) == 0 && SimExec_GetMotorPosition(2) == 0, "motors back at the start position");
+	if (JobManager_GetActiveJobCount() > 0) {
+		check_job_control(0x01, g_check.last_job_id); // Задание не продолжилось: второй сценарий без него
+		check_settle();
+		}
+
+	// Забор (500 мс) начинается после поворота и опускания иглы: ~4 с от запуска
+	homes = SimExec_GetCommandCount(CAN_EXECUTOR_MOTORS, CMD_HOME);
+	moves = SimExec_GetCommandCount(CAN_EXECUTOR_MOTORS, CMD_MOVE_RELATIVE);
+	const uint32_t pump_commands = SimExec_GetCommandCount(CAN_EXECUTOR_PUMPS, CMD_SET_PUMP_STATE);
+	send_packet(NULL, CMD_CODE_RECIPE_RUN, params, sizeof(params), false);
+	for (uint16_t i = 0; i < 1000 && !SimExec_IsPumpOn(1); i++) {
+		check_run_for(10000);
+		}
+	check_run_for(100000);
+	check_job_control(0x02, g_check.last_job_id);
+	check_run_for(100000); // Кадры остановки доходят до исполнителей
+	check_expect(!SimExec_IsPumpOn(1), "pump stopped by the pause");
+	check_job_control(0x03, g_check.last_job_id);
+	check_run_for(10000);
+	check_expect(SimExec_IsPumpOn(1), "pump restarted on resume");
+	check_settle();
+	check_expect(SimExec_GetCommandCount(CAN_EXECUTOR_MOTORS, CMD_HOME) == homes, "no HOME for finished moves");
+	check_expect(SimExec_GetCommandCount(CAN_EXECUTOR_MOTORS, CMD_MOVE_RELATIVE) == moves + 4, "finished moves not repeated");
+	check_expect(SimExec_GetCommandCount(CAN_EXECUTOR_PUMPS, CMD_SET_PUMP_STATE) == pump_commands + 4, "pump on, stop, on again, off");
+	check_expect(!SimExec_IsPumpOn(1), "pump off at the end");
+	check_expect(SimExec_GetMotorPosition(1) == 0 && SimExec_GetMotorPosition(2) == 0, "motors back at the start position");
+
+	check_expect(check_count(CMD_CODE_RECIPE_RUN, -1, 0x02, 0x0000) == 2, "both jobs DONE 0x0000");
+	check_expect(check_count(CMD_CODE_JOB_CONTROL, -1, 0x02, 0x0000) == 4, "PAUSE and RESUME answered with DONE");
+	check_expect(check_count(CMD_CODE_JOB_CONTROL, -1, 0x04, -1) == 0, "no ERROR");
+	check_end();
+}
+
+/**
+ * @brief Насос, включенный прежним шагом, выключается при отмене задания и при его
+ *        аварийном завершении (тайм-аут перемещения без BRANCH_IF_FAIL).
+ */
+static void check_stop_on_end(void)
+{
+	static const RecipeArgLayout_t no_args = { .count = 0 };
+	static const RecipeInstr_t pump_then_wait[] = {
+		{ R_PUMP_ON(1, 200) },
+		{ R_WAIT(2000) },
+		{ R_PUMP_OFF(1, 200) },
+		{ R_END() },
+	};
+	static const RecipeInstr_t pump_then_move[] = {
+		{ R_PUMP_ON(1, 200) },
+		{ R_ROTATE(1, 5000, 1000, 50) }, // Перемещение на 5 с не укладывается в срок 50 мс
+		{ R_PUMP_OFF(1, 200) },
+		{ R_END() },
+	};
+	const uint8_t run[] = { SIM_UPLOAD_RECIPE_ID, JOB_PRIORITY_ROUTINE };
+	check_begin("stop-on-end");
+
+	upload_recipe(SIM_UPLOAD_RECIPE_ID, pump_then_wait, 4, RES_PUMP(1), &no_args);
+	send_packet(NULL, CMD_CODE_RECIPE_RUN, run, sizeof(run), false);
+	check_run_for(500000);
+	check_expect(SimExec_IsPumpOn(1), "pump on during the wait");
+	check_job_control(0x01, g_check.last_job_id);
+	check_settle();
+	check_run_for(10000);
+	check_expect(!SimExec_IsPumpOn(1), "cancel stops the pump of a previous step");
+	check_expect(check_count(CMD_CODE_RECIPE_RUN, -1, 0x02, 0x0010) == 1, "cancelled job DONE 0x0010");
+
+	upload_recipe(SIM_UPLOAD_RECIPE_ID, pump_then_move, 4, RES_PUMP(1) | RES_MOTOR(1), &no_args);
+	send_packet(NULL, CMD_CODE_RECIPE_RUN, run, sizeof(run), false);
+	check_settle();
+	check_run_for(10000);
+	check_expect(!SimExec_IsPumpOn(1), "timeout stops the pump of a previous step");
+	check_expect(check_count(CMD_CODE_RECIPE_RUN, -1, 0x02, 0x0006) == 1, "failed job DONE 0x0006");
+	check_end();
+}
+
+/**
+ * @brief Номер команды, чье задание выполняется, занят: другая команда с этим номером
+ *        (другой код или другие параметры) получает NACK ERR_BUSY и не выполняется,
+ *        DONE выполняющейся команды приходит с этим номером и повторяется по запросу.
+ */
+static void check_seq_reuse_running(void)
+{
+	const uint16_t seq = 0x0300;
+	const uint8_t wash[] = { 0x01, 0x00, 0x64, 0x01 };       // 100 мкл, 1 цикл
+	const uint8_t other_wash[] = { 0x01, 0x00, 0xC8, 0x01 }; // 200 мкл: другая CRC
+	const uint8_t aspirate[] = { RECIPE_ASPIRATE, JOB_PRIORITY_ROUTINE };
+	check_begin("seq-reuse-running");
+
+	send_packet(&seq, CMD_CODE_DISPENSER_WASH, wash, sizeof(wash), false);
+	check_run_for(50000);
+	send_packet(&seq, CMD_CODE_RECIPE_RUN, aspirate, sizeof(aspirate), false);
+	send_packet(&seq, CMD_CODE_DISPENSER_WASH, other_wash, sizeof(other_wash), false);
+	check_expect(check_count(CMD_CODE_RECIPE_RUN, seq, 0x00, 0x0004) == 1, "other command: NACK 0x0004");
+	check_expect(check_count(CMD_CODE_DISPENSER_WASH, seq, 0x00, 0x0004) == 1, "other parameters: NACK 0x0004");
+	check_expect(JobManager_GetActiveJobCount() == 1, "rejected commands start no job");
+	check_settle();
+	check_expect(check_count(CMD_CODE_DISPENSER_WASH, seq, 0x02, 0x0000) == 1, "running command DONE 0x0000");
+
+	send_packet(&seq, CMD_CODE_DISPENSER_WASH, wash, sizeof(wash), false);
+	check_settle();
+	check_expect(check_count(CMD_CODE_DISPENSER_WASH, seq, 0x01, -1) == 2, "retransmit replays ACK");
+	check_expect(check_count(CMD_CODE_DISPENSER_WASH, seq, 0x02, 0x0000) == 2, "retransmit replays DONE 0x0000");
+	check_expect(check_count(CMD_CODE_RECIPE_RUN, seq, 0x01, -1) == 0 && check_count(CMD_CODE_RECIPE_RUN, seq, 0x02, -1) == 0,
+	             "rejected command not executed");
+	check_end();
+}
+
+/**
+ * @brief Загружает программу, которую COMMIT должен отклонить: ERROR 0x0003 с причиной reason.
+ */
+static void check_upload_rejected(const RecipeInstr_t* code, uint8_t length, const char* reason, const char* what)
+{
+	const uint8_t errors = check_count(CMD_CODE_RECIPE_UPLOAD, -1, 0x04, 0x0003);
+	g_check.last_upload_error[0] = '\0';
+	upload_recipe(SIM_UPLOAD_RECIPE_ID, code, length, RES_PUMP(1), &k_wash_args);
+	check_expect(check_count(CMD_CODE_RECIPE_UPLOAD, -1, 0x04, 0x0003) == errors + 1 &&
+	             strstr(g_check.last_upload_error, reason) != NULL, what);
+}
+
+/**
+ * @brief Проверка переходов при загрузке: адрес перехода - в той же области, что и сам
+ *        переход (не внутри блока PAR, не в теле другого цикла и не вне тела своего).
+ */
+static void check_upload_jumps(void)
+{
+	static const RecipeInstr_t jump_into_par[] = {
+		{ R_PAR_BEGIN() }, { R_PUMP_ON(1, 200) }, { R_WAIT(100) }, { R_PAR_END() },
+		{ R_JUMP(2) },                                                    // На WAIT внутри блока
+	};
+	static const RecipeInstr_t condition_into_par[] = {
+		{ R_JUMP_UNLESS_ARG(0, 0x01, 3) },                                // На WAIT внутри блока
+		{ R_PAR_BEGIN() }, { R_PUMP_ON(1, 200) }, { R_WAIT(100) }, { R_PAR_END() },
+		{ R_END() },
+	};
+	static const RecipeInstr_t branch_to_par_end[] = {
+		{ R_BRANCH_IF_FAIL(4) },                                          // На PAR_END
+		{ R_PAR_BEGIN() }, { R_PUMP_ON(1, 200) }, { R_WAIT(100) }, { R_PAR_END() },
+		{ R_END() },
+	};
+	static const RecipeInstr_t jump_out_of_loop[] = {
+		{ R_LOOP(3) }, { R_PUMP_ON(1, 200) },
+		{ R_JUMP(4) },                                                    // Из тела за END_LOOP
+		{ R_END_LOOP() }, { R_END() },
+	};
+	static const RecipeInstr_t jump_into_loop[] = {
+		{ R_JUMP(2) },                                                    // В тело цикла
+		{ R_LOOP(3) }, { R_PUMP_ON(1, 200) }, { R_END_LOOP() }, { R_END() },
+	};
+	static const RecipeInstr_t branch_out_of_loop[] = {
+		{ R_LOOP(2) },
+		{ R_BRANCH_IF_FAIL(4) },                                          // Обработчик ошибки вне тела
+		{ R_PUMP_ON(1, 200) }, { R_END_LOOP() }, { R_END() },
+	};
+	static const RecipeInstr_t jumps_in_scope[] = {
+		{ R_LOOP(2) },
+		{ R_JUMP_UNLESS_ARG(0, 0x02, 3) },                                // На END_LOOP: следующий проход
+		{ R_PUMP_ON(1, 200) },
+		{ R_END_LOOP() },
+		{ R_BRANCH_IF_FAIL(9) },
+		{ R_JUMP_UNLESS_ARG(0, 0x02, 6) },                                // На PAR_BEGIN
+		{ R_PAR_BEGIN() }, { R_PUMP_OFF(1, 200) }, { R_PAR_END() },
+		{ R_END() },
+	};
+	check_begin("upload-jumps");
+	check_upload_rejected(jump_into_par, 5, "jump into parallel block", "JUMP into PAR block rejected");
+	check_upload_rejected(condition_into_par, 6, "jump into parallel block", "JUMP_UNLESS_ARG into PAR block rejected");
+	check_upload_rejected(branch_to_par_end, 6, "jump into parallel block", "BRANCH_IF_FAIL to PAR_END rejected");
+	check_upload_rejected(jump_out_of_loop, 5, "jump into or out of loop body", "JUMP out of loop body rejected");
+	check_upload_rejected(jump_into_loop, 5, "jump into or out of loop body", "JUMP into loop body rejected");
+	check_upload_rejected(branch_out_of_loop, 5, "jump into or out of loop body", "BRANCH_IF_FAIL out of loop body rejected");
+
+	const uint8_t errors = check_count(CMD_CODE_RECIPE_UPLOAD, -1, 0x04, -1);
+	upload_recipe(SIM_UPLOAD_RECIPE_ID, jumps_in_scope, 10, RES_PUMP(1), &k_wash_args);
+	check_expect(check_count(CMD_CODE_RECIPE_UPLOAD, -1, 0x04, -1) == errors, "jumps within their scope accepted");
+	const uint8_t run[] = { SIM_UPLOAD_RECIPE_ID, JOB_PRIORITY_ROUTINE };
+	send_packet(NULL, CMD_CODE_RECIPE_RUN, run, sizeof(run), false);
+	check_settle();
+	check_expect(check_count(CMD_CODE_RECIPE_RUN, -1, 0x02, 0x0000) == 1, "accepted program runs to DONE 0x0000");
+	check_end();
+}
+
+static int run_checks(void)
+{
+	if (start_system() != 0) {
+		return 2;
+		}
+	g_check.enabled = true;
+	check_bad_argument();
+	check_run_missing_recipe();
+	check_pause_resume();
+	check_stop_on_end();
+	check_seq_reuse_running();
+	check_upload_jumps();
+	g_check.enabled = false;
+
+	printf("Checks:      %u passed, %u failed\n", g_check.passed, g_check.failed);
+	return (g_check.failed > 0) ? 1 : 0;
+}
+
+// --- Разбор аргументов командной строки ---
+
+static void print_usage(const char* prog)
+{
+	printf("Usage: %s [options]\n"
+	       "  --workload wash|init|mixed|upload|aspirate|cycle\n"
+	       "                              recipe commands to run (default wash)\n"
+	       "  --jobs N                    number of jobs (default 100)\n"
+	       "  --parallel N                jobs kept in flight (default 1)\n"
+	       "  --bitrate BPS               CAN bitrate (default 1000000)\n"
+	       "  --cycle-ms MS               machine cycle for --workload cycle (default APP_CYCLE_MS)\n"
+	       "  --latency-scale K           executor latency multiplier (default 1.0)\n"
+	       "  --fail-rate P               probability of executor error response\n"
+	       "  --drop-rate P               probability of lost executor response\n"
+	       "  --dup-rate P                probability of duplicated executor response\n"
+	       "  --usb-loss P                send commands with sequence numbers, corrupt P of them and lose P of ACKs\n"
+	       "  --cancel-every N            cancel every N-th started job 1 s after start (JOB_CONTROL)\n"
+	       "  --seed N                    RNG seed for fault injection (default 1)\n"
+	       "  --max-time S                virtual time limit, seconds\n"
+	       "  --trace FILE                dump the job trace of the run (JOB_TRACE) to FILE\n"
+	       "  --replay FILE               replay a job trace and check dispatcher outputs against it\n"
+	       "  --check                     run protocol checks (responses counted per command)\n"
+	       "  --verbose                   print dispatcher output\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+	static const struct option options[] = {
+		{ "workload",      required_argument, NULL, 'w' },
+		{ "jobs",          required_argument, NULL, 'j' },
+		{ "parallel",      required_argument, NULL, 'p' },
+		{ "bitrate",       required_argument, NULL, 'b' },
+		{ "cycle-ms",      required_argument, NULL, 'c' },
+		{ "latency-scale", required_argument, NULL, 'l' },
+		{ "fail-rate",     required_argument, NULL, 'f' },
+		{ "drop-rate",     required_argument, NULL, 'd' },
+		{ "dup-rate",      required_argument, NULL, 'u' },
+		{ "usb-loss",      required_argument, NULL, 'L' },
+		{ "cancel-every",  required_argument, NULL, 'x' },
+		{ "seed",          required_argument, NULL, 's' },
+		{ "max-time",      required_argument, NULL, 't' },
+		{ "trace",         required_argument, NULL, 'T' },
+		{ "replay",        required_argument, NULL, 'R' },
+		{ "check",         no_argument,       NULL, 'C' },
+		{ "verbose",       no_argument,       NULL, 'v' },
+		{ "help",          no_argument,       NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "w:j:p:b:c:l:f:d:u:L:x:s:t:T:R:Cvh", options, NULL)) != -1) {
+		switch (opt) {
+			case 'w':
+				if (strcmp(optarg, "wash") == 0) g_cfg.workload = WORKLOAD_WASH;
+				else if (strcmp(optarg, "init") == 0) g_cfg.workload = WORKLOAD_INIT;
+				else if (strcmp(optarg, "mixed") == 0) g_cfg.workload = WORKLOAD_MIXED;
+				else if (strcmp(optarg, "upload") == 0) g_cfg.workload = WORKLOAD_UPLOAD;
+				else if (strcmp(optarg, "aspirate") == 0) g_cfg.workload = WORKLOAD_ASPIRATE;
+				else if (strcmp(optarg, "cycle") == 0) g_cfg.workload = WORKLOAD_CYCLE;
+				else { print_usage(argv[0]); return 2; }
+				break;
+			case 'j': g_cfg.jobs = (uint32_t)strtoul(optarg, NULL, 0); break;
+			case 'p': g_cfg.parallel = (uint32_t)strtoul(optarg, NULL, 0); break;
+			case 'b': g_cfg.bitrate = (uint32_t)strtoul(optarg, NULL, 0); break;
+			case 'c': g_cfg.cycle_ms = (uint32_t)strtoul(optarg, NULL, 0); break;
+			case 'l': g_cfg.latency_scale = strtod(optarg, NULL); break;
+			case 'f': g_cfg.fail_rate = strtod(optarg, NULL); break;
+			case 'd': g_cfg.drop_rate = strtod(optarg, NULL); break;
+			case 'u': g_cfg.dup_rate = strtod(optarg, NULL); break;
+			case 'L': g_cfg.usb_loss = strtod(optarg, NULL); break;
+			case 'x': g_cfg.cancel_every = (uint32_t)strtoul(optarg, NULL, 0); break;
+			case 's': g_cfg.seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+			case 't': g_cfg.max_time_s = strtod(optarg, NULL); break;
+			case 'T': g_cfg.trace_path = optarg; break;
+			case 'R': g_cfg.replay_path = optarg; break;
+			case 'C': g_cfg.check = 1; break;
+			case 'v': g_cfg.verbose = 1; break;
+			default:
+				print_usage(argv[0]);
+				return (opt == 'h') ? 0 : 2;
+			}
+		}
+	if (g_cfg.parallel == 0) g_cfg.parallel = 1;
+
+	struct timespec wall_start, wall_end;
+	clock_gettime(CLOCK_MONOTONIC, &wall_start);
+	int result = (g_cfg.replay_path != NULL) ? run_replay(g_cfg.replay_path)
+	           : g_cfg.check ? run_checks() : run_simulation();
+	if (result != 2 && g_cfg.trace_path != NULL && save_trace(g_cfg.trace_path) != 0) {
+		result = 2;
+		}
+	clock_gettime(CLOCK_MONOTONIC, &wall_end);
+
+	double wall_s = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+	double virtual_s = Sim_NowUs() / 1e6;
+	printf("Wall time:   %.3f s (x%.0f faster than real time)\n",
+	       wall_s, (wall_s > 0.0) ? virtual_s / wall_s : 0.0);
+	return result;
+}
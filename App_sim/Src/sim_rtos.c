@@ -0,0 +1,122 @@
+/*
+ * sim_rtos.c
+ *
+ * Виртуальное время, очереди и глобальные ресурсы, которые на плате
+ * создаются в main.c и task_dispatcher.c.
+ */
+
+#include "sim_rtos.h"
+#include "sim_bus.h"
+#include "shared_resources.h"
+#include "task_dispatcher.h"
+#include "app_init_checker.h"
+#include "Dispatcher/dispatcher_io.h"
+#include "Dispatcher/can_packer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint64_t g_now_us = 0;
+static SimUsbSink_t g_usb_sink = NULL;
+static SimDelayHook_t g_delay_hook = NULL;
+static SystemState_t g_system_state = SYS_STATE_POWER_ON;
+
+// --- Обработчики "очередей" ---
+
+static void can_tx_on_send(const void* item)
+{
+	SimBus_Submit((const CAN_Message_t*)item, g_now_us);
+}
+
+static void usb_tx_on_send(const void* item)
+{
+	const USB_TxPacket_t* packet = (const USB_TxPacket_t*)item;
+	if (g_usb_sink != NULL) {
+		g_usb_sink(packet->data, packet->length);
+		}
+}
+
+static SimQueue_t g_can_tx_queue = { .on_send = can_tx_on_send };
+static SimQueue_t g_usb_tx_queue = { .on_send = usb_tx_on_send };
+
+// --- Ресурсы из shared_resources.h ---
+
+QueueHandle_t usb_tx_queue_handle = NULL;
+QueueHandle_t can_rx_queue_handle = NULL;
+QueueHandle_t can_tx_queue_handle = NULL;
+QueueHandle_t log_queue_handle = NULL;
+StreamBufferHandle_t usb_rx_stream_buffer_handle = NULL;
+osSemaphoreId_t usb_tx_semHandle = NULL;
+
+void Sim_RtosInit(SimUsbSink_t usb_sink)
+{
+	g_now_us = 0;
+	g_usb_sink = usb_sink;
+	g_system_state = SYS_STATE_INITIALIZING;
+	can_tx_queue_handle = &g_can_tx_queue;
+	usb_tx_queue_handle = &g_usb_tx_queue;
+}
+
+uint64_t Sim_NowUs(void)
+{
+	return g_now_us;
+}
+
+void Sim_AdvanceTo(uint64_t time_us)
+{
+	if (time_us > g_now_us) {
+		g_now_us = time_us;
+		}
+}
+
+void Sim_SetDelayHook(SimDelayHook_t hook)
+{
+	g_delay_hook = hook;
+}
+
+bool Sim_IsSystemReady(void)
+{
+	return g_system_state == SYS_STATE_READY;
+}
+
+// --- FreeRTOS / CMSIS / HAL ---
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks_to_wait)
+{
+	(void)ticks_to_wait;
+	if (queue == NULL || queue->on_send == NULL) {
+		return pdFAIL;
+		}
+	queue->on_send(item);
+	return pdPASS;
+}
+
+osStatus_t osDelay(uint32_t ticks)
+{
+	if (g_delay_hook != NULL) {
+		g_delay_hook(ticks);
+		}
+	return osOK;
+}
+
+uint32_t HAL_GetTick(void)
+{
+	return (uint32_t)(g_now_us / 1000);
+}
+
+void Error_Handler(void)
+{
+	fprintf(stderr, "SIM: Error_Handler called\n");
+	abort();
+}
+
+// --- Состояние системы (на плате - task_dispatcher.c) ---
+
+void SetSystemReady(void)
+{
+	g_system_state = SYS_STATE_READY;
+}
+
+SystemState_t GetSystemState(void)
+{
+	return g_system_state;
+}
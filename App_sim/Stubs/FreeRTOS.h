@@ -0,0 +1,27 @@
+/*
+ * FreeRTOS.h (App_sim)
+ *
+ * Заглушка FreeRTOS для хост-сборки диспетчера: только типы и макросы,
+ * которые используются в App/Src/Dispatcher.
+ */
+
+#ifndef SIM_STUBS_FREERTOS_H_
+#define SIM_STUBS_FREERTOS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int32_t  BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE         ((BaseType_t)0)
+#define pdTRUE          ((BaseType_t)1)
+#define pdPASS          pdTRUE
+#define pdFAIL          pdFALSE
+#define portMAX_DELAY   ((TickType_t)0xFFFFFFFFUL)
+
+// Тик симулятора равен 1 мс (как configTICK_RATE_HZ = 1000 на плате)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+#endif /* SIM_STUBS_FREERTOS_H_ */
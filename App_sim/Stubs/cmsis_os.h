@@ -0,0 +1,24 @@
+/*
+ * cmsis_os.h (App_sim)
+ *
+ * Заглушка CMSIS-RTOS v2: симулятор однопоточный, задержки не нужны.
+ */
+
+#ifndef SIM_STUBS_CMSIS_OS_H_
+#define SIM_STUBS_CMSIS_OS_H_
+
+#include "FreeRTOS.h"
+
+typedef enum {
+	osOK = 0,
+	osError = -1
+} osStatus_t;
+
+typedef void* osSemaphoreId_t;
+typedef void* osThreadId_t;
+
+#define osWaitForever   0xFFFFFFFFU
+
+osStatus_t osDelay(uint32_t ticks);
+
+#endif /* SIM_STUBS_CMSIS_OS_H_ */
@@ -0,0 +1,15 @@
+/*
+ * main.h (App_sim)
+ *
+ * Заглушка HAL: время берется из виртуальных часов симулятора.
+ */
+
+#ifndef SIM_STUBS_MAIN_H_
+#define SIM_STUBS_MAIN_H_
+
+#include <stdint.h>
+
+uint32_t HAL_GetTick(void);
+void Error_Handler(void);
+
+#endif /* SIM_STUBS_MAIN_H_ */
@@ -0,0 +1,21 @@
+/*
+ * queue.h (App_sim)
+ *
+ * Очередь симулятора: вместо буфера каждая "очередь" передает элемент
+ * получателю сразу при отправке (шина CAN, приемник USB).
+ */
+
+#ifndef SIM_STUBS_QUEUE_H_
+#define SIM_STUBS_QUEUE_H_
+
+#include "FreeRTOS.h"
+
+typedef struct SimQueue {
+	void (*on_send)(const void* item); // Получатель элемента
+} SimQueue_t;
+
+typedef SimQueue_t* QueueHandle_t;
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks_to_wait);
+
+#endif /* SIM_STUBS_QUEUE_H_ */
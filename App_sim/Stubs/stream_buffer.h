@@ -0,0 +1,12 @@
+/*
+ * stream_buffer.h (App_sim)
+ */
+
+#ifndef SIM_STUBS_STREAM_BUFFER_H_
+#define SIM_STUBS_STREAM_BUFFER_H_
+
+#include "FreeRTOS.h"
+
+typedef void* StreamBufferHandle_t;
+
+#endif /* SIM_STUBS_STREAM_BUFFER_H_ */
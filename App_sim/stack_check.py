@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""
+Статическая проверка глубины стека диспетчера по графу вызовов GCC
+(-fcallgraph-info=su, файлы *.ci рядом с объектными файлами).
+
+Для каждой точки входа задачи считается худший путь вызовов: сумма кадров
+функций по самой "глубокой" цепочке. Рекурсия (цикл в графе) - ошибка:
+глубина стека перестает быть ограниченной.
+
+Косвенные вызовы (указатели на функции) в графе GCC не раскрыты; известные
+цели задаются параметром --indirect. Функции библиотеки и заглушек
+(snprintf, xQueueSend) в граф не входят - бюджет задается с запасом на них.
+
+    stack_check.py --root JobManager_Run:2048 --indirect 'JobManager_CompleteJob=CycleScheduler_*' build/app/Dispatcher/*.ci
+"""
+
+import argparse
+import fnmatch
+import re
+import sys
+
+NODE_RE = re.compile(r'node: \{ title: "([^"]+)" label: "([^"]*)"')
+EDGE_RE = re.compile(r'edge: \{ sourcename: "([^"]+)" targetname: "([^"]+)"')
+BYTES_RE = re.compile(r'\\n(\d+) bytes \(([^)]+)\)')
+INDIRECT = "__indirect_call"
+
+
+def base_name(title):
+    """file.c:func.part.0 -> func"""
+    return title.rsplit(":", 1)[-1].split(".", 1)[0]
+
+
+def load(paths):
+    frames, kinds, edges = {}, {}, {}
+    for path in paths:
+        with open(path, encoding="utf-8", errors="replace") as f:
+            for line in f:
+                m = NODE_RE.match(line)
+                if m:
+                    b = BYTES_RE.search(m.group(2))
+                    if b:
+                        frames[m.group(1)] = int(b.group(1))
+                        kinds[m.group(1)] = b.group(2)
+                    continue
+                m = EDGE_RE.match(line)
+                if m:
+                    edges.setdefault(m.group(1), set()).add(m.group(2))
+    return frames, kinds, edges
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--root", action="append", default=[], help="FUNC:BUDGET_BYTES - точка входа задачи")
+    ap.add_argument("--indirect", action="append", default=[], help="CALLER=PATTERN[,PATTERN] - цели косвенного вызова")
+    ap.add_argument("ci", nargs="+")
+    args = ap.parse_args()
+
+    frames, kinds, edges = load(args.ci)
+    by_name = {}
+    for title in frames:
+        by_name.setdefault(base_name(title), []).append(title)
+
+    indirect = {}
+    for spec in args.indirect:
+        caller, patterns = spec.split("=", 1)
+        targets = [t for t in frames if any(fnmatch.fnmatch(base_name(t), p) for p in patterns.split(","))]
+        if not targets:
+            sys.exit("stack_check: no functions match --indirect " + spec)
+        indirect.setdefault(caller, []).extend(targets)
+
+    def callees(title):
+        out = []
+        for target in edges.get(title, ()):
+            if target == INDIRECT:
+                out.extend(indirect.get(base_name(title), []))
+            elif target in frames:
+                out.append(target)
+            else:
+                out.extend(by_name.get(target, []))  # Вызов из другого файла; нет в графе - библиотека
+        return out
+
+    unresolved = sorted({base_name(t) for t, es in edges.items() if INDIRECT in es and base_name(t) not in indirect})
+    memo, on_path, errors = {}, [], []
+
+    def depth(title):
+        if title in memo:
+            return memo[title]
+        if title in on_path:
+            cycle = on_path[on_path.index(title):] + [title]
+            errors.append("recursion: " + " > ".join(base_name(t) for t in cycle))
+            return 0, [title]
+        on_path.append(title)
+        best, best_path = 0, []
+        for callee in callees(title):
+            d, p = depth(callee)
+            if d > best:
+                best, best_path = d, p
+        on_path.pop()
+        if not kinds[title].startswith("static") and kinds[title] != "dynamic,bounded":
+            errors.append("unbounded frame: " + base_name(title))
+        memo[title] = (frames[title] + best, [title] + best_path)
+        return memo[title]
+
+    for spec in args.root:
+        name, budget = spec.rsplit(":", 1)
+        titles = by_name.get(name)
+        if not titles:
+            sys.exit("stack_check: root " + name + " not found")
+        total, path = max(depth(t) for t in titles)
+        status = "ok" if total <= int(budget) else "OVER"
+        print("%-36s %6d / %-6s %s  %s" % (name, total, budget, status, " > ".join(base_name(t) for t in path)))
+        if status != "ok":
+            errors.append("%s needs %d bytes, budget %s" % (name, total, budget))
+
+    for name in unresolved:
+        print("note: indirect call in %s is not resolved (--indirect)" % name)
+    for e in sorted(set(errors)):
+        print("stack_check: " + e, file=sys.stderr)
+    return 1 if errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,796 @@
+"""
+Компилятор рецептов Дирижера и быстрый симулятор их выполнения.
+
+Переводит читаемое описание рецепта (*.rcp) в байт-код JobManager'а
+(RecipeInstr_t, см. App/Inc/Dispatcher/recipe_store.h), прогоняет его по
+модели исполнителей и печатает ожидаемую длительность, критический путь и
+конфликты ресурсов. Готовый рецепт можно вставить в recipe_store.c (--c)
+или загрузить на плату командой RECIPE_UPLOAD (--upload).
+
+Примеры:
+    python recipe_compiler.py recipes/dispenser_wash.rcp --args 1,1000,2
+    python recipe_compiler.py recipes/dispenser_wash.rcp --c
+    python recipe_compiler.py a.rcp b.rcp                # общие ресурсы двух рецептов
+    python recipe_compiler.py recipes/dispenser_wash.rcp --upload /dev/ttyACM0
+
+Формат описания - см. readme/recipe_compiler.md.
+"""
+
+import argparse
+import re
+import sys
+import time
+import zlib
+
+# --- Байт-код (recipe_store.h) ---
+
+OP_END = 0x00
+OP_ROTATE_MOTOR = 0x01
+OP_START_PUMP = 0x02
+OP_STOP_PUMP = 0x03
+OP_WAIT_MS = 0x04
+OP_HOME_MOTOR = 0x05
+OP_PAR_BEGIN = 0x10
+OP_PAR_END = 0x11
+OP_LOOP = 0x12
+OP_END_LOOP = 0x13
+OP_JUMP = 0x14
+OP_JUMP_UNLESS_ARG = 0x15
+OP_BRANCH_IF_FAIL = 0x16
+
+ACTION_OPS = (OP_ROTATE_MOTOR, OP_START_PUMP, OP_STOP_PUMP, OP_WAIT_MS, OP_HOME_MOTOR)
+MOTOR_OPS = (OP_ROTATE_MOTOR, OP_HOME_MOTOR)
+PUMP_OPS = (OP_START_PUMP, OP_STOP_PUMP)
+
+RECIPE_MAX_ARGS = 4
+RECIPE_MAX_LENGTH = 255
+RECIPE_MAX_LOOP_DEPTH = 2
+RECIPE_VALUE_SCALE = 1000
+RECIPE_STORE_MAX_ID = 32
+APP_MAX_STEP_ACTIONS = 8
+MAX_BINARY_ARGS_SIZE = 64
+RES_MOTOR_COUNT = 12
+RES_PUMP_COUNT = 8
+
+# Маски ресурсов (RES_*), кроме моторов и насосов: их задание захватывает по инструкциям
+RESOURCE_NAMES = {
+    'PROBE': 1 << 28,
+    'WASH_STATION': (1 << (12 + 3 - 1)) | (1 << 20) | (1 << 21),
+    'MIXER': 1 << (9 - 1),
+    'REACTION_DISK': 1 << (10 - 1),
+    'ALL': 0xFFFFFFFF,
+}
+
+ARG_SIZES = {'u8': 1, 'u16': 2, 'u32': 4}
+
+# Профили движения (App/Src/Dispatcher/motion_profile.c): имя -> (номер, скорость шаг/с)
+MOTION_PROFILE_FLAG = 0x8000
+MOTION_PROFILES = {
+    'CREEP': (0, 100),
+    'HOME_FINE': (1, 150),
+    'INDEX_STEP': (2, 200),
+    'NORMAL': (3, 400),
+    'TRAVEL': (4, 500),
+    'FAST': (5, 800),
+    'MIXER': (6, 1000),
+}
+
+# --- Модель исполнителей (как App_sim/Src/sim_executors.c) ---
+
+MOTOR_LATENCY_MS = 2.0        # Задержка исполнителя моторов
+MOTOR_HOME_TRAVEL_STEPS = 400 # Путь поиска "дома"
+PUMP_LATENCY_MS = 5.0         # Переключение насоса
+CAN_BITRATE = 1000000
+CAN_FRAME_MS = (47 + 8 * 8) * 1000.0 / CAN_BITRATE  # Кадр Classic CAN с 8 байтами данных
+
+# --- Протокол USB (как test_suite.py) ---
+
+CMD_RECIPE_UPLOAD = 0x1007
+UPLOAD_CHUNK_INSTRUCTIONS = 5   # 2 + 5 * 12 байт укладываются в MAX_BINARY_ARGS_SIZE
+
+
+class RecipeError(Exception):
+    """Ошибка в описании рецепта (с номером строки)."""
+
+
+class Instr:
+    """Одна инструкция RecipeInstr_t."""
+
+    def __init__(self, op, device=0, dev_bind=0, val_bind=0, value=0, speed=0, timeout_ms=0, line=0):
+        self.op = op
+        self.device = device
+        self.dev_bind = dev_bind
+        self.val_bind = val_bind
+        self.value = value
+        self.speed = speed
+        self.timeout_ms = timeout_ms
+        self.line = line      # Строка описания - для сообщений
+        self.target = None    # Метка перехода до разрешения адресов
+
+    def wire(self) -> bytes:
+        """12 байт в формате RECIPE_UPLOAD (Big-endian)."""
+        return (bytes([self.op, self.device, self.dev_bind, self.val_bind]) +
+                (self.value & 0xFFFFFFFF).to_bytes(4, 'big') +
+                self.speed.to_bytes(2, 'big') + self.timeout_ms.to_bytes(2, 'big'))
+
+
+class Arg:
+    def __init__(self, name, offset, size, min_value, max_value, default):
+        self.name = name
+        self.offset = offset
+        self.size = size
+        self.min_value = min_value
+        self.max_value = max_value
+        self.default = default
+
+
+class Recipe:
+    def __init__(self, name):
+        self.name = name
+        self.recipe_id = 0
+        self.resources = 0
+        self.args = []
+        self.code = []
+
+    def arg_index(self, name, line):
+        for i, arg in enumerate(self.args):
+            if arg.name == name:
+                return i
+        raise RecipeError(f"line {line}: unknown argument '{name}'")
+
+
+# =====================================================================================
+# ===                                    КОМПИЛЯТОР                                  ===
+# =====================================================================================
+
+DEVICE_BIND_RE = re.compile(r'^(\d+)\+(\d+)\*\((\w+)-1\)$')   # 1+2*(dispenser-1)
+VALUE_BIND_RE = re.compile(r'^(\w+)\*(-?[\d.]+)$')              # volume*0.5
+
+
+def parse_int(text, line):
+    try:
+        return int(text, 0)
+    except ValueError:
+        raise RecipeError(f"line {line}: '{text}' is not a number")
+
+
+def parse_options(tokens, line, allowed):
+    """Разбирает пары 'ключ значение' после операнда устройства."""
+    if len(tokens) % 2 != 0:
+        raise RecipeError(f"line {line}: expected 'key value' pairs, got '{' '.join(tokens)}'")
+    options = {}
+    for key, value in zip(tokens[0::2], tokens[1::2]):
+        if key not in allowed:
+            raise RecipeError(f"line {line}: unknown option '{key}'")
+        options[key] = value
+    return options
+
+
+def parse_speed(opts, line):
+    """'speed S' или 'profile NAME' -> поле speed инструкции (MOTION_PROFILE(n) для профиля)."""
+    if 'profile' in opts:
+        if 'speed' in opts:
+            raise RecipeError(f"line {line}: 'speed' and 'profile' are mutually exclusive")
+        name = opts['profile'].upper()
+        if name not in MOTION_PROFILES:
+            raise RecipeError(f"line {line}: unknown motion profile '{opts['profile']}' ({', '.join(MOTION_PROFILES)})")
+        return MOTION_PROFILE_FLAG | MOTION_PROFILES[name][0]
+    speed = parse_int(opts.get('speed', '0'), line)
+    if not 0 <= speed < MOTION_PROFILE_FLAG:
+        raise RecipeError(f"line {line}: speed must be 0..{MOTION_PROFILE_FLAG - 1}")
+    return speed
+
+
+def profile_name(speed):
+    """Имя профиля по полю speed или None для скорости без профиля."""
+    for name, (index, _) in MOTION_PROFILES.items():
+        if speed == MOTION_PROFILE_FLAG | index:
+            return name
+    return None
+
+
+def instr_speed(instr):
+    """Скорость движения, шаг/с (как MotionProfile_Speed)."""
+    if instr.speed & MOTION_PROFILE_FLAG:
+        name = profile_name(instr.speed)
+        return MOTION_PROFILES[name][1] if name else 0
+    return instr.speed
+
+
+def parse_device(recipe, kind, tokens, line):
+    """'motor 3' или 'motor 1+2*(dispenser-1)' -> (device, dev_bind)."""
+    if len(tokens) < 2 or tokens[0] != kind:
+        raise RecipeError(f"line {line}: expected '{kind} N'")
+    match = DEVICE_BIND_RE.match(tokens[1])
+    if match:
+        stride = int(match.group(2))
+        if stride > 15:
+            raise RecipeError(f"line {line}: device stride must be 0..15")
+        arg = recipe.arg_index(match.group(3), line)
+        return int(match.group(1)), ((arg + 1) << 4) | stride
+    return parse_int(tokens[1], line), 0
+
+
+def parse_value(recipe, text, line):
+    """'500' или 'volume*0.5' -> (value, val_bind)."""
+    match = VALUE_BIND_RE.match(text)
+    if match:
+        arg = recipe.arg_index(match.group(1), line)
+        return round(float(match.group(2)) * RECIPE_VALUE_SCALE), arg + 1
+    return parse_int(text, line), 0
+
+
+def add_dependencies(recipe, blocks, after, line):
+    """'after 0,2' у действия блока par: номера действий блока, которые должны завершиться раньше."""
+    if after is None:
+        return
+    if not blocks or blocks[-1][0] != 'par':
+        raise RecipeError(f"line {line}: 'after' is only allowed inside 'par'")
+    begin = recipe.code[blocks[-1][1]]
+    index = len(recipe.code) - blocks[-1][1] - 2   # Номер только что добавленного действия в блоке
+    for dep in after.split(','):
+        dep = parse_int(dep, line)
+        if not 0 <= dep < index:
+            raise RecipeError(f"line {line}: action {index} can only depend on earlier actions 0..{index - 1}")
+        begin.value |= 1 << (index * (index - 1) // 2 + dep)
+
+
+def action_deps(begin, index):
+    """Маска предшественников действия index блока (RECIPE_DEPS_OF)."""
+    return (begin.value >> (index * (index - 1) // 2)) & ((1 << index) - 1)
+
+
+def compile_recipe(source, name='recipe'):
+    """Переводит текст описания в Recipe с разрешенными адресами переходов."""
+    recipe = Recipe(name)
+    blocks = []          # Открытые блоки: (вид, адрес начала)
+    labels = {}
+    arg_offset = 0
+
+    for line_no, raw in enumerate(source.splitlines(), start=1):
+        text = raw.split('#', 1)[0].strip()
+        if not text:
+            continue
+        if text.endswith(':'):
+            labels[text[:-1]] = len(recipe.code)
+            continue
+        tokens = text.split()
+        word = tokens[0]
+        emit = recipe.code.append
+
+        if word == 'recipe':
+            recipe.name = tokens[1]
+            if len(tokens) == 4 and tokens[2] == 'id':
+                recipe.recipe_id = parse_int(tokens[3], line_no)
+        elif word == 'resources':
+            for res in tokens[1:]:
+                if res not in RESOURCE_NAMES:
+                    raise RecipeError(f"line {line_no}: unknown resource '{res}' ({', '.join(RESOURCE_NAMES)})")
+                recipe.resources |= RESOURCE_NAMES[res]
+        elif word == 'arg':
+            # arg NAME u8|u16|u32 MIN..MAX = DEFAULT
+            match = re.match(r'^arg\s+(\w+)\s+(u8|u16|u32)\s+(-?\w+)\.\.(-?\w+)\s*=\s*(-?\w+)$', text)
+            if not match:
+                raise RecipeError(f"line {line_no}: expected 'arg NAME u8|u16|u32 MIN..MAX = DEFAULT'")
+            size = ARG_SIZES[match.group(2)]
+            recipe.args.append(Arg(match.group(1), arg_offset, size, parse_int(match.group(3), line_no),
+                                   parse_int(match.group(4), line_no), parse_int(match.group(5), line_no)))
+            arg_offset += size
+        elif word == 'rotate':
+            device, dev_bind = parse_device(recipe, 'motor', tokens[1:3], line_no)
+            opts = parse_options(tokens[3:], line_no, ('steps', 'speed', 'profile', 'timeout', 'after'))
+            value, val_bind = parse_value(recipe, opts.get('steps', '0'), line_no)
+            emit(Instr(OP_ROTATE_MOTOR, device, dev_bind, val_bind, value,
+                       parse_speed(opts, line_no), parse_int(opts.get('timeout', '0'), line_no), line_no))
+            add_dependencies(recipe, blocks, opts.get('after'), line_no)
+        elif word == 'home':
+            device, dev_bind = parse_device(recipe, 'motor', tokens[1:3], line_no)
+            opts = parse_options(tokens[3:], line_no, ('speed', 'profile', 'timeout', 'after'))
+            emit(Instr(OP_HOME_MOTOR, device, dev_bind, 0, 0,
+                       parse_speed(opts, line_no), parse_int(opts.get('timeout', '0'), line_no), line_no))
+            add_dependencies(recipe, blocks, opts.get('after'), line_no)
+        elif word in ('pump_on', 'pump_off'):
+            device, dev_bind = parse_device(recipe, 'pump', tokens[1:3], line_no)
+            opts = parse_options(tokens[3:], line_no, ('timeout', 'after'))
+            emit(Instr(OP_START_PUMP if word == 'pump_on' else OP_STOP_PUMP, device, dev_bind, 0, 0, 0,
+                       parse_int(opts.get('timeout', '0'), line_no), line_no))
+            add_dependencies(recipe, blocks, opts.get('after'), line_no)
+        elif word == 'wait':
+            opts = parse_options(tokens[2:], line_no, ('after',))
+            value, val_bind = parse_value(recipe, tokens[1], line_no)
+            emit(Instr(OP_WAIT_MS, val_bind=val_bind, value=value, line=line_no))
+            add_dependencies(recipe, blocks, opts.get('after'), line_no)
+        elif word == 'par':
+            blocks.append(('par', len(recipe.code)))
+            emit(Instr(OP_PAR_BEGIN, line=line_no))
+        elif word == 'loop':
+            # loop 3 или loop cycles (число проходов из аргумента)
+            if tokens[1][0].isdigit():
+                value, val_bind = parse_int(tokens[1], line_no), 0
+            else:
+                value, val_bind = RECIPE_VALUE_SCALE, recipe.arg_index(tokens[1], line_no) + 1
+            blocks.append(('loop', len(recipe.code)))
+            emit(Instr(OP_LOOP, val_bind=val_bind, value=value, line=line_no))
+        elif word == 'if':
+            # if ARG & MASK ... end: блок выполняется, если (ARG & MASK) != 0
+            match = re.match(r'^if\s+(\w+)\s*&\s*(\w+)$', text)
+            if not match:
+                raise RecipeError(f"line {line_no}: expected 'if ARG & MASK'")
+            blocks.append(('if', len(recipe.code)))
+            emit(Instr(OP_JUMP_UNLESS_ARG, device=parse_int(match.group(2), line_no),
+                       val_bind=recipe.arg_index(match.group(1), line_no) + 1, line=line_no))
+        elif word == 'end':
+            if not blocks:
+                raise RecipeError(f"line {line_no}: 'end' without block")
+            kind, start = blocks.pop()
+            if kind == 'par':
+                emit(Instr(OP_PAR_END, line=line_no))
+            elif kind == 'loop':
+                emit(Instr(OP_END_LOOP, line=line_no))
+            else:
+                recipe.code[start].value = len(recipe.code)
+        elif word == 'jump':
+            instr = Instr(OP_JUMP, line=line_no)
+            instr.target = tokens[1]
+            emit(instr)
+        elif word == 'on_fail':
+            instr = Instr(OP_BRANCH_IF_FAIL, line=line_no)
+            instr.target = tokens[1]
+            emit(instr)
+        elif word == 'stop':
+            emit(Instr(OP_END, line=line_no))
+        else:
+            raise RecipeError(f"line {line_no}: unknown statement '{word}'")
+
+    if blocks:
+        raise RecipeError(f"unclosed '{blocks[-1][0]}' block")
+    if not recipe.code or recipe.code[-1].op not in (OP_END, OP_JUMP):
+        recipe.code.append(Instr(OP_END))
+    for instr in recipe.code:
+        if instr.target is not None:
+            if instr.target not in labels:
+                raise RecipeError(f"line {instr.line}: unknown label '{instr.target}'")
+            instr.value = labels[instr.target]
+    validate(recipe)
+    return recipe
+
+
+def validate(recipe):
+    """Те же проверки, что Recipe_Validate на плате, с номерами строк описания."""
+    code = recipe.code
+    if len(code) > RECIPE_MAX_LENGTH:
+        raise RecipeError(f"program too long: {len(code)} > {RECIPE_MAX_LENGTH} instructions")
+    if len(recipe.args) > RECIPE_MAX_ARGS:
+        raise RecipeError(f"too many arguments: {len(recipe.args)} > {RECIPE_MAX_ARGS}")
+    if recipe.args and recipe.args[-1].offset + recipe.args[-1].size > MAX_BINARY_ARGS_SIZE:
+        raise RecipeError("arguments do not fit into one command")
+    for arg in recipe.args:
+        if not arg.min_value <= arg.default <= arg.max_value:
+            raise RecipeError(f"argument '{arg.name}': default outside {arg.min_value}..{arg.max_value}")
+    if recipe.resources == 0:
+        raise RecipeError("no resources declared (add a 'resources' line)")
+
+    depth = 0
+    for pc, instr in enumerate(code):
+        where = f"line {instr.line} (pc {pc})"
+        if instr.op in MOTOR_OPS + PUMP_OPS:
+            count = RES_MOTOR_COUNT if instr.op in MOTOR_OPS else RES_PUMP_COUNT
+            for device in device_range(recipe, instr):
+                if not 1 <= device <= count:
+                    raise RecipeError(f"{where}: device {device} out of range 1..{count}")
+        elif instr.op == OP_PAR_BEGIN:
+            n = 0
+            while pc + 1 + n < len(code) and code[pc + 1 + n].op in ACTION_OPS:
+                n += 1
+            if not 1 <= n <= APP_MAX_STEP_ACTIONS or code[pc + 1 + n].op != OP_PAR_END:
+                raise RecipeError(f"{where}: 'par' must hold 1..{APP_MAX_STEP_ACTIONS} actions and nothing else")
+            if instr.value >> (n * (n - 1) // 2):
+                raise RecipeError(f"{where}: dependency on an action outside the block")
+        elif instr.op == OP_LOOP:
+            depth += 1
+            if depth > RECIPE_MAX_LOOP_DEPTH:
+                raise RecipeError(f"{where}: loops nested deeper than {RECIPE_MAX_LOOP_DEPTH}")
+        elif instr.op == OP_END_LOOP:
+            depth -= 1
+        elif instr.op in (OP_JUMP, OP_JUMP_UNLESS_ARG, OP_BRANCH_IF_FAIL):
+            if not 0 <= instr.value < len(code):
+                raise RecipeError(f"{where}: jump target out of program")
+            target_loop, target_in_par = code_scope(code, instr.value)
+            if target_in_par:
+                raise RecipeError(f"{where}: jump into parallel block")
+            if target_loop != code_scope(code, pc)[0]:
+                raise RecipeError(f"{where}: jump into or out of loop body")
+
+
+def code_scope(code, pc):
+    """Область инструкции pc: (адрес LOOP самого вложенного цикла или None, внутри блока PAR).
+
+    LOOP относится к внешней области, END_LOOP - к телу своего цикла, PAR_END - к блоку.
+    """
+    loops = []
+    in_par = False
+    for i, instr in enumerate(code[:pc]):
+        if instr.op == OP_LOOP:
+            loops.append(i)
+        elif instr.op == OP_END_LOOP and loops:
+            loops.pop()
+        elif instr.op == OP_PAR_BEGIN:
+            in_par = True
+        elif instr.op == OP_PAR_END:
+            in_par = False
+    return (loops[-1] if loops else None), in_par
+
+
+def device_range(recipe, instr):
+    """Номера устройства инструкции при всех допустимых значениях аргумента привязки."""
+    if instr.dev_bind == 0:
+        return [instr.device]
+    arg = recipe.args[(instr.dev_bind >> 4) - 1]
+    stride = instr.dev_bind & 0x0F
+    return [instr.device + (n - 1) * stride for n in range(arg.min_value, arg.max_value + 1)]
+
+
+# =====================================================================================
+# ===                          СИМУЛЯТОР ВЫПОЛНЕНИЯ                                  ===
+# =====================================================================================
+
+def instr_value(instr, args):
+    if instr.val_bind == 0:
+        return instr.value
+    return int(args[instr.val_bind - 1] * instr.value / RECIPE_VALUE_SCALE)
+
+
+def instr_device(instr, args):
+    if instr.dev_bind == 0:
+        return instr.device
+    return instr.device + (args[(instr.dev_bind >> 4) - 1] - 1) * (instr.dev_bind & 0x0F)
+
+
+def action_resource(instr, args):
+    """Имя устройства действия ('motor3', 'pump1') или None для паузы."""
+    if instr.op in MOTOR_OPS:
+        return f"motor{instr_device(instr, args)}"
+    if instr.op in PUMP_OPS:
+        return f"pump{instr_device(instr, args)}"
+    return None
+
+
+def action_duration_ms(instr, args):
+    """Время действия по модели исполнителей, включая кадры команды и ответа."""
+    if instr.op == OP_WAIT_MS:
+        return float(max(instr_value(instr, args), 0))
+    if instr.op == OP_ROTATE_MOTOR:
+        speed = instr_speed(instr) or 1
+        # Перед движением - кадр CMD_SET_SPEED, если мотор настроен иначе (худший случай)
+        return 3 * CAN_FRAME_MS + MOTOR_LATENCY_MS + abs(instr_value(instr, args)) * 1000.0 / speed
+    if instr.op == OP_HOME_MOTOR:
+        speed = instr_speed(instr) or 1
+        return 3 * CAN_FRAME_MS + MOTOR_LATENCY_MS + MOTOR_HOME_TRAVEL_STEPS * 1000.0 / speed
+    return 2 * CAN_FRAME_MS + PUMP_LATENCY_MS
+
+
+def describe(instr, args):
+    names = {OP_ROTATE_MOTOR: 'rotate', OP_HOME_MOTOR: 'home', OP_START_PUMP: 'pump_on',
+             OP_STOP_PUMP: 'pump_off', OP_WAIT_MS: 'wait'}
+    res = action_resource(instr, args)
+    if instr.op == OP_ROTATE_MOTOR:
+        return f"rotate {res} {instr_value(instr, args)} steps"
+    if instr.op == OP_WAIT_MS:
+        return f"wait {instr_value(instr, args)} ms"
+    return f"{names[instr.op]} {res}"
+
+
+def simulate(recipe, args):
+    """
+    Выполняет программу как JobManager (успешный путь, без ветвлений по ошибке).
+    Возвращает список шагов: (начало мс, длительность мс, действия, критическое действие).
+    """
+    code = recipe.code
+    steps = []
+    warnings = []
+    now = 0.0
+    pc = 0
+    loops = []   # (адрес начала тела, осталось проходов)
+    slack = {}   # Адрес действия вне критического пути -> запас, мс
+    budget = 100000
+
+    while budget > 0:
+        budget -= 1
+        instr = code[pc]
+        op = instr.op
+        if op == OP_END:
+            break
+        if op == OP_JUMP:
+            pc = instr.value
+        elif op == OP_JUMP_UNLESS_ARG:
+            pc = instr.value if (args[instr.val_bind - 1] & instr.device) == 0 else pc + 1
+        elif op == OP_BRANCH_IF_FAIL:
+            pc += 1
+        elif op == OP_LOOP:
+            count = instr_value(instr, args)
+            if count <= 0:
+                depth = 0   # Пропуск тела до парного END_LOOP
+                while True:
+                    pc += 1
+                    if code[pc].op == OP_LOOP:
+                        depth += 1
+                    elif code[pc].op == OP_END_LOOP:
+                        if depth == 0:
+                            break
+                        depth -= 1
+                pc += 1
+            else:
+                loops.append([pc + 1, count])
+                pc += 1
+        elif op == OP_END_LOOP:
+            loops[-1][1] -= 1
+            if loops[-1][1] > 0:
+                pc = loops[-1][0]
+            else:
+                loops.pop()
+                pc += 1
+        else:
+            begin = instr if op == OP_PAR_BEGIN else None
+            if begin is not None:
+                first = pc + 1
+                last = first
+                while code[last].op != OP_PAR_END:
+                    last += 1
+                actions = code[first:last]
+                pc = last + 1
+            else:
+                actions = [instr]
+                pc += 1
+
+            # Действие стартует после своих предшественников (граф зависимостей блока);
+            # команды одному устройству исполнитель выполняет по очереди
+            busy_until = {}
+            busy_before = {}   # Последнее действие шага на устройстве
+            finish = []
+            for index, action in enumerate(actions):
+                deps = action_deps(begin, index) if begin is not None else 0
+                ready = max([now] + [finish[d][0] for d in range(index) if deps & (1 << d)])
+                res = action_resource(action, args)
+                start = max(ready, busy_until.get(res, ready)) if res else ready
+                if res in busy_until and busy_until[res] > ready:
+                    warnings.append(f"pc {code.index(action)}: {res} is still busy in this step - executor serializes it")
+                end = start + action_duration_ms(action, args)
+                if res:
+                    busy_until[res] = end
+                finish.append((end, action, deps, busy_before.get(res), start))
+                if res:
+                    busy_before[res] = index
+
+            # Критический путь шага: от последнего завершившегося действия назад
+            # через предшественника (или занятое устройство), завершившегося позже всех
+            index = max(range(len(actions)), key=lambda i: finish[i][0])
+            end = finish[index][0]
+            path = []
+            while index is not None:
+                end_i, action, deps, busy_prev, _ = finish[index]
+                preds = [d for d in range(index) if deps & (1 << d)]
+                if busy_prev is not None:
+                    preds.append(busy_prev)
+                prev = max(preds, key=lambda d: finish[d][0]) if preds else None
+                path.append((action, end_i - (finish[prev][0] if prev is not None else now)))
+                index = prev
+            # Запас действий вне пути: сколько они могли бы длиться дольше, не задерживая шаг
+            on_path = {id(a) for a, _ in path}
+            for i, (end_i, action, _, _, _) in enumerate(finish):
+                if id(action) not in on_path:
+                    needed = [f[4] for j, f in enumerate(finish) if j > i and (f[2] & (1 << i) or f[3] == i)]
+                    slack.setdefault(code.index(action), min(needed + [end]) - end_i)
+            steps.append((now, end - now, actions, path[::-1]))
+            now = end
+    else:
+        warnings.append("program did not reach END (endless loop?)")
+    return steps, slack, warnings
+
+
+def job_resources(recipe, args):
+    """Ресурсы задания: заявленные модули + устройства всех действий (как JobManager_CollectDevices)."""
+    devices = {action_resource(i, args) for i in recipe.code if i.op in MOTOR_OPS + PUMP_OPS}
+    modules = {name for name, mask in RESOURCE_NAMES.items()
+               if name != 'ALL' and (recipe.resources & mask) == mask}
+    if recipe.resources == RESOURCE_NAMES['ALL']:
+        modules = {'ALL'}
+    return devices | modules
+
+
+def print_report(recipe, args):
+    steps, slack, warnings = simulate(recipe, args)
+    total = steps[-1][0] + steps[-1][1] if steps else 0.0
+    print(f"Recipe {recipe.name}: {len(recipe.code)} instructions, args {args}")
+    print(f"Expected duration: {total:.1f} ms ({len(steps)} steps)")
+
+    # Критический путь: шаги выполняются последовательно, внутри шага - цепочка
+    # зависимостей, определившая его длительность; суммируем по инструкциям
+    by_instr = {}
+    for start, duration, actions, path in steps:
+        for action, time_on_path in path:
+            entry = by_instr.setdefault(recipe.code.index(action), [0, 0.0, action])
+            entry[0] += 1
+            entry[1] += time_on_path
+    print("Critical path (by time share):")
+    for pc, (count, duration, action) in sorted(by_instr.items(), key=lambda e: -e[1][1]):
+        share = 100.0 * duration / total if total else 0.0
+        print(f"  pc {pc:3d} line {action.line:3d}  {describe(action, args):28s} x{count:<3d} {duration:9.1f} ms  {share:5.1f} %")
+
+    for pc, margin in sorted(slack.items()):
+        action = recipe.code[pc]
+        print(f"  off path: pc {pc:3d} line {action.line:3d}  {describe(action, args):28s} slack {margin:9.1f} ms")
+    for warning in dict.fromkeys(warnings):
+        print(f"WARNING: {warning}")
+
+
+def print_conflicts(recipes, args_list):
+    """Пары рецептов с общими ресурсами: планировщик выполнит их задания только по очереди."""
+    resources = [job_resources(r, a) for r, a in zip(recipes, args_list)]
+    for i in range(len(recipes)):
+        for j in range(i + 1, len(recipes)):
+            shared = resources[i] & resources[j]
+            if 'ALL' in resources[i] | resources[j]:
+                shared = {'ALL'}   # Монопольный рецепт конфликтует с любым
+            if shared:
+                print(f"Conflict: {recipes[i].name} and {recipes[j].name} share {', '.join(sorted(shared))} - jobs run one after another")
+            else:
+                print(f"No conflict: {recipes[i].name} and {recipes[j].name} can run in parallel")
+
+
+# =====================================================================================
+# ===                          ВЫВОД И ЗАГРУЗКА                                      ===
+# =====================================================================================
+
+def print_listing(recipe):
+    print(f"; {recipe.name}  id={recipe.recipe_id}  resources=0x{recipe.resources:08X}")
+    for arg in recipe.args:
+        print(f";   arg {arg.name}: offset {arg.offset} size {arg.size} {arg.min_value}..{arg.max_value} = {arg.default}")
+    for pc, instr in enumerate(recipe.code):
+        print(f"{pc:3d}: {instr.wire().hex(' ')}   ; line {instr.line}")
+
+
+def print_c(recipe):
+    """Инициализаторы для recipe_store.c (макросы R_*)."""
+    cname = recipe.name.lower()
+    print(f" const RecipeInstr_t g_recipe_{cname}[] = {{")
+    for pc, i in enumerate(recipe.code):
+        if i.op == OP_ROTATE_MOTOR:
+            profile = profile_name(i.speed)
+            if profile:
+                body = f"R_ROTATE_P({i.device}, {i.value}, {profile}, {i.timeout_ms})"
+            else:
+                body = f"R_ROTATE({i.device}, {i.value}, {i.speed}, {i.timeout_ms})"
+        elif i.op == OP_HOME_MOTOR:
+            profile = profile_name(i.speed)
+            if profile:
+                body = f"R_HOME_P({i.device}, {profile}, {i.timeout_ms})"
+            else:
+                body = f"R_HOME({i.device}, {i.speed}, {i.timeout_ms})"
+        elif i.op == OP_START_PUMP:
+            body = f"R_PUMP_ON({i.device}, {i.timeout_ms})"
+        elif i.op == OP_STOP_PUMP:
+            body = f"R_PUMP_OFF({i.device}, {i.timeout_ms})"
+        elif i.op == OP_WAIT_MS:
+            body = f"R_WAIT_ARG({i.val_bind - 1}, {i.value})" if i.val_bind else f"R_WAIT({i.value})"
+        elif i.op == OP_LOOP:
+            body = f"R_LOOP_ARG({i.val_bind - 1})" if i.val_bind else f"R_LOOP({i.value})"
+        elif i.op == OP_JUMP_UNLESS_ARG:
+            body = f"R_JUMP_UNLESS_ARG({i.val_bind - 1}, 0x{i.device:02X}, {i.value})"
+        else:
+            body = {OP_PAR_BEGIN: f"R_DAG_BEGIN(0x{i.value:07X})" if i.value else "R_PAR_BEGIN()", OP_PAR_END: "R_PAR_END()", OP_END_LOOP: "R_END_LOOP()",
+                    OP_JUMP: f"R_JUMP({i.value})", OP_BRANCH_IF_FAIL: f"R_BRANCH_IF_FAIL({i.value})",
+                    OP_END: "R_END()"}[i.op]
+        extra = ""
+        if i.dev_bind:
+            extra += f", .dev_bind = RECIPE_BIND_DEVICE({(i.dev_bind >> 4) - 1}, {i.dev_bind & 0x0F})"
+        if i.val_bind and i.op in (OP_ROTATE_MOTOR,):
+            extra += f", .val_bind = RECIPE_ARG({i.val_bind - 1})"
+        print(f"     /* {pc:2d} */ {{ {body}{extra} }},")
+    print(" };")
+    print()
+    print(f" static const RecipeArgLayout_t g_args_{cname} = {{")
+    print(f"     .count = {len(recipe.args)},")
+    print("     .fields = {")
+    for arg in recipe.args:
+        print(f"         {{ .offset = {arg.offset}, .size = {arg.size}, .min_value = {arg.min_value}, "
+              f".max_value = {arg.max_value}, .default_value = {arg.default} }},   // {arg.name}")
+    print("     }")
+    print(" };")
+
+
+def calculate_crc(data: bytes) -> int:
+    crc = 0
+    for byte in data:
+        crc ^= byte
+    return crc
+
+
+def build_command(command_code: int, params: bytes = b'') -> bytes:
+    header = b'CM>'
+    command_bytes = command_code.to_bytes(2, 'big')
+    length = len(command_bytes) + len(params) + 1  # Cmd + Params + CRC
+    crc_payload = command_bytes + params
+    return header + length.to_bytes(2, 'big') + crc_payload + bytes([calculate_crc(crc_payload)])
+
+
+def upload_packets(recipe) -> list:
+    """Пакеты RECIPE_UPLOAD: BEGIN, DATA по 5 инструкций, COMMIT с CRC-32."""
+    if not 1 <= recipe.recipe_id < RECIPE_STORE_MAX_ID:
+        raise RecipeError(f"recipe id must be 1..{RECIPE_STORE_MAX_ID - 1} ('recipe NAME id N')")
+    begin = bytes([0x01, recipe.recipe_id, len(recipe.code)]) + recipe.resources.to_bytes(4, 'big')
+    begin += bytes([len(recipe.args)])
+    for arg in recipe.args:
+        begin += bytes([arg.offset, arg.size])
+        for v in (arg.min_value, arg.max_value, arg.default):
+            begin += (v & 0xFFFFFFFF).to_bytes(4, 'big')
+    packets = [build_command(CMD_RECIPE_UPLOAD, begin)]
+
+    wire = b''.join(i.wire() for i in recipe.code)
+    for first in range(0, len(recipe.code), UPLOAD_CHUNK_INSTRUCTIONS):
+        chunk = recipe.code[first:first + UPLOAD_CHUNK_INSTRUCTIONS]
+        packets.append(build_command(CMD_RECIPE_UPLOAD, bytes([0x02, first]) + b''.join(i.wire() for i in chunk)))
+    packets.append(build_command(CMD_RECIPE_UPLOAD, bytes([0x03]) + zlib.crc32(wire).to_bytes(4, 'big')))
+    return packets
+
+
+def upload(recipe, port):
+    import serial   # Нужен только для загрузки на плату
+    with serial.Serial(port, 9600, timeout=1) as ser:
+        for packet in upload_packets(recipe):
+            ser.write(packet)
+            time.sleep(0.05)
+            reply = ser.read(ser.in_waiting or 1)
+            # Ответ ERROR: CM> len(2) cmd(2) 0x04 status(2) crc
+            at = reply.find(b'CM>\x00\x05\x10\x07\x04')
+            if at >= 0:
+                status = int.from_bytes(reply[at + 8:at + 10], 'big')
+                text = reply.decode('utf-8', errors='ignore')
+                raise RecipeError(f"upload rejected with 0x{status:04X}: {text.strip()}")
+    print(f"Uploaded {recipe.name} as recipe id {recipe.recipe_id} ({len(recipe.code)} instructions)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile and simulate conductor recipes")
+    parser.add_argument('files', nargs='+', help="recipe descriptions (*.rcp)")
+    parser.add_argument('--args', action='append', default=[],
+                        help="comma-separated argument values (one --args per file); defaults if omitted")
+    parser.add_argument('--listing', action='store_true', help="print the bytecode")
+    parser.add_argument('--c', action='store_true', help="print C initializers for recipe_store.c")
+    parser.add_argument('--upload', metavar='PORT', help="upload the recipe with RECIPE_UPLOAD")
+    opts = parser.parse_args()
+
+    try:
+        recipes = []
+        args_list = []
+        for n, path in enumerate(opts.files):
+            with open(path, encoding='utf-8') as f:
+                recipe = compile_recipe(f.read(), path)
+            values = [int(v, 0) for v in opts.args[n].split(',')] if n < len(opts.args) else []
+            args = [a.default for a in recipe.args]
+            args[:len(values)] = values
+            for arg, value in zip(recipe.args, args):
+                if not arg.min_value <= value <= arg.max_value:
+                    raise RecipeError(f"{path}: argument '{arg.name}' = {value} outside {arg.min_value}..{arg.max_value}")
+            recipes.append(recipe)
+            args_list.append(args)
+
+            if opts.listing:
+                print_listing(recipe)
+            if opts.c:
+                print_c(recipe)
+            elif opts.upload:
+                upload(recipe, opts.upload)
+            else:
+                print_report(recipe, args)
+            print()
+
+        if len(recipes) > 1:
+            print_conflicts(recipes, args_list)
+    except (RecipeError, OSError) as e:
+        print(f"ERROR: {e}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
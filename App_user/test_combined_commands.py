@@ -25,9 +25,12 @@ def calculate_crc(data: bytes) -> int:
         crc ^= byte
     return crc
 
-def build_command(command_code: int, params: bytes = b'') -> bytes:
-    header = b'CM>'
+def build_command(command_code: int, params: bytes = b'', seq: int = None) -> bytes:
+    # seq: команда с номером (шапка CS>, protocol.md 2.6) - повтор с тем же номером не выполняется
+    header = b'CM>' if seq is None else b'CS>'
     command_bytes = command_code.to_bytes(2, 'big')
+    if seq is not None:
+        command_bytes = seq.to_bytes(2, 'big') + command_bytes
     length = len(command_bytes) + len(params) + 1  # Cmd (2) + Params (X) + CRC (1)
     length_bytes = length.to_bytes(2, 'big')
     crc_payload = command_bytes + params
@@ -35,7 +38,32 @@ def build_command(command_code: int, params: bytes = b'') -> bytes:
     packet = header + length_bytes + crc_payload + crc
     return packet
 
+def find_packet_start(buffer: bytes) -> int:
+    starts = [i for i in (buffer.find(b'CM>'), buffer.find(b'CS>')) if i != -1]
+    return min(starts) if starts else -1
+
+def parse_sequenced_packet(raw_data: bytes):
+    # Ответ команде с номером: CS> len(2) seq(2) cmd(2) type status data crc.
+    # Номер вынимается, остальное разбирается как пакет CM>.
+    if len(raw_data) < 10:
+        return None, raw_data
+    payload_len = int.from_bytes(raw_data[3:5], 'big')
+    if len(raw_data) < 5 + payload_len:
+        return None, raw_data
+    packet = raw_data[:5 + payload_len]
+    if calculate_crc(packet[5:-1]) != packet[-1]:
+        print(f"ERROR: CRC mismatch in received packet. Raw: {packet.hex(' ')}")
+        return None, raw_data
+    body = packet[7:-1]
+    response_info, _ = parse_response_packet(b'CM>' + (payload_len - 2).to_bytes(2, 'big') + body + bytes([calculate_crc(body)]))
+    if response_info:
+        response_info.update({"header": b'CS>', "seq": int.from_bytes(packet[5:7], 'big'),
+                              "total_length": len(packet), "crc": packet[-1], "raw_packet": packet})
+    return response_info, raw_data[len(packet):]
+
 def parse_response_packet(raw_data: bytes):
+    if raw_data.startswith(b'CS>'):
+        return parse_sequenced_packet(raw_data)
     if len(raw_data) < 8 or not raw_data.startswith(b'CM>'):
         return None, raw_data # Неполный или некорректный пакет, возвращаем остаток
 
@@ -84,7 +112,8 @@ def parse_response_packet(raw_data: bytes):
             "response_type": response_type, # This will now be correct for fixed types or 0x03 for DATA
             "status_or_data": status_or_data,
             "crc": received_crc,
-            "raw_packet": raw_data[ : 5 + payload_len]
+            "raw_packet": raw_data[ : 5 + payload_len],
+            "seq": None
         }
         
         remaining_data = raw_data[5 + payload_len:]
@@ -113,7 +142,7 @@ def listen_serial_port():
                     # Сначала ищем текстовые сообщения (обычно заканчиваются \n или \r\n)
                     # Новая логика: если видим CM>, то это начало бинарного пакета.
                     # Обрабатываем все до CM> как текстовое, если оно есть.
-                    cm_index = buffer.find(b'CM>')
+                    cm_index = find_packet_start(buffer) # CM> или CS> (ответ команде с номером)
                     if cm_index != -1:
                         if cm_index > 0:
                             # Есть текст перед CM>
@@ -285,6 +314,56 @@ def test_get_status_command():
         return True
     return False
 
+def test_get_version_command():
+    print("\n=== Тест команды GET_VERSION (0x1003) ===")
+    if not send_and_wait_ack(0x1003):
+        return False
+
+    frames = []
+    start_time = time.time()
+    while time.time() - start_time < RESPONSE_TIMEOUT:
+        try:
+            msg = received_messages_queue.get(timeout=0.1)
+        except queue.Empty:
+            continue
+        if msg["type"] != "binary":
+            print(f"DEVICE: {msg['content']}")
+            continue
+        if msg["content"]["command_code"] != 0x1003:
+            continue
+        if msg["content"]["response_type"] == 0x03:
+            frames.append(msg["content"]["status_or_data"][3:])
+        elif msg["content"]["response_type"] == 0x02:
+            break
+    else:
+        print("ERROR: Таймаут ожидания DONE для команды 0x1003.")
+        return False
+
+    if not frames or len(frames[0]) < 21:
+        print("ERROR: GET_VERSION: нет заголовка версии.")
+        return False
+    header = frames[0]
+    print(f"GET_VERSION: firmware {header[0]}.{header[1]} build {int.from_bytes(header[2:4], 'big')} "
+          f"({header[4:12].decode('ascii', errors='replace')}), protocol {header[12]}, crc 0x{header[13]:02x}, "
+          f"options 0x{header[14]:02x}, max packet {int.from_bytes(header[15:17], 'big')}, "
+          f"max response {int.from_bytes(header[17:19], 'big')}, max params {header[19]}")
+    entries = b''.join(frames[1:])
+    commands = {}
+    for i in range(0, len(entries) - 4, 5):
+        code = int.from_bytes(entries[i:i + 2], 'big')
+        commands[code] = (entries[i + 2], entries[i + 3], entries[i + 4])
+        print(f"  0x{code:04x}: {'job' if entries[i + 2] else 'direct'}, params {entries[i + 3]}..{entries[i + 4]}")
+    if len(commands) != header[20]:
+        print(f"ERROR: GET_VERSION: в списке {len(commands)} команд, заявлено {header[20]}.")
+        return False
+    if 0x1003 not in commands:
+        print("ERROR: GET_VERSION отсутствует в собственном списке команд.")
+        return False
+    if 0x100A in commands and commands[0x100A][0] != 0x01:
+        print("ERROR: GET_VERSION: RECIPE_RUN (0x100A) запускает задание, ожидался вид 0x01.")
+        return False
+    return True
+
 def test_dispenser_wash_command(dispenser_id: int, volume: int, cycles: int):
     print(f"\n=== Тест команды DISPENSER_WASH (0x2000) для дозатора {dispenser_id}, объем {volume} мкл, циклов {cycles} ===")
     
@@ -347,6 +426,57 @@ def test_unknown_command():
     print("Тест неизвестной команды пройден успешно.")
     return True
 
+def test_sequenced_retransmit(seq: int = 0x0101):
+    print(f"\n=== Тест повтора команды с номером (DISPENSER_WASH, seq {seq}) ===")
+    # Повтор с тем же номером, как после потерянного ACK: промывка выполняется один раз
+    command_packet = build_command(0x2000, bytes([0x01, 0x03, 0xE8, 0x02]), seq)
+    print(f"Отправка команды 0x2000 дважды: {command_packet.hex(' ')}")
+    ser.write(command_packet)
+    ser.write(command_packet)
+
+    acks, dones = 0, 0
+    start_time = time.time()
+    while time.time() - start_time < RESPONSE_TIMEOUT * 2:
+        try:
+            msg = received_messages_queue.get(timeout=0.1)
+        except queue.Empty:
+            continue
+        if msg["type"] != "binary":
+            print(f"DEVICE: {msg['content']}")
+            continue
+        content = msg["content"]
+        if content["command_code"] != 0x2000 or content["seq"] != seq:
+            continue
+        if content["response_type"] == 0x01:
+            acks += 1
+        elif content["response_type"] in (0x02, 0x04):
+            dones += 1
+    if acks != 2 or dones != 1:
+        print(f"ERROR: на две отправки получено {acks} ACK и {dones} DONE/ERROR, ожидалось 2 и 1.")
+        return False
+
+    # Повтор после завершения: анализатор повторяет запомненные ACK и DONE
+    ser.write(command_packet)
+    if not wait_for_seq_replay(seq):
+        return False
+    print("Тест повтора команды с номером пройден успешно.")
+    return True
+
+def wait_for_seq_replay(seq: int) -> bool:
+    types = []
+    start_time = time.time()
+    while time.time() - start_time < RESPONSE_TIMEOUT and len(types) < 2:
+        try:
+            msg = received_messages_queue.get(timeout=0.1)
+        except queue.Empty:
+            continue
+        if msg["type"] == "binary" and msg["content"]["seq"] == seq:
+            types.append(msg["content"]["response_type"])
+    if types != [0x01, 0x02]:
+        print(f"ERROR: повтор завершенной команды вернул типы {types}, ожидались ACK и DONE.")
+        return False
+    return True
+
 def test_combined_scenario():
     print("\n=== Комбинированный сценарий: INIT + GET_STATUS ===")
     # Отправляем INIT
@@ -415,11 +545,19 @@ def main():
         if all_tests_passed and not test_get_status_command():
             all_tests_passed = False
 
+        # Версия прошивки и список поддерживаемых команд
+        if all_tests_passed and not test_get_version_command():
+            all_tests_passed = False
+
         # Запускаем индивидуальный тест DISPENSER_WASH для проверки
         # Пример: дозатор 1, 1000 мкл, 2 цикла
         if all_tests_passed and not test_dispenser_wash_command(1, 1000, 2):
             all_tests_passed = False
 
+        # Повтор команды с номером не выполняет ее второй раз
+        if all_tests_passed and not test_sequenced_retransmit():
+            all_tests_passed = False
+
         # Тест неизвестной команды
         if all_tests_passed and not test_unknown_command():
             all_tests_passed = False
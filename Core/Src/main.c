@@ -24,6 +24,7 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "Dispatcher/dispatcher_io.h"
+#include "Dispatcher/can_packer.h"
 #include "task_dispatcher.h"
 #include "task_can_handler.h"
 #include "task_usb_handler.h"
@@ -200,11 +201,10 @@ int main(void)
   usb_tx_queue_handle = xQueueCreate(APP_USB_TX_QUEUE_LENGTH, sizeof(USB_TxPacket_t));
 
 
-// Для CAN передаются структурированные сообщения.
-// Пока что представим, что это будет 8-байтный массив (payload CAN-сообщения).
-// Позже мы определим структуру CanMessage_t.
-  can_rx_queue_handle = xQueueCreate(APP_CAN_RX_QUEUE_LENGTH, APP_CAN_MESSAGE_MAX_LEN); // 20 CAN-сообщений
-  can_tx_queue_handle = xQueueCreate(APP_CAN_TX_QUEUE_LENGTH, APP_CAN_MESSAGE_MAX_LEN); // 20 CAN-сообщений
+// Для CAN передаются структурированные сообщения CAN_Message_t (can_packer.h):
+// ID + 8 байт данных + DLC. Заголовок HAL формируется в задаче CAN.
+  can_rx_queue_handle = xQueueCreate(APP_CAN_RX_QUEUE_LENGTH, sizeof(CAN_Message_t)); // 20 CAN-сообщений
+  can_tx_queue_handle = xQueueCreate(APP_CAN_TX_QUEUE_LENGTH, sizeof(CAN_Message_t)); // 20 CAN-сообщений
 
   //log_queue_handle = xQueueCreate(APP_LOG_QUEUE_LENGTH , APP_LOG_MESSAGE_MAX_LEN); // 30 сообщений для лога, каждое до 128 байт
 
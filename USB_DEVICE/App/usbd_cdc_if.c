@@ -27,6 +27,7 @@
 #include "queue.h"
 #include "shared_resources.h"
 #include "app_config.h"
+#include "task_dispatcher.h"
 
 /* USER CODE END INCLUDE */
 
@@ -293,6 +294,9 @@ static int8_t CDC_Receive_HS(uint8_t* Buf, uint32_t *Len)
 		// (Опционально) Можно добавить проверку, что все байты были отправлены,
 		// но для простоты мы предполагаем, что буфер всегда сможет их принять.
 		(void)bytes_sent; // Подавляем предупреждение "unused variable"
+
+		// Задача диспетчера читает буфер без ожидания и спит на своем семафоре
+		Dispatcher_Wakeup();
 		}
 
 	// Снова готовим USB-приемник к приему следующего пакета данных.